@@ -0,0 +1,110 @@
+// Tests of evaluateAsync: Promise results and errors, timeouts, the queue
+// limit, sessions and templates. Run with `npm run test-async`.
+
+// read by the first evaluateAsync call
+process.env.GIAC_MAX_QUEUE = "8";
+
+var giac = require('bindings')('giac');
+var assert = require('assert');
+
+async function rejects(promise, pattern) {
+  try {
+    await promise;
+  } catch (err) {
+    assert.match(err.message, pattern);
+    return;
+  }
+  assert.fail("not rejected, expected " + pattern);
+}
+
+var tests = {
+  "queue full": async function() {
+    // the pending count only decreases on the event loop, so 8 synchronous
+    // calls fill the queue
+    var jobs = [];
+    for (var i = 0; i < 8; i++)
+      jobs.push(giac.evaluateAsync(i + "+1"));
+    await rejects(giac.evaluateAsync("9+1"), /^giac queue full$/);
+    var results = await Promise.all(jobs);
+    assert.deepStrictEqual(results, ["1", "2", "3", "4", "5", "6", "7", "8"]);
+    assert.strictEqual(await giac.evaluateAsync("9+1"), "10");
+  },
+
+  "same result as evaluate": async function() {
+    for (var e of ["expand((x+y)^3)", "[1]", "evalf(7,15)", "normal(sqrt(1+i))"])
+      assert.strictEqual(await giac.evaluateAsync(e), giac.evaluate(e));
+  },
+
+  "errors reject": async function() {
+    await rejects(giac.evaluateAsync("throw(\"boom\")"), /boom/);
+    // the context is still usable
+    assert.strictEqual(await giac.evaluateAsync("2^10"), "1024");
+  },
+
+  "anonymous calls do not share state": async function() {
+    var set = [];
+    for (var i = 0; i < 8; i++)
+      set.push(giac.evaluateAsync("pa:=5;assume(pb>0);Digits:=30"));
+    await Promise.all(set);
+    var get = [];
+    for (var i = 0; i < 8; i++)
+      get.push(giac.evaluateAsync("[pa,about(pb),Digits]"));
+    for (var r of await Promise.all(get))
+      assert.strictEqual(r, giac.evaluate("[pa,about(pb),Digits]"));
+  },
+
+  "timeout": async function() {
+    var start = Date.now();
+    await rejects(giac.evaluateAsync("k:=0;while(true){k:=k+1}", {timeout: 1}), /^Timeout$/);
+    assert.ok(Date.now() - start < 10000);
+    // the next evaluation gets its own time
+    assert.strictEqual(await giac.evaluateAsync("sum(j,j,1,10)", {timeout: 1}), "55");
+  },
+
+  "session": async function() {
+    var a = giac.evaluateAsync("a:=3", {session: "alice"});
+    // queued behind the first call of the session
+    var b = giac.evaluateAsync("a+1", {session: "alice"});
+    assert.strictEqual(await a, "3");
+    assert.strictEqual(await b, "4");
+    await rejects(giac.evaluateAsync("k:=0;while(true){k:=k+1}", {session: "alice", timeout: 1}), /^Timeout$/);
+    assert.strictEqual(await giac.evaluateAsync("a*2", {session: "alice"}), "6");
+    assert.strictEqual(giac.closeSession("alice"), true);
+    assert.strictEqual(giac.closeSession("alice"), false);
+    assert.strictEqual(await giac.evaluateAsync("a", {session: "alice"}), "a");
+    giac.closeSession("alice");
+  },
+
+  "template": async function() {
+    await giac.evaluateAsync("a:=3;f(x):=x^2+a;g():={local l:=[0]; l[0]=<l[0]+1; return l[0];}", {session: "base"});
+    assert.strictEqual(await giac.evaluateAsync("a+f(2)", {session: "bob", template: "base"}), "10");
+    assert.strictEqual(await giac.evaluateAsync("a:=5", {session: "bob"}), "5");
+    assert.strictEqual(await giac.evaluateAsync("a", {session: "base"}), "3");
+    // in place changes of the lists of a program body stay in the clone
+    var first = await giac.evaluateAsync("g()", {session: "carol", template: "base"});
+    await giac.evaluateAsync("g()", {session: "carol"});
+    assert.strictEqual(await giac.evaluateAsync("g()", {session: "dave", template: "base"}), first);
+    // an existing session ignores the template
+    assert.strictEqual(await giac.evaluateAsync("a", {session: "bob", template: "base"}), "5");
+    await rejects(giac.evaluateAsync("1", {session: "erin", template: "nobody"}), /missing or busy/);
+    var busy = giac.evaluateAsync("k:=0;while(true){k:=k+1}", {session: "base", timeout: 1});
+    await rejects(giac.evaluateAsync("1", {session: "erin", template: "base"}), /missing or busy/);
+    await rejects(busy, /^Timeout$/);
+    for (var s of ["base", "bob", "carol", "dave", "erin"])
+      giac.closeSession(s);
+  },
+};
+
+(async function() {
+  var failed = 0;
+  for (var name in tests) {
+    try {
+      await tests[name]();
+      console.log("ok " + name);
+    } catch (err) {
+      failed++;
+      console.log("FAILED " + name + ": " + err.message);
+    }
+  }
+  process.exit(failed ? 1 : 0);
+})();
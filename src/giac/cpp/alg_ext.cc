@@ -60,6 +60,8 @@ namespace giac {
   bool comparegen::operator ()(const gen & a,const gen & b) const { 
     if (a.type==_INT_ && b.type==_INT_)
       return a.val<b.val;
+    if (a.type==_SYMB && b.type==_SYMB && a._SYMBptr==b._SYMBptr)
+      return false; // same (e.g. hash-consed) node
     gen A1,A2,B1,B2;
     if (a.type==_VECT && a._VECTptr->size()==2 && (A1=a._VECTptr->front()).type==_INT_ && (A2=a._VECTptr->back()).type==_INT_ && b.type==_VECT && b._VECTptr->size()==2 && (B1=b._VECTptr->front()).type==_INT_ && (B2=b._VECTptr->back()).type==_INT_){
       return (A1.val!=B1.val)?A1.val<B1.val:A2.val<B2.val;
@@ -1436,6 +1438,7 @@ namespace giac {
       caseval_maxtime=giacmax(2,g._VECTptr->front().val);
       caseval_n=0;
       caseval_mod=giacmax(2,g._VECTptr->back().val);
+      store_tunables(_TUNE_CASEVAL_MAXTIME | _TUNE_CASEVAL_MOD,contextptr);
       string S="Max eval time set to "+print_INT_(caseval_maxtime)+", check frequency 1/"+print_INT_(caseval_mod);
       return string2gen(S,false);
 #else
@@ -1448,6 +1451,7 @@ namespace giac {
     caseval_maxtime=g.val;
     caseval_n=0;
     caseval_mod=10;
+    store_tunables(_TUNE_CASEVAL_MAXTIME | _TUNE_CASEVAL_MOD,contextptr);
     string S="Max eval time set to "+g.print()+" , check frequency 1/10";
 #else
     string S="Recompile with -DTIMEOUT to have timeout support.";
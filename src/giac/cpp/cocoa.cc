@@ -157,6 +157,17 @@ namespace giac {
     return -1;
   }
 
+  // F4 matrix dimensions for the performance counters
+  static void perf_f4(unsigned nrows,unsigned ncols){
+    if (!perf_on)
+      return;
+    perf_add(PERF_F4_MATRICES);
+    perf_add(PERF_F4_ROWS,nrows);
+    perf_add(PERF_F4_COLS,ncols);
+    perf_max(PERF_F4_MAXROWS,nrows);
+    perf_max(PERF_F4_MAXCOLS,ncols);
+  }
+
   //  vecteur trim(const vecteur & p,environment * env);
 
 #ifdef HAVE_LIBCOCOA
@@ -3402,6 +3413,9 @@ namespace giac {
       gbasis_update(G,B,res,l,TMP1,TMP2,vtmp,env);
     }
     for (int age=1;!B.empty() && !interrupted && !ctrl_c;++age){
+#ifdef TIMEOUT
+      control_c();
+#endif
       if (debug_infolevel>1)
 	CERR << CLOCK()*1e-6 << " number of pairs: " << B.size() << ", base size: " << G.size() << '\n';
       // find smallest lcm pair in B
@@ -5306,6 +5320,9 @@ This will be performed only in case of success (i.e. the leading will be reduced
       gbasis_updatemod(G,B,res,l,TMP2,env,true,oldG);
     }
     for (;!B.empty() && !interrupted && !ctrl_c;){
+#ifdef TIMEOUT
+      control_c();
+#endif
       oldG=G;
       if (debug_infolevel>1)
 	CERR << CLOCK()*1e-6 << " mod number of pairs: " << B.size() << ", base size: " << G.size() << '\n';
@@ -8979,6 +8996,7 @@ template<class tdeg_t,class modint_t,class modint_t2>
       firstpos[i]=atrier[i].val;
     }
     bool freemem=true; // mem>4e7; // should depend on real memory available
+    perf_f4(nrows,N);
     if (debug_infolevel>1)
       CERR << CLOCK()*1e-6 << " Mindex sorted, rows " << nrows << " columns " << N << " terms " << mem << " ratio " << (mem/nrows)/N <<'\n';
     // CERR << "after sort " << M << '\n';
@@ -9471,6 +9489,7 @@ template<class tdeg_t,class modint_t,class modint_t2>
       firstpos[i]=atrier[i].val;
     }
     bool freemem=mem>4e7; // should depend on real memory available
+    perf_f4(nrows,N);
     if (debug_infolevel>1)
       CERR << CLOCK()*1e-6 << " Mindex sorted, rows " << nrows << " columns " << N << " terms " << mem << " ratio " << (mem/nrows)/N <<'\n';
     // CERR << "after sort " << M << '\n';
@@ -9485,6 +9504,10 @@ template<class tdeg_t,class modint_t,class modint_t2>
       return -1;
     }
     unsigned Kcols=N-nrows;
+    if (!memory_check(4*(double(B.size())*((N>>5)+1))+double(B.size())*Kcols*sizeof(modint_t))){
+      CERR << "Error, memory limit exceeded, rows " << B.size() << " columns " << N << '\n';
+      return -1;
+    }
     vector<unsigned> lebitmap(((N>>5)+1)*B.size());
     unsigned * bitmap=&lebitmap.front();
     for (i=0;i<B.size();++i){
@@ -9657,6 +9680,7 @@ template<class tdeg_t,class modint_t,class modint_t2>
 
   template<class tdeg_t,class modint_t>
   int f4mod(vectpolymod<tdeg_t,modint_t> & res,const vector<unsigned> & G,modint_t env,vector< paire > & smallposp,vectpolymod<tdeg_t,modint_t> & f4buchbergerv,bool learning,unsigned & learned_position,vector< paire > * pairs_reducing_to_zero,info_t<tdeg_t,modint_t> & information,vector< info_t<tdeg_t,modint_t> >* f4buchberger_info,unsigned & f4buchberger_info_position,bool recomputeR, polymod<tdeg_t,modint_t> & TMP1,polymod<tdeg_t,modint_t> & TMP2){
+    trace_scope scope("f4mod",smallposp.size());
     // Improve: we don't really need to compute the s-polys here
     // it's sufficient to do that at linalg step
     if (debug_infolevel>1)
@@ -9754,6 +9778,9 @@ template<class tdeg_t,class modint_t,class modint_t2>
       gbasis_updatemod(G,B,res,l,TMP2,env,true,oldG);
     }
     for (int age=1;!B.empty() && !interrupted && !ctrl_c;++age){
+#ifdef TIMEOUT
+      control_c();
+#endif
       if (age+1>=capa)
 	return false; // otherwise reallocation will make pointers invalid
       oldG=G;
@@ -10151,6 +10178,7 @@ template<class tdeg_t,class modint_t,class modint_t2>
   // otherwise returns 0 and leaves P unchanged
   template<class tdeg_t>
   int chinrem(vectpoly8<tdeg_t> &P,const gen & pmod,vectpoly8<tdeg_t> & Q,const gen & qmod,poly8<tdeg_t> & tmp){
+    trace_scope scope("crt",P.size());
     if (P.size()!=Q.size())
       return 0;
     for (unsigned i=0;i<P.size();++i){
@@ -10178,6 +10206,7 @@ template<class tdeg_t,class modint_t,class modint_t2>
 
   template<class tdeg_t,class modint_t>
   void * thread_chinrem(void * _ptr){
+    trace_scope scope("thread_chinrem");
     chinrem_t<tdeg_t,modint_t> * ptr=(chinrem_t<tdeg_t,modint_t> *) _ptr;
     poly8<tdeg_t> & P=*ptr->Pptr;
     const polymod<tdeg_t,modint_t> & Q=*ptr->Qptr;
@@ -10265,20 +10294,20 @@ template<class tdeg_t,class modint_t,class modint_t2>
           }
           // parallel chinese remaindering 
           chinrem_t<tdeg_t,modint_t> chinrem_param[MAXNTHREADS]; mpz_t tmptab[MAXNTHREADS];
-          pthread_t tab[MAXNTHREADS];
+          thread_task tab[MAXNTHREADS];
           for (int j=0;j<nthreads;++j){
             chinrem_t<tdeg_t,modint_t> tmp={&P,&Q,j*P.coord.size()/nthreads,(j+1)*P.coord.size()/nthreads,U,qmodval,pmod._ZINTptr,&tmptab[j]};
             chinrem_param[j]=tmp;
             mpz_init2(tmptab[j],cur);
             bool res=true;
             if (j<nthreads-1)
-              res=pthread_create(&tab[j],(pthread_attr_t *) NULL,thread_chinrem<tdeg_t,modint_t>,(void *) &chinrem_param[j]);
+              res=thread_task_create(&tab[j],thread_chinrem<tdeg_t,modint_t>,(void *) &chinrem_param[j]);
             if (res)
               thread_chinrem<tdeg_t,modint_t>((void *)&chinrem_param[j]);
           } // end creating threads
           for (unsigned j=0;j<nthreads;++j){
             void * ptr_=(void *)&nthreads; // non-zero initialisation
-            if (j<nthreads-1) pthread_join(tab[j],&ptr_);
+            if (j<nthreads-1) thread_task_join(tab[j],&ptr_);
             mpz_clear(tmptab[j]); 
           }
           mpz_clear(tmpz);
@@ -10384,6 +10413,7 @@ template<class tdeg_t,class modint_t,class modint_t2>
   // otherwise returns 0 and leaves P unchanged
   template<class tdeg_t,class modint_t>
   int chinrem(vectpoly8<tdeg_t> &P,const gen & pmod,const vectpolymod<tdeg_t,modint_t> & Q,int qmod,poly8<tdeg_t> & tmp,int start=0,int nthreads=1){
+    trace_scope scope("crt",P.size());
     if (P.size()!=Q.size())
       return 0;
     for (unsigned i=start;i<P.size();++i){
@@ -12552,6 +12582,7 @@ template<class tdeg_t,class modint_t>
   
   template <class tdeg_t,class modint_t,class modint_t2>
   void * thread_buchberger(void * ptr_){
+    trace_scope scope("thread_buchberger");
     thread_buchberger_t<tdeg_t,modint_t> * ptr=(thread_buchberger_t<tdeg_t,modint_t> *) ptr_;
     const vectzpolymod<tdeg_t,modint_t> & res=*ptr->resptr;
     vector< vector<modint_t> > & K =*ptr->Kptr;
@@ -12787,7 +12818,7 @@ template<class tdeg_t,class modint_t>
 	else
 	  positions.back()=Bs;
       } // end else interreduce 
-      pthread_t tab[MAXNTHREADS];
+      thread_task tab[MAXNTHREADS];
       thread_buchberger_t<tdeg_t,modint_t> buchberger_param[MAXNTHREADS];
       int colonnes=N;
       for (int j=0;j<=th;++j){
@@ -12796,7 +12827,7 @@ template<class tdeg_t,class modint_t>
 	bool res=true;
 	// CERR << "write " << j << " " << p << '\n';
 	if (j<th)
-	  res=pthread_create(&tab[j],(pthread_attr_t *) NULL,thread_buchberger<tdeg_t,modint_t,modint_t2>,(void *) &buchberger_param[j]);
+	  res=thread_task_create(&tab[j],thread_buchberger<tdeg_t,modint_t,modint_t2>,(void *) &buchberger_param[j]);
 	if (res)
 	  thread_buchberger<tdeg_t,modint_t,modint_t2>((void *)&buchberger_param[j]);
       }
@@ -12804,7 +12835,7 @@ template<class tdeg_t,class modint_t>
       colonnes=buchberger_param[th].colonnes;
       for (unsigned j=0;j<th;++j){
 	void * ptr_=(void *)&th; // non-zero initialisation
-	pthread_join(tab[j],&ptr_);
+	thread_task_join(tab[j],&ptr_);
 	if (!ptr_)
 	  Kdone=false;
 	thread_buchberger_t<tdeg_t,modint_t> * ptr = (thread_buchberger_t<tdeg_t,modint_t> *) ptr_;
@@ -13045,6 +13076,7 @@ template<class tdeg_t,class modint_t>
 
   template<class tdeg_t,class modint_t>
   void * zbuildM_(void * ptr_){
+    trace_scope scope("zbuildM");
     zbuildM_t<tdeg_t,modint_t> * ptr=(zbuildM_t<tdeg_t,modint_t> *) ptr_;
     do_zbuildM<tdeg_t,modint_t>(*ptr->res,*ptr->G,ptr->env,ptr->multimodular,*ptr->quo,*ptr->R,*ptr->Rdegpos,ptr->Rhashptr,*ptr->coeffindex,ptr->N,*ptr->Mindex,*ptr->Mcoeff,*ptr->atrier,ptr->i,ptr->iend,ptr->j);
     return ptr_;
@@ -13058,7 +13090,7 @@ template<class tdeg_t,class modint_t>
 #else
     if (nrows<16) parallel=1;
 #endif
-    pthread_t tab[parallel];
+    thread_task tab[parallel];
     zbuildM_t<tdeg_t,modint_t> zbuildM_param[parallel];
     int istart=0,iend=0,jstart=0,jend=0;
     for (int j=0;j<parallel;++j){
@@ -13078,7 +13110,7 @@ template<class tdeg_t,class modint_t>
       zbuildM_param[j]=tmp;
       bool res=true;
       if (j<parallel-1)
-	res=pthread_create(&tab[j],(pthread_attr_t *) NULL,zbuildM_<tdeg_t,modint_t>,(void *) &zbuildM_param[j]);
+	res=thread_task_create(&tab[j],zbuildM_<tdeg_t,modint_t>,(void *) &zbuildM_param[j]);
       if (res)
 	zbuildM_<tdeg_t,modint_t>((void *)&zbuildM_param[j]);
       istart=iend;
@@ -13086,7 +13118,7 @@ template<class tdeg_t,class modint_t>
     }
     for (unsigned j=0;j<parallel-1;++j){
       void * ptr_=(void *)&parallel; // non-zero initialisation
-      pthread_join(tab[j],&ptr_);
+      thread_task_join(tab[j],&ptr_);
       if (!ptr_)
 	CERR << "Error building M" << '\n';
     }
@@ -13418,6 +13450,7 @@ template<class tdeg_t,class modint_t>
   // G should be identity, res[0] to res[G.size()-1] the gbasis
   template<class tdeg_t,class modint_t,class modint_t2>
   int zf4mod(vectzpolymod<tdeg_t,modint_t> & res,const vector<unsigned> & G,modint_t env,const vector< paire > & B,const vector<unsigned> * & permuBptr,vectzpolymod<tdeg_t,modint_t> & f4buchbergerv,bool learning,unsigned & learned_position,vector< paire > * pairs_reducing_to_zero,vector<zinfo_t<tdeg_t> > & f4buchberger_info,unsigned & f4buchberger_info_position,bool recomputeR,int age,bool multimodular,int parallel,int interreduce){
+    trace_scope scope("zf4mod",B.size());
     unsigned Bs=unsigned(interreduce?(interreduce==2?res.size()-G.size():G.size()):B.size());
     if (!Bs)
       return 0;
@@ -13649,6 +13682,7 @@ template<class tdeg_t,class modint_t>
       firstpos[i]=atrier[i].val;
     }
     double ratio=(mem/nrows)/N;
+    perf_f4(nrows,N);
     if (debug_infolevel>1)
       CERR << CLOCK()*1e-6 << " Mindex sorted, rows " << nrows << " columns " << N << " terms " << mem << " ratio " << ratio <<'\n';
     if (N<nrows){
@@ -13660,6 +13694,11 @@ template<class tdeg_t,class modint_t>
       CERR << "Error, problem too large. Try again after running gbasis_max_pairs(n) with n<" << 2e9/(N>>5) << '\n';
       return -1;
     }
+    // bitmap and reduced rows of the Macaulay matrix
+    if (!memory_check(4*(double(Bs)*((N>>5)+1))+double(Bs)*(N-nrows)*sizeof(modint_t))){
+      CERR << "Error, memory limit exceeded, rows " << Bs << " columns " << N << '\n';
+      return -1;
+    }
     vector<used_t> used(N,0);
     vector<unsigned> lebitmap(((N>>5)+1)*Bs);
     unsigned * bitmap=&lebitmap.front();
@@ -14249,6 +14288,9 @@ Let {f1, ..., fr} be a set of polynomials. The Gebauer-Moller Criteria are as fo
       CERR << CLOCK()*1e-6 << " begin loop, mem " << memory_usage()*1e-6 << '\n';
     int age;
     for (age=1;!B.empty() && !interrupted && !ctrl_c;++age){
+#ifdef TIMEOUT
+      control_c();
+#endif
       if (f4buchberger_info.size()>=capa-2 || age>maxage){
 	CERR << "Error zgbasis too many iterations" << '\n';
 	return false; // otherwise reallocation will make pointers invalid
@@ -15230,6 +15272,8 @@ void G_idn(vector<unsigned> & G,size_t s){
       control_c();
 #endif
       if (interrupted || ctrl_c){
+	if (eval_cancelled()) // timeout, do not resume computation
+	  return false;
 	CERR << "Check interrupted, assuming Groebner basis. Press Ctrl-C again to interrupt computation" << '\n';
 	interrupted=ctrl_c=false;
 	return true;
@@ -16406,6 +16450,7 @@ void G_idn(vector<unsigned> & G,size_t s){
 
   template<class tdeg_t>
   bool rur_compute(vectpolymod<tdeg_t,mod4int> & gbmod,polymod<tdeg_t,mod4int> & lm,polymod<tdeg_t,mod4int> & lmmodradical,mod4int p,polymod<tdeg_t,modint> & s,vector<int> * initsep,vectpolymod<tdeg_t,mod4int> & rur){
+    trace_scope scope("rur_compute");
     // FIXME, call 4 modint rur_compute
     return false;
   }
@@ -16472,6 +16517,7 @@ void G_idn(vector<unsigned> & G,size_t s){
   // for k=1 to dim to rur[k]=-n[k]*inv(d[k] mod F)*F1 mod F
   template<class tdeg_t>
   bool rur_compute(vectpolymod<tdeg_t,modint> & gbmod,polymod<tdeg_t,modint> & lm,polymod<tdeg_t,modint> & lmmodradical,int p,polymod<tdeg_t,modint> & s,vector<int> * initsep,vectpolymod<tdeg_t,modint> & rur){
+    trace_scope scope("rur_compute");
     vecteur m,M,res;
     int dim=lm.dim;
     order_t order=lm.order;
@@ -16604,6 +16650,7 @@ void G_idn(vector<unsigned> & G,size_t s){
   
   template<class tdeg_t,class modint_t,class modint_t2>
   void * thread_gbasis(void * ptr_){
+    trace_scope scope("thread_gbasis");
     thread_gbasis_t<tdeg_t,modint_t> * ptr=(thread_gbasis_t<tdeg_t,modint_t> *) ptr_;
     ptr->G.clear();
     if (ptr->zdata){
@@ -16706,6 +16753,7 @@ void G_idn(vector<unsigned> & G,size_t s){
   
   template<class tdeg_t>
   void * thread_rur_certify(void * ptr)  {
+    trace_scope scope("thread_rur_certify");
     rur_certify_t<tdeg_t> * Rptr=(rur_certify_t<tdeg_t> *) ptr;
     const vectpoly8<tdeg_t> & syst =*Rptr->syst;
     modpoly minp=free_copy(*Rptr->minp);
@@ -16818,7 +16866,7 @@ void G_idn(vector<unsigned> & G,size_t s){
       if (nthreads>rur_certify_maxthreads) nthreads=rur_certify_maxthreads; // don't use too much memory
       if (debug_infolevel)
         *logptr(contextptr) << "rur_certify: multi-thread check, info displayed on may miss some threads info. Threads in use: " << nthreads << "\n";
-      pthread_t tab[MAXNTHREADS];
+      thread_task tab[MAXNTHREADS];
       vector< rur_certify_t<tdeg_t> > rur_certify_param; rur_certify_param.reserve(nthreads);
       for (int j=0;j<nthreads;++j){
 	vector<int> chk_index;
@@ -16828,7 +16876,7 @@ void G_idn(vector<unsigned> & G,size_t s){
 	rur_certify_param.push_back(cur);
 	bool res=true;
 	if (j<nthreads-1)
-	  res=pthread_create(&tab[j],(pthread_attr_t *) NULL,thread_rur_certify<tdeg_t>,(void *) &rur_certify_param[j]);
+	  res=thread_task_create(&tab[j],thread_rur_certify<tdeg_t>,(void *) &rur_certify_param[j]);
 	if (res)
 	  thread_rur_certify<tdeg_t>((void *)&rur_certify_param[j]);
       }
@@ -16837,7 +16885,7 @@ void G_idn(vector<unsigned> & G,size_t s){
       for (int j=0;j<nthreads;++j){
 	threadretval[j]=&threadretval; // non-0 initialization
 	if (j<nthreads-1)
-	  pthread_join(tab[j],&threadretval[j]);
+	  thread_task_join(tab[j],&threadretval[j]);
 	ans=ans && rur_certify_param[j].ans;
       }
       if (debug_infolevel)
@@ -16908,6 +16956,7 @@ void G_idn(vector<unsigned> & G,size_t s){
       }
       res.tab[i]=p;
     }
+    perf_add(PERF_PRIMES,sizeof(mod4int)/sizeof(modint));
     return p4=res;
   }
   template<class tdeg_t> void copy(const polymod<tdeg_t,modint> & src, polymod<tdeg_t,qmodint> & target){
@@ -16927,6 +16976,7 @@ void G_idn(vector<unsigned> & G,size_t s){
       if (!is_zero(llcm % p))
 	break;
     }
+    perf_add(PERF_PRIMES);
     return p;
   }
   inline int getint(qmodint p, int pos){ return p; }
@@ -17043,7 +17093,7 @@ void G_idn(vector<unsigned> & G,size_t s){
     bool ok=true;
 #ifdef HAVE_LIBPTHREAD
     int nthreads=(threads_allowed && multithread_enabled)?giacmin(threads,MAXNTHREADS):1,th,parallel=1;
-    pthread_t tab[MAXNTHREADS];
+    thread_task tab[MAXNTHREADS];
     thread_gbasis_t<tdeg_t,qmodint_t> gbasis_param[MAXNTHREADS];
 #else
     int nthreads=1,th,parallel=1;
@@ -17120,7 +17170,7 @@ void G_idn(vector<unsigned> & G,size_t s){
       for (unsigned j=0;j<th;++j){      
 	bool res=true;
 	// CERR << "write " << j << " " << p << '\n';
-	res=pthread_create(&tab[j],(pthread_attr_t *) NULL,thread_gbasis<tdeg_t,qmodint_t,qmodint_t2>,(void *) &gbasis_param[j]);
+	res=thread_task_create(&tab[j],thread_gbasis<tdeg_t,qmodint_t,qmodint_t2>,(void *) &gbasis_param[j]);
 	if (res)
 	  thread_gbasis<tdeg_t,qmodint_t,qmodint_t2>((void *)&gbasis_param[j]);
       }
@@ -17146,7 +17196,6 @@ void G_idn(vector<unsigned> & G,size_t s){
 	  G.clear();
 	  if (!zgbasisrur<tdeg_t,qmodint_t,qmodint_t2>(current_gbasis,resmod,G,p_qmodint,true/*totaldeg*/,&reduceto0,zf4buchberger_info,false,false,eliminate_flag,true,parallel,interred,mainthrurinzgbasis,mainthrurv,rurs,&gbasis_par.initsep,mainthrurlm,mainthrurlmmodradical,&mainthrurgblm,&mainthrurlmsave,gbasis_par,coeffsmodptr?&gbasiscoeffv[th]:0)){
 	    ok=false;
-	    break;
 	  }
 	}
       }
@@ -17169,7 +17218,6 @@ void G_idn(vector<unsigned> & G,size_t s){
 	  f4buchberger_info.clear(); G.clear();
 	  if (!in_gbasisf4buchbergermod(current,resmod,G,p_qmodint,true/*totaldeg*/,&reduceto0,&f4buchberger_info,false)){
 	    ok=false;
-	    break;
 	  }
 	  reduceto0.clear();
 	  f4buchberger_info.clear();
@@ -17179,7 +17227,6 @@ void G_idn(vector<unsigned> & G,size_t s){
 #else // GBASISF4_BUCHBERGER 
       if (!in_gbasismod(current,resmod,G,p.val,true,&reduceto0)){
 	ok=false;
-	break;
       }
       // CERR << "reduceto0 " << reduceto0.size() << '\n';
       //if (!in_gbasis(current,G,&env)) return false;
@@ -17189,9 +17236,11 @@ void G_idn(vector<unsigned> & G,size_t s){
       void * threadretval[MAXNTHREADS];
       for (int t=0;t<th;++t){
 	threadretval[t]=&threadretval; // non-0 initialization
-	pthread_join(tab[t],&threadretval[t]);
+	thread_task_join(tab[t],&threadretval[t]);
       }
 #endif
+      if (!ok)
+	break;
       // cleanup G
       for (unsigned i=0;i<G.size();++i){
 	if (resmod[G[i]].coord.empty()){
@@ -19853,6 +19902,7 @@ void G_idn(vector<unsigned> & G,size_t s){
   }
 
   bool gbasis8(const vectpoly & v,order_t & order,vectpoly & newres,environment * env,bool modularalgo,bool modularcheck,int & rur,GIAC_CONTEXT,gbasis_param_t gbasis_param,vector<vectpoly> * coeffsptr){
+    perf_timer timer(PERF_TIME_GBASIS);
     bool & eliminate_flag=gbasis_param.eliminate_flag;
     if (gbasis_param.buchberger_select_strategy==-1 && !v.empty()){
       if (GBASIS_COEFF_STRATEGY)
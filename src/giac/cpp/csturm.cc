@@ -1890,6 +1890,7 @@ namespace giac {
   };
 
   void * do_thread_vas_t(void * ptr_){
+    trace_scope scope("thread_vas");
     thread_vas_t * ptr=(thread_vas_t *) ptr_;
     *ptr->v=VAS_positive_roots(*ptr->P,ptr->a,ptr->b,ptr->c,ptr->d,ptr->contextptr);
     return ptr_;
@@ -1955,7 +1956,7 @@ namespace giac {
 #ifdef HAVE_LIBPTHREAD
       int nthreads=threads_allowed?threads:1;
       if (nthreads>1 && p.size()>64){
-	pthread_t tab0;
+	thread_task tab0;
 	thread_vas_t tmp0={&v,&res1,1,0,0,1,contextptr};
 	for (int i=0;i<v.size();++i){
 	  if (v[i].type==_ZINT)
@@ -1963,12 +1964,12 @@ namespace giac {
 	}
 	thread_vas_t tmp1={&w,&res2,-1,0,0,1,contextptr};
 	bool res=true;
-	res=pthread_create(&tab0,(pthread_attr_t *) NULL,do_thread_vas_t,(void *) &tmp0);
+	res=thread_task_create(&tab0,do_thread_vas_t,(void *) &tmp0);
 	if (res)
 	  do_thread_vas_t(&tmp0);
 	do_thread_vas_t(&tmp1);
 	void *ptr=&nthreads;
-	pthread_join(tab0,&ptr);
+	thread_task_join(tab0,&ptr);
       }
       else 
 #endif
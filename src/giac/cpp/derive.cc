@@ -70,6 +70,29 @@ namespace giac {
     return false;
   }
 
+  // current depend memo while derive is running, see dag_memo
+  static GIAC_THREAD_LOCAL dag_memo * depend_memo=0;
+
+  static bool depend_dag(const gen & g,const identificateur & i){
+    if (g.type==_SYMB){
+      if (!depend_memo || !dag_memo::shared(g))
+	return depend_dag(g._SYMBptr->feuille,i);
+      if (const gen * ptr=depend_memo->find(g))
+	return ptr->val!=0;
+      bool b=depend_dag(g._SYMBptr->feuille,i);
+      depend_memo->insert(g,b?1:0);
+      return b;
+    }
+    if (g.type!=_VECT)
+      return depend(g,i);
+    const_iterateur it=g._VECTptr->begin(),itend=g._VECTptr->end();
+    for (;it!=itend;++it){
+      if (depend_dag(*it,i))
+	return true;
+    }
+    return false;
+  }
+
   static int count_noncst(const gen & g,const identificateur & i){
     if (g.type!=_VECT)
       return depend(g,i)?1:0;
@@ -93,7 +116,7 @@ namespace giac {
       }
     }
     // if s does not depend on i return 0
-    if (!depend(g_orig,i))
+    if (!depend_dag(g_orig,i))
       return zero;
     // rational operators are treated first for efficiency
     if (s.sommet==at_plus){
@@ -518,6 +541,9 @@ namespace giac {
     return w;
   }
 
+  // current derive memo, param is the variable, see dag_memo
+  static GIAC_THREAD_LOCAL dag_memo * derive_memo=0;
+
   gen derive(const gen & e,const identificateur & i,GIAC_CONTEXT){
     if (is_undef(e) || is_inequation(e))
       return undef;
@@ -530,6 +556,10 @@ namespace giac {
       ee=subst(ee,tmp,i,true,contextptr);
       return ee;
     }
+    if ((e.type==_SYMB || e.type==_VECT) && (!derive_memo || derive_memo->param!=&i)){
+      dag_memo memo(derive_memo,&i,0),dmemo(depend_memo,&i,0);
+      return derive(e,i,contextptr);
+    }
     switch (e.type){
     case _INT_: case _DOUBLE_: case _ZINT: case _CPLX: case _MOD: case _REAL: case _USER: case _FLOAT_:
       return 0;
@@ -540,8 +570,15 @@ namespace giac {
 	return 1;
       else
 	return 0;
-    case _SYMB:
-      return derive_SYMB(e,i,contextptr);
+    case _SYMB: {
+      if (!dag_memo::shared(e))
+	return derive_SYMB(e,i,contextptr);
+      if (const gen * ptr=derive_memo->find(e))
+	return *ptr;
+      gen res=derive_SYMB(e,i,contextptr);
+      derive_memo->insert(e,res);
+      return res;
+    }
     case _VECT: {
       gen res=derive_VECT(*e._VECTptr,i,contextptr);
       if (res.type==_VECT) res.subtype=e.subtype;
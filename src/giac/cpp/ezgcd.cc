@@ -1421,6 +1421,7 @@ namespace giac {
   // is_sqff is true if we know that F_orig or G_orig is squarefree
   // is_primitive is true if F_orig and G_orig is primitive
   bool ezgcd(const polynome & F_orig,const polynome & G_orig,polynome & GCD,bool is_sqff,bool is_primitive,int max_gcddeg,double maxop){
+    perf_add(PERF_GCD_EZ);
     if (debug_infolevel)
       CERR << "// Starting EZGCD dimension " << F_orig.dim << '\n';
     if (F_orig.dim<2){
@@ -135,15 +135,15 @@ namespace giac {
 void* operator new(std::size_t size){
   void * p =  std::malloc(size);
   if ((size_t) p > (size_t) _stack_end)
-    giac::ctrl_c=giac::interrupted=true;
+    ctrl_c=interrupted=true;
   return p;
 }
   
 void* operator new[](std::size_t size){
-  // if ( (0x20038000-(size_t)sbrk(0))<2*size) giac::ctrl_c=giac::interrupted=true;
+  // if ( (0x20038000-(size_t)sbrk(0))<2*size) ctrl_c=interrupted=true;
   void * p =  std::malloc(size);  
   if ((size_t) p > (size_t) _stack_end)
-    giac::ctrl_c=giac::interrupted=true;
+    ctrl_c=interrupted=true;
   return p;
 }
   
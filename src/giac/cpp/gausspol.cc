@@ -1022,6 +1022,9 @@ namespace giac {
   // Fast multiplication using hash maps, might also use an int for reduction
   // but there is no garantee that res is smod-ed modulo reduce
   void mulpoly(const polynome & th, const polynome & other,polynome & res,const gen & reduce){
+    perf_timer timer(PERF_TIME_MULT);
+    if (timer.outer())
+      perf_mult(double(th.coord.size())*other.coord.size());
 #ifdef TIMEOUT
     control_c();
 #endif
@@ -3879,7 +3882,7 @@ namespace giac {
       d=smod(currentgcd,productmodulo);
       ppz(d);
       //if ( pp.TDivRem1(d,p_simp,rem) && rem.coord.empty() && qq.TDivRem1(d,q_simp,rem) && rem.coord.empty() ){
-      if ( divrem1(pp,d,p_simp,rem) && rem.coord.empty() && divrem1(qq,d,q_simp,rem) && rem.coord.empty() ){
+      if ( divrem1(pp,d,p_simp,rem,-4) && rem.coord.empty() && divrem1(qq,d,q_simp,rem,-4) && rem.coord.empty() ){
 	p=p_simp*(plgcd/gcdlgcd);
 	q=q_simp*(qlgcd/gcdlgcd);
 	d=d*gcdlgcd;
@@ -4707,11 +4710,13 @@ namespace giac {
   }
 
   bool gcdheu(const polynome &p_orig,const polynome &q_orig, polynome & p_simp, gen & np_simp, polynome & q_simp, gen & nq_simp, polynome & d, gen & d_content,bool skip_test,bool compute_cofactors){
+    perf_add(PERF_GCD_HEU);
     index_t pdeg=p_orig.degree(),qdeg=q_orig.degree();
     return gcdheu(p_orig,pdeg,q_orig,qdeg,p_simp,np_simp,q_simp,nq_simp,d,d_content,skip_test,compute_cofactors);
   }
 
   polynome gcdpsr(const polynome &p,const polynome &q,int gcddeg){
+    perf_add(PERF_GCD_PSR);
     if (is_undef(p) || is_undef(q))
       return polynome( monomial<gen>(1,p.dim));
     if (has_num_coeff(p) || has_num_coeff(q))
@@ -5179,6 +5184,8 @@ namespace giac {
   }
 
   void gcd(const polynome & p,const polynome & q,polynome & d){
+    perf_timer timer(PERF_TIME_GCD);
+    trace_scope scope("gcd");
 #ifdef TIMEOUT
     control_c();
 #endif
@@ -7299,6 +7306,7 @@ namespace giac {
   };
 
   bool factor(const polynome &p,polynome & p_content,factorization & f,bool isprimitive,bool with_sqrt,bool complexmode,const gen & divide_an_by,gen & extra_div){
+    perf_timer timer(PERF_TIME_FACTOR);
     bool res=do_factor(p,p_content,f,isprimitive,with_sqrt,complexmode,divide_an_by,extra_div);
 #if 1 // ndef EMCC // does not work for emscripten, don't know why...
     // sort f
@@ -80,6 +80,15 @@ extern "C" uint32_t mainThreadStack[];
 #ifdef HAVE_PTHREAD_H
 #include <pthread.h>
 #endif
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+#ifdef GIAC_SLAB_ALLOC
+#include <atomic>
+#endif
+#ifdef GIAC_HASHCONS
+#include <unordered_map>
+#endif
 
 #ifdef EMCC_BIND
 #include <emscripten/bind.h>  
@@ -346,6 +355,651 @@ namespace giac {
   }
 #endif // ALLOCSMALL
 
+#ifdef GIAC_SLAB_ALLOC
+  // Each thread allocates ref_symbolic, ref_vecteur, ref_complex and
+  // ref_mpz_t from its own pool: one free list per size class (multiples
+  // of 8 bytes up to SLAB_MAXSIZE), refilled from 64K chunks aligned on
+  // their size. The chunk header records the owner pool, a block freed by
+  // another thread is pushed on the owner remote list and reclaimed by the
+  // owner when its free list is empty. A free list may hold blocks of any
+  // pool: the freeing thread takes the block and the whole remote list if
+  // the owner has exited or has not reclaimed SLAB_REMOTE_MAX blocks, an
+  // exiting thread moves its remote lists to its free lists. The pool of a
+  // terminated thread is adopted by the next new thread, chunks are never
+  // returned to the system.
+  const size_t SLAB_MAXSIZE=64;
+  const size_t SLAB_CHUNK=1<<16;
+  const int SLAB_CLASSES=SLAB_MAXSIZE/8;
+  const unsigned SLAB_REMOTE_MAX=1024;
+
+  struct slab_block {
+    slab_block * next;
+  };
+
+  struct slab_pool {
+    slab_block * free_list[SLAB_CLASSES];
+    char * bump[SLAB_CLASSES], * bump_end[SLAB_CLASSES];
+    std::atomic<slab_block *> remote[SLAB_CLASSES];
+    std::atomic<unsigned> remote_count[SLAB_CLASSES]; // approximate
+    std::atomic<bool> in_use; // written under slab_mutex
+    slab_pool * next;
+    size_t chunks;
+    ulonglong allocated,freed,remote_freed;
+    slab_pool():in_use(false),next(0),chunks(0),allocated(0),freed(0),remote_freed(0) {
+      for (int c=0;c<SLAB_CLASSES;++c){
+	free_list[c]=0;
+	bump[c]=bump_end[c]=0;
+	remote[c]=0;
+	remote_count[c]=0;
+      }
+    }
+    // move the remote list of class c to the free list of this pool
+    void take_remote(slab_pool * p,int c){
+      slab_block * b=p->remote[c].exchange(0,std::memory_order_acquire);
+      p->remote_count[c].store(0,std::memory_order_relaxed);
+      while (b){
+	slab_block * n=b->next;
+	b->next=free_list[c];
+	free_list[c]=b;
+	b=n;
+      }
+    }
+  };
+
+  struct eval_arena_t;
+
+  // header of a chunk, the size keeps blocks 64 bytes aligned
+  struct slab_chunk {
+    slab_pool * owner;
+    eval_arena_t * arena; // 0 for pool chunks
+    char * end; // arena chunks: end of the allocated blocks
+    char pad[SLAB_MAXSIZE-3*sizeof(void *)];
+  };
+
+  static slab_pool * slab_pools=0;
+  static pthread_mutex_t slab_mutex=PTHREAD_MUTEX_INITIALIZER;
+  static GIAC_THREAD_LOCAL slab_pool * slab_current=0;
+  static GIAC_THREAD_LOCAL bool slab_exited=false;
+
+  // gives the pool of the current thread back on thread exit
+  struct slab_release {
+    bool active;
+    ~slab_release(){
+      if (!slab_current)
+	return;
+      for (int c=0;c<SLAB_CLASSES;++c)
+	slab_current->take_remote(slab_current,c);
+      pthread_mutex_lock(&slab_mutex);
+      slab_current->in_use=false;
+      pthread_mutex_unlock(&slab_mutex);
+      slab_current=0;
+      slab_exited=true;
+    }
+  };
+  static GIAC_THREAD_LOCAL slab_release slab_releaser;
+
+  static slab_pool * slab_acquire(){
+    pthread_mutex_lock(&slab_mutex);
+    slab_pool * p=slab_pools;
+    for (;p;p=p->next){
+      if (!p->in_use)
+	break;
+    }
+    if (!p){
+      p=new slab_pool;
+      p->next=slab_pools;
+      slab_pools=p;
+    }
+    p->in_use=true;
+    pthread_mutex_unlock(&slab_mutex);
+    slab_current=p;
+    // after thread exit cleanup the pool stays in use
+    if (!slab_exited)
+      slab_releaser.active=true;
+    return p;
+  }
+
+  static void * slab_carve(slab_pool * p,int c){
+    size_t size=8*(c+1);
+    if (size_t(p->bump_end[c]-p->bump[c])<size){
+      void * chunk=0;
+      if (posix_memalign(&chunk,SLAB_CHUNK,SLAB_CHUNK))
+	throw std::bad_alloc();
+      ((slab_chunk *) chunk)->owner=p;
+      ((slab_chunk *) chunk)->arena=0;
+      p->bump[c]=(char *) chunk+sizeof(slab_chunk);
+      p->bump_end[c]=(char *) chunk+SLAB_CHUNK;
+      ++p->chunks;
+    }
+    void * res=p->bump[c];
+    p->bump[c] += size;
+    return res;
+  }
+
+  // Evaluation arenas (see eval_arena in gen.h). Objects are preceded by
+  // an arena_block header and carved from 64K chunks marked with the
+  // arena. An object deleted while the arena is open is destroyed as
+  // usual and marked dead, its block is reused by the arena if the owner
+  // thread deleted it. At release, the chunks are walked: an object with
+  // more references than references from arena objects is referenced
+  // from outside and is kept with its arena descendants, the others are
+  // destroyed without recursion (references between them are just
+  // forgotten). Destroying them may free outside objects that held kept
+  // ones, the walk is repeated until nothing changes. Chunks without kept
+  // objects are recycled for the next arenas, the others become chunks
+  // of the pool of the releasing thread, their free space is cut into
+  // free list blocks. Only the owner thread dereferences the arena.
+  struct arena_block {
+    unsigned char type,state;
+    unsigned short size; // with the header
+    unsigned count; // references from arena objects
+  };
+  enum { ARENA_LIVE=1,ARENA_KEEP=2,ARENA_DEAD=3 }; // arena_block::state
+  const size_t ARENA_MAXSIZE=size_t(1)<<30; // then allocate from the pool
+  const size_t ARENA_FREECHUNKS=256;
+  const int ARENA_CLASSES=(sizeof(arena_block)+SLAB_MAXSIZE)/8+1;
+
+  struct eval_arena_t {
+    vector<slab_chunk *> chunks;
+    char * bump,* bump_end;
+    slab_block * free_list[ARENA_CLASSES]; // dead blocks by size/8
+    bool full;
+    ulonglong objects,reused;
+    eval_arena_t():bump(0),bump_end(0),full(false),objects(0),reused(0) {
+      for (int c=0;c<ARENA_CLASSES;++c)
+	free_list[c]=0;
+    }
+  };
+
+  static GIAC_THREAD_LOCAL eval_arena_t * arena_current=0;
+  static bool arena_on=false;
+  // protected by slab_mutex
+  static vector<slab_chunk *> arena_freechunks;
+  static ulonglong arena_count=0,arena_objects=0,arena_reused=0,arena_released=0,arena_kept=0,arena_pooledchunks=0;
+  static double arena_time=0;
+
+  static void * arena_alloc(eval_arena_t * a,size_t size,int t){
+    size=sizeof(arena_block)+((size+7) & ~size_t(7));
+    slab_block * f=a->free_list[size/8];
+    if (f){
+      a->free_list[size/8]=f->next;
+      arena_block * b=(arena_block *) f-1;
+      b->type=t;
+      b->state=ARENA_LIVE;
+      b->count=0;
+      ++a->reused;
+      return f;
+    }
+    if (size_t(a->bump_end-a->bump)<size){
+      if (a->full || a->chunks.size()*SLAB_CHUNK>=ARENA_MAXSIZE){
+	a->full=true;
+	return 0;
+      }
+      if (!a->chunks.empty())
+	a->chunks.back()->end=a->bump;
+      slab_chunk * ch=0;
+      pthread_mutex_lock(&slab_mutex);
+      if (!arena_freechunks.empty()){
+	ch=arena_freechunks.back();
+	arena_freechunks.pop_back();
+      }
+      pthread_mutex_unlock(&slab_mutex);
+      if (!ch && posix_memalign((void **) &ch,SLAB_CHUNK,SLAB_CHUNK))
+	throw std::bad_alloc();
+      ch->owner=0;
+      ch->arena=a;
+      ch->end=0;
+      a->chunks.push_back(ch);
+      a->bump=(char *) ch+sizeof(slab_chunk);
+      a->bump_end=(char *) ch+SLAB_CHUNK;
+    }
+    arena_block * b=(arena_block *) a->bump;
+    a->bump += size;
+    b->type=t;
+    b->state=ARENA_LIVE;
+    b->size=(unsigned short) size;
+    b->count=0;
+    ++a->objects;
+    return b+1;
+  }
+
+  // slab_mutex locked
+  static void arena_chunk_free(slab_chunk * ch){
+    if (arena_freechunks.size()<ARENA_FREECHUNKS)
+      arena_freechunks.push_back(ch);
+    else
+      free(ch);
+  }
+
+  // ptr allocated in the arena a has been destroyed
+  static void arena_dead(eval_arena_t * a,void * ptr){
+    arena_block * b=(arena_block *) ptr-1;
+    b->state=ARENA_DEAD;
+    if (a!=arena_current)
+      return; // another thread or released arena: not reused
+    slab_block * f=(slab_block *) ptr;
+    f->next=a->free_list[b->size/8];
+    a->free_list[b->size/8]=f;
+  }
+
+  static inline void * arena_ptr(const gen & g){
+#ifdef SMARTPTR64
+    return (void *) (* ((ulonglong * ) &g) >> 16);
+#else
+    return g.__ZINTptr;
+#endif
+  }
+
+  static inline bool arena_type(int t){
+    return t==_ZINT || t==_VECT || t==_CPLX || t==_SYMB;
+  }
+
+  // header of g if g is an object of a
+  static arena_block * arena_of(const gen & g,eval_arena_t * a){
+    if (!arena_type(g.type))
+      return 0;
+    void * ptr=arena_ptr(g);
+    if (!ptr || ((ref_mpz_t *) ptr)->ref_count==-1) // static objects
+      return 0;
+    return ((slab_chunk *) ((size_t) ptr & ~(SLAB_CHUNK-1)))->arena==a?(arena_block *) ptr-1:0;
+  }
+
+  static inline volatile ref_count_t & arena_refcount(arena_block * b){
+    return ((ref_mpz_t *) (b+1))->ref_count;
+  }
+
+  // gens of the object of b in [it,end[
+  static gen * arena_gens(arena_block * b,gen * & end){
+    void * obj=b+1;
+    gen * it=0;
+    switch (b->type){
+    case _VECT: {
+      vecteur & v=((ref_vecteur *) obj)->v;
+      if (!v.empty()){
+	it=&v.front();
+	end=it+v.size();
+	return it;
+      }
+      break;
+    }
+    case _CPLX: {
+      ref_complex * c=(ref_complex *) obj;
+      it=&c->re<&c->im?&c->re:&c->im;
+      end=it+2;
+      return it;
+    }
+    case _SYMB:
+      it=&((ref_symbolic *) obj)->s.feuille;
+      end=it+1;
+      return it;
+    }
+    end=0;
+    return 0;
+  }
+
+  // g becomes 0 without releasing its reference
+  static inline void arena_forget(gen & g){
+#ifdef SMARTPTR64
+    * ((ulonglong *) &g)=0;
+#else
+    g.type=_INT_;
+    g.subtype=0;
+    g.val=0;
+#endif
+  }
+
+  static void arena_destroy(arena_block * b){
+    void * obj=b+1;
+    switch (b->type){
+    case _ZINT:
+      ((ref_mpz_t *) obj)->~ref_mpz_t();
+      break;
+    case _VECT:
+      ((ref_vecteur *) obj)->~ref_vecteur();
+      break;
+    case _CPLX:
+      ((ref_complex *) obj)->~ref_complex();
+      break;
+    case _SYMB:
+      ((ref_symbolic *) obj)->~ref_symbolic();
+      break;
+    }
+    memory_release(b->size-sizeof(arena_block));
+    b->state=ARENA_DEAD;
+  }
+
+#define ARENA_FOR_BLOCKS(a,b) \
+  for (size_t arena_i=0;arena_i<(a)->chunks.size();++arena_i) \
+    for (char * arena_p=(char *) (a)->chunks[arena_i]+sizeof(slab_chunk),* arena_end=(a)->chunks[arena_i]->end;arena_p<arena_end;arena_p+=b->size) \
+      if ((b=(arena_block *) arena_p)->state!=ARENA_DEAD)
+
+  // chunk ch of a released arena with kept objects joins the pool of the
+  // current thread, dead blocks and the unused end are cut into free list
+  // blocks (the arena header of kept objects is lost when they are freed)
+  static void arena_chunk_to_pool(slab_chunk * ch){
+    slab_pool * p=slab_current;
+    if (!p)
+      p=slab_acquire();
+    ch->owner=p;
+    ++p->chunks;
+    char * it=(char *) ch+sizeof(slab_chunk),* end=(char *) ch+SLAB_CHUNK;
+    while (it<end){
+      char * jt=it;
+      while (jt<ch->end && ((arena_block *) jt)->state==ARENA_DEAD)
+	jt += ((arena_block *) jt)->size;
+      if (jt>=ch->end)
+	jt=end;
+      // cut [it,jt[ into blocks of the largest class
+      while (jt-it>=8){
+	int c=std::min(int(jt-it)/8,SLAB_CLASSES)-1;
+	slab_block * b=(slab_block *) it;
+	b->next=p->free_list[c];
+	p->free_list[c]=b;
+	it += 8*(c+1);
+      }
+      if (jt>=end)
+	break;
+      it=jt+((arena_block *) jt)->size; // skip a kept object
+    }
+    // from now on, frees of kept objects go to the pool
+    __atomic_store_n(&ch->arena,(eval_arena_t *) 0,__ATOMIC_RELEASE);
+  }
+
+  static void arena_release(eval_arena_t * a){
+    double t0=CLOCK();
+    if (!a->chunks.empty())
+      a->chunks.back()->end=a->bump;
+    arena_block * b;
+    gen * it,* itend;
+    vector<arena_block *> stack;
+    ulonglong released=0;
+    for (;;){
+      // count references between arena objects
+      ARENA_FOR_BLOCKS(a,b)
+	b->count=0;
+      ARENA_FOR_BLOCKS(a,b){
+	for (it=arena_gens(b,itend);it!=itend;++it){
+	  arena_block * c=arena_of(*it,a);
+	  if (c)
+	    ++c->count;
+	}
+      }
+      // objects referenced from outside and their descendants are kept
+      size_t kept=0,destroyed=0;
+      ARENA_FOR_BLOCKS(a,b){
+	ref_count_t rc=arena_refcount(b);
+#ifdef GIAC_ATOMIC_REFCOUNT
+	rc &= ~ref_count_shared_bit<ref_count_t>();
+#endif
+	if (b->state==ARENA_LIVE && rc>ref_count_t(b->count)){
+	  b->state=ARENA_KEEP;
+	  stack.push_back(b);
+	}
+	while (!stack.empty()){
+	  arena_block * c=stack.back();
+	  stack.pop_back();
+	  ++kept;
+	  for (it=arena_gens(c,itend);it!=itend;++it){
+	    arena_block * d=arena_of(*it,a);
+	    if (d && d->state==ARENA_LIVE){
+	      d->state=ARENA_KEEP;
+	      stack.push_back(d);
+	    }
+	  }
+	}
+      }
+      // destroy the others
+      ARENA_FOR_BLOCKS(a,b){
+	if (b->state==ARENA_KEEP)
+	  continue;
+	for (it=arena_gens(b,itend);it!=itend;++it){
+	  arena_block * c=arena_of(*it,a);
+	  if (!c)
+	    continue;
+	  if (c->state==ARENA_KEEP)
+	    ref_count_decr(&arena_refcount(c));
+	  arena_forget(*it);
+	}
+	arena_destroy(b);
+	++destroyed;
+      }
+      released += destroyed;
+      ARENA_FOR_BLOCKS(a,b)
+	b->state=ARENA_LIVE;
+      if (!kept || !destroyed)
+	break;
+    }
+    // recycle chunks without live objects, the others join the pool
+    ulonglong kept=0,pooled=0;
+    for (size_t i=0;i<a->chunks.size();++i){
+      slab_chunk * ch=a->chunks[i];
+      long live=0;
+      for (char * p=(char *) ch+sizeof(slab_chunk);p<ch->end;p+=b->size){
+	b=(arena_block *) p;
+	if (b->state==ARENA_LIVE)
+	  ++live;
+      }
+      if (live){
+	kept += live;
+	++pooled;
+	arena_chunk_to_pool(ch);
+      }
+      else {
+	pthread_mutex_lock(&slab_mutex);
+	arena_chunk_free(ch);
+	pthread_mutex_unlock(&slab_mutex);
+      }
+    }
+    pthread_mutex_lock(&slab_mutex);
+    arena_objects += a->objects;
+    arena_reused += a->reused;
+    arena_released += released;
+    arena_kept += kept;
+    arena_pooledchunks += pooled;
+    arena_time += CLOCK()-t0;
+    pthread_mutex_unlock(&slab_mutex);
+    delete a;
+  }
+#undef ARENA_FOR_BLOCKS
+
+  static gen arena_copy(const gen & g,eval_arena_t * a,bool & changed){
+    changed=false;
+    bool in=arena_of(g,a)!=0;
+    switch (g.type){
+    case _ZINT:
+      if (!in)
+	return g;
+      changed=true;
+      return gen(*g._ZINTptr);
+    case _CPLX: {
+      bool c1,c2;
+      gen r=arena_copy(*g._CPLXptr,a,c1),i=arena_copy(*(g._CPLXptr+1),a,c2);
+      if (!in && !c1 && !c2)
+	return g;
+      gen res(r,i);
+      if (res.type!=_CPLX) // kept in the arena
+	return g;
+      ((ref_complex *) arena_ptr(res))->display=((ref_complex *) arena_ptr(g))->display;
+      changed=true;
+      return res;
+    }
+    case _VECT: {
+      const vecteur & v=*g._VECTptr;
+      vecteur w;
+      bool c;
+      for (size_t i=0;i<v.size();++i){
+	gen gi=arena_copy(v[i],a,c);
+	if ((c || in) && w.empty()){
+	  w.reserve(v.size());
+	  for (size_t j=0;j<i;++j)
+	    w.push_back(v[j]);
+	}
+	if (c || in || !w.empty())
+	  w.push_back(gi);
+      }
+      if (!in && w.empty())
+	return g;
+      changed=true;
+      return gen(w,g.subtype);
+    }
+    case _SYMB: {
+      bool c;
+      gen f=arena_copy(g._SYMBptr->feuille,a,c);
+      if (!in && !c)
+	return g;
+      gen res=symbolic(g._SYMBptr->sommet,f);
+      res.subtype=g.subtype;
+      changed=true;
+      return res;
+    }
+    case _FRAC: {
+      bool c1,c2;
+      gen n=arena_copy(g._FRACptr->num,a,c1),d=arena_copy(g._FRACptr->den,a,c2);
+      if (!c1 && !c2)
+	return g;
+      changed=true;
+      return gen(fraction(n,d));
+    }
+    }
+    return g;
+  }
+
+  eval_arena::eval_arena():a(0){
+    if (!arena_on || arena_current)
+      return;
+    eval_arena_t * ar=new eval_arena_t;
+    pthread_mutex_lock(&slab_mutex);
+    ++arena_count;
+    pthread_mutex_unlock(&slab_mutex);
+    arena_current=ar;
+    a=ar;
+  }
+
+  eval_arena::~eval_arena(){
+    if (!a)
+      return;
+    arena_current=0;
+    arena_release((eval_arena_t *) a);
+  }
+
+  gen eval_arena::keep(const gen & g){
+    if (!a)
+      return g;
+    // copies are allocated from the pool
+    arena_current=0;
+    bool changed;
+    gen res=arena_copy(g,(eval_arena_t *) a,changed);
+    arena_current=(eval_arena_t *) a;
+    return res;
+  }
+
+  void arena_eval(bool on){
+    arena_on=on;
+  }
+
+  bool arena_eval(){
+    return arena_on;
+  }
+
+  string arena_stats(){
+    pthread_mutex_lock(&slab_mutex);
+    string s="Arena "+string(arena_on?"on":"off")+", evaluations "+print_INT_(int(arena_count))+", objects "+gen(longlong(arena_objects)).print()+", reused "+gen(longlong(arena_reused)).print()+", released "+gen(longlong(arena_released)).print()+", kept "+gen(longlong(arena_kept)).print()+", chunks to pool "+gen(longlong(arena_pooledchunks)).print()+", release time "+print_DOUBLE_(arena_time/CLOCKS_PER_SEC,context0)+"s";
+    pthread_mutex_unlock(&slab_mutex);
+    return s;
+  }
+
+  void * slab_alloc(size_t size,int t){
+    memory_charge(size);
+    perf_add(PERF_ALLOC+t);
+    if (size>SLAB_MAXSIZE)
+      return ::operator new(size);
+    eval_arena_t * a=arena_current;
+    if (a){
+      void * res=arena_alloc(a,size,t);
+      if (res)
+	return res;
+    }
+    slab_pool * p=slab_current;
+    if (!p)
+      p=slab_acquire();
+    int c=int(size-1)/8;
+    ++p->allocated;
+    slab_block * b=p->free_list[c];
+    if (!b){
+      p->take_remote(p,c);
+      b=p->free_list[c];
+      if (!b)
+	return slab_carve(p,c);
+    }
+    p->free_list[c]=b->next;
+    return b;
+  }
+
+  void slab_free(void * ptr,size_t size){
+    if (!ptr)
+      return;
+    memory_release(size);
+    if (size>SLAB_MAXSIZE){
+      ::operator delete(ptr);
+      return;
+    }
+    int c=int(size-1)/8;
+    slab_block * b=(slab_block *) ptr;
+    slab_chunk * ch=(slab_chunk *) ((size_t) ptr & ~(SLAB_CHUNK-1));
+    eval_arena_t * a=__atomic_load_n(&ch->arena,__ATOMIC_ACQUIRE);
+    if (a){
+      arena_dead(a,ptr);
+      return;
+    }
+    slab_pool * p=ch->owner,* q=slab_current;
+    if (p==q){
+      b->next=p->free_list[c];
+      p->free_list[c]=b;
+      ++p->freed;
+      return;
+    }
+    if (q){
+      ++q->remote_freed;
+      // the owner will not reclaim them (soon): keep them here
+      if (!p->in_use.load(std::memory_order_relaxed) || p->remote_count[c].load(std::memory_order_relaxed)>=SLAB_REMOTE_MAX){
+	b->next=q->free_list[c];
+	q->free_list[c]=b;
+	q->take_remote(p,c);
+	return;
+      }
+    }
+    b->next=p->remote[c].load(std::memory_order_relaxed);
+    while (!p->remote[c].compare_exchange_weak(b->next,b,std::memory_order_release,std::memory_order_relaxed))
+      ;
+    p->remote_count[c].fetch_add(1,std::memory_order_relaxed);
+  }
+
+  void slab_stats(slab_statistics & s){
+    memset(&s,0,sizeof(s));
+    pthread_mutex_lock(&slab_mutex);
+    for (slab_pool * p=slab_pools;p;p=p->next){
+      ++s.pools;
+      s.chunks += p->chunks;
+      s.allocated += p->allocated;
+      s.freed += p->freed;
+      s.remote_freed += p->remote_freed;
+    }
+    pthread_mutex_unlock(&slab_mutex);
+    s.bytes=s.chunks*SLAB_CHUNK;
+  }
+#else // GIAC_SLAB_ALLOC
+  void slab_stats(slab_statistics & s){
+    memset(&s,0,sizeof(s));
+  }
+
+  eval_arena::eval_arena():a(0){}
+  eval_arena::~eval_arena(){}
+  gen eval_arena::keep(const gen & g){ return g; }
+  void arena_eval(bool on){}
+  bool arena_eval(){ return false; }
+  string arena_stats(){ return "Arena not available"; }
+#endif // GIAC_SLAB_ALLOC
+
 
 
 #if defined(SMARTPTR64) || !defined(ALLOCSMALL)
@@ -764,6 +1418,10 @@ namespace giac {
       type =_ZINT;
       subtype=0;
       // convert longlong to mpz_t
+      if (sizeof(long)==sizeof(longlong)){
+	mpz_set_si(*_ZINTptr,long(i));
+	return;
+      }
       bool signe=(i<0);
       if (signe)
 	i=-i;
@@ -1357,7 +2015,7 @@ namespace giac {
 	  ){
 	ref_count_t * rc=(ref_count_t *)&e.ref_count();
 	if (*rc!=-1)
-	  ++(*rc);
+	  ref_count_incr(rc);
       }
     }
 #ifdef DOUBLEVAL
@@ -1809,7 +2467,7 @@ namespace giac {
 #if 0 // def COMPILE_FOR_STABILITY // commented (D.Alm) The call to delete_ptr() would sometimes get cancelled if ctrl_c was being set, which could cause the "Stopped by user interruption." exception somehow to be fired twice, with the second time not being caught properly by my exception handling code.
     control_c();
 #endif
-    if (ptr_save && type_save!=_FLOAT_&& ptr_save->ref_count!=-1 && !--(ptr_save->ref_count)){
+    if (ptr_save && type_save!=_FLOAT_&& ptr_save->ref_count!=-1 && ref_count_decr(&ptr_save->ref_count)){
       switch (type_save) {
       case _ZINT: 
 	delete ptr_save;
@@ -1892,6 +2550,89 @@ namespace giac {
     }
   }
 
+
+  void publish_gen(const gen & g){
+#ifdef GIAC_ATOMIC_REFCOUNT
+    if (g.type<=_DOUBLE_ || g.type==_FLOAT_ || !g.__ZINTptr)
+      return;
+#ifndef SMARTPTR64
+    if (g.type==_FUNC) // not reference counted
+      return;
+#endif
+    ref_count_t * rc=(ref_count_t *) &g.ref_count();
+    if (*rc==-1 || (*rc & ref_count_shared_bit<ref_count_t>()))
+      return;
+    *rc |= ref_count_shared_bit<ref_count_t>();
+    switch (g.type){
+    case _CPLX:
+      publish_gen(*g._CPLXptr);
+      publish_gen(*(g._CPLXptr+1));
+      break;
+    case _VECT: {
+      const_iterateur it=g._VECTptr->begin(),itend=g._VECTptr->end();
+      for (;it!=itend;++it)
+	publish_gen(*it);
+      break;
+    }
+    case _SYMB:
+      publish_gen(g._SYMBptr->feuille);
+      break;
+    case _FRAC:
+      publish_gen(g._FRACptr->num);
+      publish_gen(g._FRACptr->den);
+      break;
+    case _MOD:
+      publish_gen(*g._MODptr);
+      publish_gen(*(g._MODptr+1));
+      break;
+    case _EXT:
+      publish_gen(g.__EXTptr->P);
+      publish_gen(g.__EXTptr->Pmin);
+      publish_gen(g.__EXTptr->additional);
+      break;
+    case _POLY: {
+      vector< monomial<gen> >::const_iterator it=g._POLYptr->coord.begin(),itend=g._POLYptr->coord.end();
+      for (;it!=itend;++it){
+	it->index.publish();
+	publish_gen(it->value);
+      }
+      break;
+    }
+    case _SPOL1: {
+      sparse_poly1::const_iterator it=g._SPOL1ptr->begin(),itend=g._SPOL1ptr->end();
+      for (;it!=itend;++it){
+	publish_gen(it->coeff);
+	publish_gen(it->exponent);
+      }
+      break;
+    }
+    case _MAP: {
+      gen_map::const_iterator it=g._MAPptr->begin(),itend=g._MAPptr->end();
+      for (;it!=itend;++it){
+	publish_gen(it->first);
+	publish_gen(it->second);
+      }
+      break;
+    }
+    case _IDNT: {
+      int * ptr=g._IDNTptr->ref_count_ptr;
+      if (ptr && *ptr!=-1)
+	*ptr |= ref_count_shared_bit<int>();
+      break;
+    }
+    }
+#endif
+  }
+
+  bool is_published(const gen & g){
+#ifdef GIAC_ATOMIC_REFCOUNT
+    if (g.type<=_DOUBLE_ || g.type==_FLOAT_ || g.type==_FUNC || !g.__ZINTptr)
+      return false;
+    return g.ref_count()!=-1 && (g.ref_count() & ref_count_shared_bit<ref_count_t>());
+#else
+    return false;
+#endif
+  }
   
   double gen::to_double(GIAC_CONTEXT) const {
     if (type==_DOUBLE_)
@@ -2544,6 +3285,9 @@ namespace giac {
   }
 
 
+  // current evalf memo, param is the context, iparam level and digits
+  static GIAC_THREAD_LOCAL dag_memo * evalf_memo=0;
+
   gen gen::evalf(int level,const context * contextptr) const{
     // CERR << "evalf " << *this << " " << level << '\n';
 #ifdef TIMEOUT
@@ -2555,6 +3299,22 @@ namespace giac {
     }
     if (level==0)
       return *this;
+    if (type==_SYMB || type==_VECT){
+      longlong ip=(longlong(level)<<32)+decimal_digits(contextptr);
+      if (!evalf_memo || evalf_memo->param!=contextptr || evalf_memo->iparam!=ip){
+	dag_memo memo(evalf_memo,contextptr,ip);
+	return evalf(level,contextptr);
+      }
+      if (dag_memo::shared(*this)){
+	if (const gen * ptr=evalf_memo->find(*this))
+	  return *ptr;
+	gen evaled;
+	if (!in_evalf(level,evaled,contextptr))
+	  evaled=*this;
+	evalf_memo->insert(*this,evaled);
+	return evaled;
+      }
+    }
     gen evaled;
     if (in_evalf(level,evaled,contextptr))
       return evaled;
@@ -4677,6 +5437,58 @@ namespace giac {
     return res._VECTptr->empty()?0:res;
   }
 
+#if defined INT128 && !defined USE_GMP_REPLACEMENTS && !defined BF2GMP_H && GMP_LIMB_BITS==64 && __GNU_MP_VERSION>=6
+#define ZINT_FASTPATH
+  // integers of at most 63 bits are handled with longlong/int128_t
+  // arithmetic, GMP is called only to store a large result
+  static inline bool zint2ll(const gen & g,longlong & i){
+    if (g.type==_INT_){
+      i=g.val;
+      return true;
+    }
+    const mpz_t & z=*g._ZINTptr;
+    if (mpz_size(z)>1)
+      return false;
+    ulonglong u=mpz_getlimbn(z,0);
+    if (u>>63)
+      return false;
+    i=mpz_sgn(z)<0?-longlong(u):longlong(u);
+    return true;
+  }
+
+  // |i|<2^127, returns an _INT_ if possible
+  static gen int1282gen(int128_t i){
+    if (i>-2147483648LL && i<2147483648LL)
+      return int(i);
+    bool neg=i<0;
+    uint128_t u=neg?-i:i;
+    ref_mpz_t * e=new ref_mpz_t(128);
+    mp_limb_t * d=mpz_limbs_write(e->z,2);
+    d[0]=mp_limb_t(u);
+    d[1]=mp_limb_t(u>>64);
+    int n=d[1]?2:1;
+    mpz_limbs_finish(e->z,neg?-n:n);
+    return e;
+  }
+#endif
+
+  // true if a+b or a-b may be computed inside a (same result as
+  // operator_plus): a is a list or matrix not shared, b has the same size
+  // and is not an element of a
+  static bool inplace_vect_ok(const gen & a,const gen & b,GIAC_CONTEXT){
+    if (a.type!=_VECT || b.type!=_VECT || a.subtype!=b.subtype || a.ref_count()!=1)
+      return false;
+    if (a.subtype!=0 && a.subtype!=_MATRIX__VECT)
+      return false;
+    const vecteur & av=*a._VECTptr;
+    const vecteur & bv=*b._VECTptr;
+    if (av.size()!=bv.size() || av.empty() || python_compat(contextptr) || (&b>=&av.front() && &b<=&av.back()))
+      return false;
+    if (a.subtype==_MATRIX__VECT)
+      return ckmatrix(av) && ckmatrix(bv) && av.front()._VECTptr->size()==bv.front()._VECTptr->size();
+    return true;
+  }
+
   gen & operator_plus_eq(gen &a,const gen & b,GIAC_CONTEXT){
 #if defined(EMCC) || defined(EMCC2)
     a=operator_plus(a,b,contextptr);
@@ -4734,6 +5546,10 @@ namespace giac {
       }
       return a;
     }
+    if (inplace_vect_ok(a,b,contextptr)){
+      addvecteur(*a._VECTptr,*b._VECTptr,*a._VECTptr);
+      return a;
+    }
     // if (!( (++control_c_counter) & control_c_counter_mask))
 #ifdef TIMEOUT
     control_c();
@@ -4765,6 +5581,13 @@ namespace giac {
     register ref_mpz_t * e;
     switch ( t ) {
     case _ZINT__ZINT:
+#ifdef ZINT_FASTPATH
+      {
+	longlong x,y;
+	if (zint2ll(a,x) && zint2ll(b,y))
+	  return int1282gen(int128_t(x)+y);
+      }
+#endif
       e =new ref_mpz_t;
       mpz_add(e->z,*a._ZINTptr,*b._ZINTptr);
       return e;
@@ -5540,6 +6363,10 @@ namespace giac {
       }
       return a;
     }
+    if (inplace_vect_ok(a,b,contextptr)){
+      subvecteur(*a._VECTptr,*b._VECTptr,*a._VECTptr);
+      return a;
+    }
     // if (!( (++control_c_counter) & control_c_counter_mask))
 #ifdef TIMEOUT
     control_c();
@@ -5563,6 +6390,13 @@ namespace giac {
     register ref_mpz_t * e;
     switch ( t) {
     case _ZINT__ZINT:
+#ifdef ZINT_FASTPATH
+      {
+	longlong x,y;
+	if (zint2ll(a,x) && zint2ll(b,y))
+	  return int1282gen(int128_t(x)-y);
+      }
+#endif
       e = new ref_mpz_t;
       mpz_sub(e->z,*a._ZINTptr,*b._ZINTptr);
       return e;
@@ -6312,6 +7146,13 @@ namespace giac {
     register ref_mpz_t * e;
     switch (t) {
     case _ZINT__ZINT:
+#ifdef ZINT_FASTPATH
+      {
+	longlong x,y;
+	if (zint2ll(a,x) && zint2ll(b,y))
+	  return int1282gen(int128_t(x)*y);
+      }
+#endif
       e=new ref_mpz_t(GIAC_MPZ_INIT_SIZE); // ((mpz_size(*b._ZINTptr)+mpz_size(*b._ZINTptr))*mp_bits_per_limb);
       mpz_mul(e->z,*a._ZINTptr,*b._ZINTptr);
       return e;
@@ -6713,19 +7554,54 @@ namespace giac {
     return operator_times(a,b,t,context0);
   }
 
-  bool has_i(const gen & g){
-    if (g.type==_CPLX)
-      return true;
-    if (g.type==_FRAC)
-      return g._FRACptr->num.type==_CPLX || g._FRACptr->den.type==_CPLX;
-    if (g.type==_VECT){
-      const_iterateur it=g._VECTptr->begin(),itend=g._VECTptr->end();
-      for (;it!=itend;++it){
-	if (has_i(*it))
-	  return true;
-      }
-      return false;
-    }
+  gen & operator_times_eq(gen & a,const gen & b,GIAC_CONTEXT){
+#if defined(EMCC) || defined(EMCC2)
+    a=operator_times(a,b,contextptr);
+    return a;
+#endif
+    if (a.type==_DOUBLE_ && b.type==_DOUBLE_){
+#ifdef DOUBLEVAL
+      a._DOUBLE_val *= b._DOUBLE_val; return a;
+#else
+      *((double *) &a) *= *((double *) &b);
+      a.type = _DOUBLE_;
+      return a;
+#endif
+    }
+    if (a.type==_ZINT && a.ref_count()==1 && (b.type==_ZINT || b.type==_INT_)){
+      mpz_t * ptr=a._ZINTptr;
+      if (b.type==_ZINT)
+	mpz_mul(*ptr,*ptr,*b._ZINTptr);
+      else
+	mpz_mul_si(*ptr,*ptr,b.val);
+      if (mpz_sizeinbase(*ptr,2)<32){
+	return a=mpz_get_si(*ptr);
+      }
+      return a;
+    }
+#ifdef TIMEOUT
+    control_c();
+#endif
+    if (ctrl_c || interrupted) { 
+      interrupted = true; ctrl_c=false;
+      return a=gensizeerr(gettext("Stopped by user interruption.")); 
+    }
+    return a=operator_times(a,b,contextptr);
+  }
+
+  bool has_i(const gen & g){
+    if (g.type==_CPLX)
+      return true;
+    if (g.type==_FRAC)
+      return g._FRACptr->num.type==_CPLX || g._FRACptr->den.type==_CPLX;
+    if (g.type==_VECT){
+      const_iterateur it=g._VECTptr->begin(),itend=g._VECTptr->end();
+      for (;it!=itend;++it){
+	if (has_i(*it))
+	  return true;
+      }
+      return false;
+    }
     if (g.type==_SPOL1){
       sparse_poly1::const_iterator it=g._SPOL1ptr->begin(),itend=g._SPOL1ptr->end();
       for (;it!=itend;++it){
@@ -7969,6 +8845,13 @@ namespace giac {
     case _INT___INT_: 
       return(a.val/b.val);
     case _ZINT__ZINT: case _INT___ZINT: case _ZINT__INT_:
+#ifdef ZINT_FASTPATH
+      {
+	longlong x,y;
+	if (zint2ll(a,x) && zint2ll(b,y))
+	  return x/y;
+      }
+#endif
       _ZINTdiv(a,b,quo);
       return quo;
     case _CPLX__INT_:  case _CPLX__ZINT:
@@ -8867,6 +9750,10 @@ namespace giac {
 	return true;
       if (a._SYMBptr->sommet!=b._SYMBptr->sommet)
 	return false;
+#ifdef GIAC_HASHCONS
+      if (hashcons_differ(a,b))
+	return false;
+#endif
       return (a._SYMBptr->feuille==b._SYMBptr->feuille);
     case _VECT__VECT:
       if (a._VECTptr==b._VECTptr)
@@ -9955,6 +10842,12 @@ namespace giac {
       return true;
     if (type != other.type)
       return type < other.type;
+#ifdef GIAC_HASHCONS
+    // shared nodes: same node or different structures, no tree walk
+    if (type==_SYMB && _SYMBptr==other._SYMBptr)
+      return false;
+    if (type!=_SYMB || !hashcons_differ(*this,other))
+#endif
     if (*this==other)
       return false;
     if (type<_POLY && type!=_CPLX && *this==-other)
@@ -11180,6 +12073,20 @@ namespace giac {
       else
 	return is_positive(a,contextptr)?a:-a;
     case _ZINT__ZINT: 
+#ifdef ZINT_FASTPATH
+      {
+	longlong x,y;
+	if (zint2ll(a,x) && zint2ll(b,y)){
+	  ulonglong u=x<0?-x:x,v=y<0?-y:y,r;
+	  while (v){
+	    r=u%v;
+	    u=v;
+	    v=r;
+	  }
+	  return longlong(u);
+	}
+      }
+#endif
 #if !defined USE_GMP_REPLACEMENTS && !defined BF2GMP_H
       {
 	int test=mpz_cmp(*a._ZINTptr,*b._ZINTptr);
@@ -11616,6 +12523,24 @@ namespace giac {
     case _INT___INT_: 
       return(invmod(a.val,modulo.val));
     case _INT___ZINT: case _ZINT__INT_: case _ZINT__ZINT:
+#ifdef ZINT_FASTPATH
+      {
+	longlong x,m;
+	if (zint2ll(a,x) && zint2ll(modulo,m) && (m=m<0?-m:m)>1){
+	  // r0=u0*x, r1=u1*x mod m, result in [0,m[ like mpz_invert
+	  longlong r0=m,r1=x%m,u0=0,u1=1,q,tmp;
+	  if (r1<0)
+	    r1+=m;
+	  while (r1){
+	    q=r0/r1;
+	    tmp=r0-q*r1; r0=r1; r1=tmp;
+	    tmp=u0-q*u1; u0=u1; u1=tmp;
+	  }
+	  if (r0==1)
+	    return u0<0?u0+m:u0;
+	}
+      }
+#endif
       if (!_ZINTinvmod(a,modulo,res))
 	return gentypeerr(gettext("invmod"));
       return gen(res);
@@ -12560,18 +13485,373 @@ namespace giac {
     return gen(new_ref_symbolic(symbolic(g._SYMBptr->sommet,aplatir_plus_only(g._SYMBptr->feuille)))).change_subtype(g.subtype);
   }
 
+#ifdef HAVE_LIBPTHREAD
+  static pthread_mutex_t parse_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+  // Parse cache, off by default, see parse_cache_size. Maps an input string
+  // and the context state used by the lexer to the parsed tree.
+  // Access is serialized by the parse mutex in protected_giac_yyparse.
+  struct parse_cache_entry {
+    string key;
+    gen g;
+  };
+  struct parse_cache_t {
+    size_t maxsize;
+    unsigned hits,misses;
+    list<parse_cache_entry> entries; // most recently used first
+    map<string,list<parse_cache_entry>::iterator> index;
+    parse_cache_t():maxsize(0),hits(0),misses(0){}
+  };
+  static parse_cache_t parse_cache;
+  static size_t parse_cache_maxlen=1<<16; // longer inputs are not cached
+
+  static string parse_cache_key(const string & s,GIAC_CONTEXT){
+    return print_INT_(xcas_mode(contextptr))+','+print_INT_(python_compat(contextptr))+','+print_INT_(language(contextptr))+','+print_INT_(abs_calc_mode(contextptr))+','+print_INT_(try_parse_i(contextptr))+print_INT_(i_sqrt_minus1(contextptr))+print_INT_(rpn_mode(contextptr))+'\n'+s;
+  }
+
+  // trees returned by the cache may be modified in place (e.g. by =<),
+  // therefore vectors, symbolics and strings are copied
+  static gen parse_cache_copy(const gen & g){
+    if (g.type==_STRNG){
+      gen res=string2gen(*g._STRNGptr,false);
+      res.subtype=g.subtype;
+      return res;
+    }
+    if (g.type==_VECT){
+      vecteur v(*g._VECTptr);
+      iterateur it=v.begin(),itend=v.end();
+      for (;it!=itend;++it)
+	*it=parse_cache_copy(*it);
+      return gen(v,g.subtype);
+    }
+    if (g.type==_SYMB){
+      gen res=symbolic(g._SYMBptr->sommet,parse_cache_copy(g._SYMBptr->feuille));
+      res.subtype=g.subtype;
+      return res;
+    }
+    return g;
+  }
+
+  void parse_cache_size(size_t n){
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&parse_mutex);
+#endif
+    parse_cache.maxsize=n;
+    parse_cache.hits=parse_cache.misses=0;
+    parse_cache.entries.clear();
+    parse_cache.index.clear();
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&parse_mutex);
+#endif
+  }
+
+  string parse_cache_stats(){
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&parse_mutex);
+#endif
+    string res="Parse cache hits "+print_INT_(parse_cache.hits)+", misses "+print_INT_(parse_cache.misses)+", entries "+print_INT_(parse_cache.entries.size())+"/"+print_INT_(parse_cache.maxsize);
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&parse_mutex);
+#endif
+    return res;
+  }
+
+#ifdef GIAC_HASHCONS
+  // Hash-consing table: structural hash -> shared symbolic nodes. The hash
+  // gives all numbers the same value and ignores vector subtypes (except
+  // lines and sets), hence nodes that are equal for operator== have the
+  // same hash. A node in the table carries its hash if it is exact (may be
+  // compared by hashcons_differ), i.e. if no subtree may compare equal to
+  // a different type (e.g. _USER or _FUNC leaves). The hash is cleared
+  // when the node leaves the table (it may then be modified in place by
+  // its last owner). Nodes are kept in least recently used order, the
+  // oldest are evicted when the table is full.
+  struct hashcons_entry {
+    gen g;
+    unsigned hash; // key in table
+  };
+  typedef list<hashcons_entry>::iterator hashcons_iterator;
+  struct hashcons_t {
+    list<hashcons_entry> lru; // most recently used first
+    map<unsigned,vector<hashcons_iterator> > table;
+    size_t size,maxsize;
+    unsigned hits,misses,evicted;
+    bool parsed; // read without lock by the parser
+    hashcons_t():size(0),maxsize(1<<18),hits(0),misses(0),evicted(0),parsed(false) {}
+    void clear(){
+      list<hashcons_entry>::iterator it=lru.begin(),itend=lru.end();
+      for (;it!=itend;++it)
+	__atomic_store_n(&it->g.__SYMBptr->hash,0u,__ATOMIC_RELAXED);
+      table.clear();
+      lru.clear();
+      size=0;
+    }
+    void evict(){
+      hashcons_entry & e=lru.back();
+      vector<hashcons_iterator> & bucket=table[e.hash];
+      for (size_t i=0;i<bucket.size();++i){
+	if (&*bucket[i]==&e){
+	  bucket.erase(bucket.begin()+i);
+	  break;
+	}
+      }
+      if (bucket.empty())
+	table.erase(e.hash);
+      __atomic_store_n(&e.g.__SYMBptr->hash,0u,__ATOMIC_RELAXED);
+      lru.pop_back();
+      --size;
+      ++evicted;
+    }
+  };
+  static hashcons_t hashcons_tab;
+#ifdef HAVE_LIBPTHREAD
+  // serializes hashcons and the table statistics, comparisons only read
+  // the hash of the nodes
+  static pthread_rwlock_t hashcons_lock = PTHREAD_RWLOCK_INITIALIZER;
+#endif
+
+  static unsigned hashcons_mix(unsigned h,unsigned x){
+    return (h ^ x)*16777619u+0x9e3779b9u;
+  }
+
+  static unsigned hashcons_string(const char * s,size_t l){
+    unsigned h=2166136261u;
+    for (size_t i=0;i<l;++i)
+      h=(h ^ (unsigned char) s[i])*16777619u;
+    return h;
+  }
+
+  // identical structure, subtrees of a and b are already shared
+  static bool hashcons_same(const gen & a,const gen & b){
+    if (a.type!=b.type || a.subtype!=b.subtype)
+      return false;
+    switch (a.type){
+    case _INT_:
+      return a.val==b.val;
+    case _DOUBLE_:
+      return memcmp(&a._DOUBLE_val,&b._DOUBLE_val,sizeof(double))==0;
+    case _ZINT:
+      return mpz_cmp(*a._ZINTptr,*b._ZINTptr)==0;
+    case _IDNT:
+      return a._IDNTptr->id_name==b._IDNTptr->id_name || !strcmp(a._IDNTptr->id_name,b._IDNTptr->id_name);
+    case _CPLX:
+      return hashcons_same(*a._CPLXptr,*b._CPLXptr) && hashcons_same(*(a._CPLXptr+1),*(b._CPLXptr+1));
+    case _FRAC:
+      return hashcons_same(a._FRACptr->num,b._FRACptr->num) && hashcons_same(a._FRACptr->den,b._FRACptr->den);
+    case _VECT: {
+      if (a._VECTptr->size()!=b._VECTptr->size())
+	return false;
+      const_iterateur it=a._VECTptr->begin(),itend=a._VECTptr->end(),jt=b._VECTptr->begin();
+      for (;it!=itend;++it,++jt){
+	if (!hashcons_same(*it,*jt))
+	  return false;
+      }
+      return true;
+    }
+    }
+    return a.__ZINTptr==b.__ZINTptr;
+  }
+
+  // h structural hash of g, exact: h may be compared by hashcons_differ,
+  // shared: g may be shared
+  static gen hashcons_rec(const gen & g,unsigned & h,bool & exact,bool & shared){
+    exact=shared=true;
+    switch (g.type){
+    case _INT_: case _DOUBLE_: case _ZINT: case _CPLX: case _FRAC:
+    case _REAL: case _FLOAT_: case _MOD:
+      h=1; // numbers of different types may be equal
+      shared=g.type!=_REAL && g.type!=_FLOAT_ && g.type!=_MOD;
+      return g;
+    case _IDNT:
+      h=hashcons_string(g._IDNTptr->id_name,strlen(g._IDNTptr->id_name));
+      return g;
+    case _STRNG:
+      h=hashcons_string(g._STRNGptr->c_str(),g._STRNGptr->size());
+      shared=false;
+      return g;
+    case _VECT: {
+      const vecteur & v=*g._VECTptr;
+      vecteur w;
+      h=hashcons_mix(2,unsigned(v.size()));
+      exact=g.subtype!=_LINE__VECT && g.subtype!=_SET__VECT;
+      shared=g.subtype==_SEQ__VECT;
+      for (size_t i=0;i<v.size();++i){
+	unsigned hi; bool ei,si;
+	gen gi=hashcons_rec(v[i],hi,ei,si);
+	h=hashcons_mix(h,hi);
+	exact=exact && ei;
+	shared=shared && si;
+	if (w.empty() && gi.__ZINTptr!=v[i].__ZINTptr){
+	  w.reserve(v.size());
+	  for (size_t j=0;j<i;++j)
+	    w.push_back(v[j]);
+	}
+	if (!w.empty())
+	  w.push_back(gi);
+      }
+      return w.empty()?g:gen(w,g.subtype);
+    }
+    case _SYMB: {
+      const symbolic & s=*g._SYMBptr;
+      unsigned hf;
+      gen f=hashcons_rec(s.feuille,hf,exact,shared);
+      h=hashcons_mix(hashcons_mix(3,unsigned(size_t(s.sommet.ptr()) >> 4)),hf);
+      if (!h)
+	h=1;
+      if (g.ref_count()==-1)
+	shared=false;
+      gen res(g);
+      if (f.__ZINTptr!=s.feuille.__ZINTptr){
+	res=symbolic(s.sommet,f);
+	res.subtype=g.subtype;
+      }
+      if (!shared)
+	return res;
+      map<unsigned,vector<hashcons_iterator> >::iterator bt=hashcons_tab.table.find(h);
+      if (bt!=hashcons_tab.table.end()){
+	vector<hashcons_iterator>::const_iterator it=bt->second.begin(),itend=bt->second.end();
+	for (;it!=itend;++it){
+	  const gen & c=(*it)->g;
+	  if (c.subtype==res.subtype && c._SYMBptr->sommet==s.sommet && hashcons_same(c._SYMBptr->feuille,f)){
+	    ++hashcons_tab.hits;
+	    hashcons_tab.lru.splice(hashcons_tab.lru.begin(),hashcons_tab.lru,*it);
+	    return c;
+	  }
+	}
+      }
+      ++hashcons_tab.misses;
+      publish_gen(res);
+      hashcons_entry e;
+      e.g=res;
+      e.hash=h;
+      if (exact)
+	__atomic_store_n(&res.__SYMBptr->hash,h,__ATOMIC_RELAXED);
+      hashcons_tab.lru.push_front(e);
+      hashcons_tab.table[h].push_back(hashcons_tab.lru.begin());
+      ++hashcons_tab.size;
+      while (hashcons_tab.size>hashcons_tab.maxsize)
+	hashcons_tab.evict();
+      return res;
+    }
+    }
+    h=hashcons_mix(4,g.type);
+    exact=shared=false;
+    return g;
+  }
+
+  gen hashcons(const gen & g){
+#ifdef HAVE_LIBPTHREAD
+    pthread_rwlock_wrlock(&hashcons_lock);
+#endif
+    unsigned h; bool exact,shared;
+    gen res=hashcons_rec(g,h,exact,shared);
+#ifdef HAVE_LIBPTHREAD
+    pthread_rwlock_unlock(&hashcons_lock);
+#endif
+    return res;
+  }
+
+  bool hashcons_differ(const gen & a,const gen & b){
+    if (a.type!=_SYMB || b.type!=_SYMB)
+      return false;
+    unsigned ha=__atomic_load_n(&a.__SYMBptr->hash,__ATOMIC_RELAXED);
+    if (!ha)
+      return false;
+    unsigned hb=__atomic_load_n(&b.__SYMBptr->hash,__ATOMIC_RELAXED);
+    return hb && ha!=hb;
+  }
+
+  void hashcons_parsed(bool on){
+#ifdef HAVE_LIBPTHREAD
+    pthread_rwlock_wrlock(&hashcons_lock);
+#endif
+    __atomic_store_n(&hashcons_tab.parsed,on,__ATOMIC_RELAXED);
+    if (!on){
+      hashcons_tab.clear();
+      hashcons_tab.hits=hashcons_tab.misses=hashcons_tab.evicted=0;
+    }
+#ifdef HAVE_LIBPTHREAD
+    pthread_rwlock_unlock(&hashcons_lock);
+#endif
+  }
+
+  void hashcons_size(size_t n){
+#ifdef HAVE_LIBPTHREAD
+    pthread_rwlock_wrlock(&hashcons_lock);
+#endif
+    hashcons_tab.maxsize=n?n:1;
+    while (hashcons_tab.size>hashcons_tab.maxsize)
+      hashcons_tab.evict();
+#ifdef HAVE_LIBPTHREAD
+    pthread_rwlock_unlock(&hashcons_lock);
+#endif
+  }
+
+  string hashcons_stats(){
+#ifdef HAVE_LIBPTHREAD
+    pthread_rwlock_rdlock(&hashcons_lock);
+#endif
+    string s=string("Hash-consing ")+(hashcons_tab.parsed?"on":"off")+", hits "+print_INT_(hashcons_tab.hits)+", misses "+print_INT_(hashcons_tab.misses)+", nodes "+print_INT_(int(hashcons_tab.size))+", evicted "+print_INT_(hashcons_tab.evicted);
+#ifdef HAVE_LIBPTHREAD
+    pthread_rwlock_unlock(&hashcons_lock);
+#endif
+    return s;
+  }
+#else // GIAC_HASHCONS
+  gen hashcons(const gen & g){
+    return g;
+  }
+
+  bool hashcons_differ(const gen & a,const gen & b){
+    return false;
+  }
+
+  void hashcons_parsed(bool on){
+  }
+
+  void hashcons_size(size_t n){
+  }
+
+  string hashcons_stats(){
+    return "Hash-consing not available";
+  }
+#endif // GIAC_HASHCONS
+
   static int protected_giac_yyparse(const string & chaine,gen & parse_result,GIAC_CONTEXT){
+    perf_timer timer(PERF_TIME_PARSE);
+    trace_scope scope("parse");
     int s;
     s=int(chaine.size());
     if (!s)
       return 1;
 #ifdef HAVE_LIBPTHREAD
-    static pthread_mutex_t parse_mutex = PTHREAD_MUTEX_INITIALIZER;
     int locked = pthread_mutex_lock(&parse_mutex);
 #else // HAVE_LIBPTHREAD
     int locked = 0;
 #endif
     int res = 1;
+    string key;
+    if (parse_cache.maxsize && chaine.size()<parse_cache_maxlen){
+      key=parse_cache_key(chaine,contextptr);
+      map<string,list<parse_cache_entry>::iterator>::iterator it=parse_cache.index.find(key);
+      if (it!=parse_cache.index.end()){
+	++parse_cache.hits;
+	parse_cache.entries.splice(parse_cache.entries.begin(),parse_cache.entries,it->second);
+	parse_result=parse_cache_copy(it->second->g);
+#ifdef GIAC_HASHCONS
+	if (__atomic_load_n(&hashcons_tab.parsed,__ATOMIC_RELAXED))
+	  parse_result=hashcons(parse_result);
+#endif
+	parsed_gen(parse_result,contextptr);
+#ifdef HAVE_LIBPTHREAD
+        if (!locked)
+          pthread_mutex_unlock(&parse_mutex);
+#endif
+	return 0;
+      }
+      ++parse_cache.misses;
+    }
 #ifndef NO_STDEXCEPT
     try {
 #endif
@@ -12582,6 +13862,24 @@ namespace giac {
 	// parse_result=aplatir_fois_plus(g);
 	if (g.type==_SYMB && parse_result.type==_SYMB)
 	  parse_result.subtype=g.subtype;
+#ifdef GIAC_HASHCONS
+	if (__atomic_load_n(&hashcons_tab.parsed,__ATOMIC_RELAXED))
+	  parse_result=hashcons(parse_result);
+#endif
+	// do not cache if parsing failed or changed the lexer state
+	if (!res && !key.empty() && parse_cache_key(chaine,contextptr)==key){
+	  parse_cache_entry e;
+	  e.key=key;
+	  e.g=parse_cache_copy(parse_result);
+	  // the leaves of cached trees are shared by all parsing threads
+	  publish_gen(e.g);
+	  parse_cache.entries.push_front(e);
+	  parse_cache.index[key]=parse_cache.entries.begin();
+	  if (parse_cache.entries.size()>parse_cache.maxsize){
+	    parse_cache.index.erase(parse_cache.entries.back().key);
+	    parse_cache.entries.pop_back();
+	  }
+	}
 #ifdef HAVE_LIBPTHREAD
         if (!locked)
           pthread_mutex_unlock(&parse_mutex);
@@ -16760,28 +18058,203 @@ void sprint_double(char * s,double d){
 #endif
   }
 
+  // parse s in contextptr, run a leading set_language, evaluate and
+  // record the input and output in the history (for ans())
+  static gen caseval_eval(const char * s,GIAC_CONTEXT){
+    gen g(s,contextptr);
+    g=equaltosto(g,contextptr);
+    if (g.type==_VECT && !g._VECTptr->empty() && g._VECTptr->front().is_symb_of_sommet(at_set_language)){
+      vecteur v=*g._VECTptr;
+      iprotecteval(v.front(),1,contextptr);
+      v.erase(v.begin());
+      if (g.subtype==_SEQ__VECT && v.size()==1)
+	g=v.front();
+      else
+	g=gen(v,g.subtype);
+    }
+    gen gp=g;
+    if (gp.is_symb_of_sommet(at_add_autosimplify))
+      gp=gp._SYMBptr->feuille;
+#ifdef KHICAS
+    bool push=false;
+#else
+    bool push=!gp.is_symb_of_sommet(at_mathml) && !gp.is_symb_of_sommet(at_set_language);
+#endif
+    //bool push=!g.is_symb_of_sommet(at_mathml);
+    if (push){
+      history_in(contextptr).push_back(g);
+      // COUT << "hin " << g << '\n';
+    }
+    g=iprotecteval(g,1,contextptr);
+    if (push){
+      history_out(contextptr).push_back(g);
+      // COUT << "hout " << g << '\n';
+    }
+    return g;
+  }
+
 #if 0 // def KHICAS
 #undef HAVE_LIBPTHREAD
 #endif
 
 #ifdef HAVE_LIBPTHREAD
+  // caseval evaluations are run by a persistent worker thread
+  // the caller posts a job and waits on done_cond, the worker waits on job_cond
+  // on timeout the evaluation is cancelled cooperatively (see eval_token),
+  // the worker unwinds at the next interruption point and is reused.
+  // A worker that does not unwind within a short grace period is abandoned
+  // with its context, it frees itself when it is done (see caseval_run)
   struct caseval_param{
-    const char * s;
+    std::string s;
     gen ans;
     context * contextptr;
     pthread_mutex_t mutex;
+    pthread_cond_t job_cond,done_cond;
+    bool job;
+    bool abandoned;
+    volatile bool busy; // true from job post until the worker is done
+    eval_token token;
+    pthread_t pth;
   };
+
+  static void caseval_param_free(caseval_param * cp){
+    pthread_cond_destroy(&cp->done_cond);
+    pthread_cond_destroy(&cp->job_cond);
+    pthread_mutex_destroy(&cp->mutex);
+    delete cp;
+  }
+
   void * thread_caseval(void * ptr_){
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE,NULL);
-    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS,NULL);
     caseval_param * ptr=(caseval_param *)ptr_;
     pthread_mutex_lock(&ptr->mutex);
-    gen g(ptr->s,ptr->contextptr);
-    g=equaltosto(g,ptr->contextptr);
-    ptr->ans=iprotecteval(g,1,ptr->contextptr);
-    pthread_mutex_unlock(&ptr->mutex);
+    for (;;){
+      while (!ptr->job)
+	pthread_cond_wait(&ptr->job_cond,&ptr->mutex);
+      ptr->job=false;
+      pthread_mutex_unlock(&ptr->mutex);
+      set_current_eval_token(&ptr->token);
+#ifdef TIMEOUT
+      caseval_begin=time(0);
+#endif
+      gen g;
+      {
+	eval_arena arena;
+	gcd_cache_scope gcds; // before arena is released
+	g=arena.keep(caseval_eval(ptr->s.c_str(),ptr->contextptr));
+      }
+      set_current_eval_token(0);
+      pthread_mutex_lock(&ptr->mutex);
+      if (ptr->abandoned){
+	// nobody waits for this worker any more
+	pthread_mutex_unlock(&ptr->mutex);
+	g=0;
+	caseval_param_free(ptr);
+	return 0;
+      }
+      ptr->ans=g;
+      ptr->busy=false;
+      pthread_cond_signal(&ptr->done_cond);
+    }
     return ptr;
   }
+
+  static caseval_param * caseval_worker=0;
+
+  // return the caseval worker, create it if necessary, 0 on failure
+  static caseval_param * caseval_worker_get(context * contextptr){
+    if (caseval_worker)
+      return caseval_worker;
+    caseval_param * cp=new caseval_param;
+    cp->contextptr=contextptr;
+    cp->job=cp->busy=cp->abandoned=false;
+    pthread_mutex_init(&cp->mutex,0);
+    pthread_cond_init(&cp->job_cond,0);
+    pthread_cond_init(&cp->done_cond,0);
+    if (pthread_create(&cp->pth,0,thread_caseval,(void *)cp)){
+      caseval_param_free(cp);
+      return 0;
+    }
+    pthread_detach(cp->pth);
+    caseval_worker=cp;
+    return cp;
+  }
+
+  static double caseval_wallclock(){
+    struct timeval tv;
+    gettimeofday(&tv,0);
+    return tv.tv_sec+tv.tv_usec*1e-6;
+  }
+
+  // wait until the worker is idle or absolute time t (mutex locked)
+  static bool caseval_wait_until(caseval_param * cp,double t){
+    struct timespec ts;
+    ts.tv_sec=time_t(t);
+    ts.tv_nsec=long((t-ts.tv_sec)*1e9);
+    while (cp->busy){
+      if (pthread_cond_timedwait(&cp->done_cond,&cp->mutex,&ts)==ETIMEDOUT)
+	return !cp->busy;
+    }
+    return true;
+  }
+
+  // run s in the caseval worker, wait at most maxtime seconds.
+  // If the cancelled evaluation does not unwind in time, the worker keeps
+  // contextptr and contextptr is replaced by a new context in the same
+  // mode, the old one is not deleted (callers may still hold it)
+  static gen caseval_run(const char * s,context * & contextptr,double maxtime){
+    caseval_param * cp=caseval_worker_get(contextptr);
+    if (!cp)
+      return caseval_eval(s,contextptr);
+    // settings of a replacement context, read before the worker runs
+    int mode=calc_mode(contextptr);
+    eval_tunables tunables;
+    if (contextptr->globalptr)
+      tunables=contextptr->globalptr->_tunables_;
+    double deadline=caseval_wallclock()+maxtime;
+    pthread_mutex_lock(&cp->mutex);
+    cp->s=s;
+    cp->contextptr=contextptr;
+    cp->token.set_timeout(maxtime);
+    cp->token.set_memory_limit(size_t(caseval_maxmem));
+    cp->busy=cp->job=true;
+    pthread_cond_signal(&cp->job_cond);
+    // ctrl_c is polled every 10ms, completion is signaled immediately
+    for (;;){
+      double t=caseval_wallclock();
+      if (ctrl_c || interrupted || t>=deadline)
+	break;
+      if (caseval_wait_until(cp,std::min(t+0.01,deadline)))
+	break;
+    }
+    gen g;
+    // out of memory: the worker has returned the error
+    if (!cp->busy && (!cp->token.cancelled || cp->token.outofmem)){
+      g=cp->ans;
+      cp->ans=0;
+      pthread_mutex_unlock(&cp->mutex);
+      return g;
+    }
+    // the worker will stop at its next interruption point
+    cp->token.cancel();
+    if (caseval_wait_until(cp,caseval_wallclock()+0.2)){
+      cp->ans=0;
+      pthread_mutex_unlock(&cp->mutex);
+    }
+    else {
+      cp->abandoned=true;
+      caseval_worker=0;
+      pthread_mutex_unlock(&cp->mutex);
+      context * newptr=new context;
+      if (mode==1)
+	init_geogebra(1,newptr);
+      if (contextptr->globalptr)
+	newptr->globalptr->_tunables_=tunables;
+      contextptr=newptr;
+    }
+    g=string2gen("Timeout",false);
+    g.subtype=-1;
+    return g;
+  }
 #endif
 
   bool islogo(const gen & g){
@@ -16830,6 +18303,329 @@ void sprint_double(char * s,double d){
     return cur-limit<max_stack_size;
   }
       
+  // Result cache for caseval, off by default: "diag cache <bytes>" sets the
+  // memory budget (0 disables), "diag cache stats" returns the counters.
+  // Key is the input with blanks normalized prefixed by the context settings
+  // that modify results. Each entry keeps the identifiers the input depends
+  // on (including through stored values), a global store to one of them
+  // drops the entry (see caseval_cache_invalidate called by sto and purge).
+  struct caseval_cache_entry {
+    string key,value;
+    vector<string> deps;
+    size_t size;
+  };
+  struct caseval_cache_t {
+    size_t budget,used;
+    unsigned hits,misses,stores;
+    list<caseval_cache_entry> entries; // most recently used first
+    map<string,list<caseval_cache_entry>::iterator> index;
+    map<string,int> depcount; // number of entries depending on an identifier
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_t mutex;
+#endif
+    caseval_cache_t():budget(0),used(0),hits(0),misses(0),stores(0){
+#ifdef HAVE_LIBPTHREAD
+      pthread_mutex_init(&mutex,0);
+#endif
+    }
+    void lock(){
+#ifdef HAVE_LIBPTHREAD
+      pthread_mutex_lock(&mutex);
+#endif
+    }
+    void unlock(){
+#ifdef HAVE_LIBPTHREAD
+      pthread_mutex_unlock(&mutex);
+#endif
+    }
+    void erase(list<caseval_cache_entry>::iterator it){
+      for (size_t i=0;i<it->deps.size();++i){
+	map<string,int>::iterator jt=depcount.find(it->deps[i]);
+	if (jt!=depcount.end() && --jt->second<=0)
+	  depcount.erase(jt);
+      }
+      used -= it->size;
+      index.erase(it->key);
+      entries.erase(it);
+    }
+    void clear(){
+      entries.clear(); index.clear(); depcount.clear();
+      used=0;
+    }
+  };
+  static caseval_cache_t caseval_cache;
+
+  void caseval_cache_invalidate(const char * name){
+    if (!caseval_cache.budget)
+      return;
+    caseval_cache.lock();
+    ++caseval_cache.stores;
+    if (!name)
+      caseval_cache.clear();
+    else if (caseval_cache.depcount.find(name)!=caseval_cache.depcount.end()){
+      list<caseval_cache_entry>::iterator it=caseval_cache.entries.begin(),itend=caseval_cache.entries.end();
+      while (it!=itend){
+	list<caseval_cache_entry>::iterator cur=it;
+	++it;
+	if (binary_search(cur->deps.begin(),cur->deps.end(),string(name)))
+	  caseval_cache.erase(cur);
+      }
+    }
+    caseval_cache.unlock();
+  }
+
+  // context settings that modify results, first line of the keys
+  static string caseval_cache_settings(GIAC_CONTEXT){
+    return print_INT_(angle_mode(contextptr))+','+print_INT_(decimal_digits(contextptr))+','+print_INT_(calc_mode(contextptr))+','+print_INT_(xcas_mode(contextptr))+','+print_INT_(python_compat(contextptr))+','+print_INT_(complex_mode(contextptr))+print_INT_(complex_variables(contextptr))+print_INT_(approx_mode(contextptr))+print_INT_(all_trig_sol(contextptr))+print_INT_(withsqrt(contextptr))+print_INT_(increasing_power(contextptr))+print_INT_(eval_equaltosto(contextptr))+','+print_DOUBLE_(epsilon(contextptr),14)+','+print_INT_(scientific_format(contextptr))+','+print_INT_(integer_format(contextptr));
+  }
+
+  static string caseval_cache_key(const char * s,GIAC_CONTEXT){
+    string key=caseval_cache_settings(contextptr)+'\n';
+    // collapse blanks outside of strings
+    bool instring=false,blank=false;
+    for (;*s;++s){
+      char c=*s;
+      if (!instring && (c==' ' || c=='\t' || c=='\n' || c=='\r')){
+	blank=true;
+	continue;
+      }
+      if (blank && key[key.size()-1]!='\n')
+	key += ' ';
+      blank=false;
+      if (c=='"' && (!instring || s[-1]!='\\'))
+	instring=!instring;
+      key += c;
+    }
+    return key;
+  }
+
+  // identifiers of s, false if s should not be cached (random, time, side
+  // effects, settings like Digits:=20 that a hit would not apply, or
+  // reading the history like ans and quest)
+  static bool caseval_cache_deps(const string & s,vector<string> & deps){
+    static const char * const nocache[]={"rand","random","randint","randnorm","randvector","randmatrix","randpoly","randperm","srand","RandSeed","ranm","alea","hasard","time","clock","caseval","restart","purge","assume","unassume","additionally","local","global","read","write","ans","Ans","quest","entry",
+      "Digits","DIGITS","HDigits","HFormat","HAngle","HComplex","HLanguage","angle_radian","approx_mode","complex_mode","complex_variables","all_trig_solutions","increasing_power","with_sqrt","epsilon","proba_epsilon","scientific_format","integer_format","eval_level","prog_eval_level","threads","ntl_on","keep_algext","step_infolevel","rur_separate_max_tries","gbasis_reinject","gbasis_max_pairs","gbasis_simult_primes","cas_setup","xcas_mode","maple_mode","python_compat","calc_mode","init","kill"};
+    size_t n=s.size();
+    bool instring=false;
+    for (size_t i=0;i<n;++i){
+      char c=s[i];
+      if (c=='"' && (!instring || s[i-1]!='\\')){
+	instring=!instring;
+	continue;
+      }
+      if (instring || !(isalpha(c) || c=='_'))
+	continue;
+      size_t j=i+1;
+      while (j<n && (isalnum(s[j]) || s[j]=='_'))
+	++j;
+      string id=s.substr(i,j-i);
+      for (size_t k=0;k<sizeof(nocache)/sizeof(char *);++k){
+	if (id==nocache[k])
+	  return false;
+      }
+      deps.push_back(id);
+      i=j-1;
+    }
+    return true;
+  }
+
+  // store value unless a global variable was stored since stores was read
+  static void caseval_cache_store(const string & key,const string & value,unsigned stores,GIAC_CONTEXT){
+    vector<string> deps;
+    if (!caseval_cache_deps(key.substr(key.find('\n')+1),deps))
+      return;
+    // add identifiers of stored values, e.g. for user functions
+    for (size_t i=0;i<deps.size() && deps.size()<1024;++i){
+      sym_tab::const_iterator it=contextptr->tabptr->find(deps[i].c_str());
+      if (it==contextptr->tabptr->end())
+	continue;
+      vecteur l(lidnt(it->second));
+      for (size_t j=0;j<l.size();++j){
+	if (l[j].type!=_IDNT)
+	  continue;
+	string id(l[j]._IDNTptr->id_name);
+	if (!equalposcomp(deps,id))
+	  deps.push_back(id);
+      }
+    }
+    sort(deps.begin(),deps.end());
+    deps.erase(unique(deps.begin(),deps.end()),deps.end());
+    caseval_cache_entry e;
+    e.key=key;
+    e.value=value;
+    e.deps=deps;
+    e.size=sizeof(caseval_cache_entry)+2*key.size()+value.size();
+    for (size_t i=0;i<deps.size();++i)
+      e.size += sizeof(string)+deps[i].size();
+    if (e.size>caseval_cache.budget/4)
+      return;
+    caseval_cache.lock();
+    if (caseval_cache.stores==stores && caseval_cache.index.find(key)==caseval_cache.index.end()){
+      caseval_cache.entries.push_front(e);
+      caseval_cache.index[key]=caseval_cache.entries.begin();
+      caseval_cache.used += e.size;
+      for (size_t i=0;i<deps.size();++i)
+	++caseval_cache.depcount[deps[i]];
+      while (caseval_cache.used>caseval_cache.budget)
+	caseval_cache.erase(--caseval_cache.entries.end());
+    }
+    caseval_cache.unlock();
+  }
+
+  // return true and set value if key is cached, stores is the count of
+  // global stores for caseval_cache_store
+  static bool caseval_cache_find(const string & key,string & value,unsigned & stores){
+    caseval_cache.lock();
+    stores=caseval_cache.stores;
+    map<string,list<caseval_cache_entry>::iterator>::iterator it=caseval_cache.index.find(key);
+    bool res=it!=caseval_cache.index.end();
+    if (res){
+      ++caseval_cache.hits;
+      caseval_cache.entries.splice(caseval_cache.entries.begin(),caseval_cache.entries,it->second);
+      value=it->second->value;
+    }
+    else
+      ++caseval_cache.misses;
+    caseval_cache.unlock();
+    return res;
+  }
+
+  // caseval reads its settings (timeout, memory budget...) from the
+  // tunables of its context, a caller evaluating in another context (e.g.
+  // a program calling caseval) gets its own tunables back on return
+  struct caseval_tunables {
+    eval_tunables saved;
+    caseval_tunables(GIAC_CONTEXT){
+      save_tunables(saved);
+      install_tunables(contextptr);
+    }
+    ~caseval_tunables(){ restore_tunables(saved); }
+  };
+
+  // caseval("diag <feature> <argument>"): switches and counters of the
+  // performance features, the argument defaults to stats.
+  static string diag_hashcons(const string & arg){
+    if (arg=="on" || arg=="off")
+      hashcons_parsed(arg=="on");
+    else if (arg!="stats"){
+      int n=atoi(arg.c_str());
+      if (n<=0)
+	return "";
+      hashcons_size(n);
+    }
+    return hashcons_stats();
+  }
+
+  static string diag_stats(const string & arg){
+    // counters of the previous top-level evaluation (e.g. the previous
+    // line of minigiac, a caseval is one evaluation)
+    if (arg=="last")
+      return perf_json(true);
+    if (arg=="on" || arg=="off")
+      perf_stats(arg=="on");
+    else if (arg!="stats")
+      return "";
+    // counters since the start of the current evaluation
+    return perf_json(false);
+  }
+
+  static string diag_trace(const string & arg){
+    if (arg=="start"){
+      trace_start();
+      return "Trace started";
+    }
+    // Chrome trace JSON of the evaluations since trace start
+    if (!arg.compare(0,5,"save "))
+      return trace_save(arg.c_str()+5)?"Trace saved":"Trace not saved";
+    return "";
+  }
+
+  static string diag_slab(const string & arg){
+    if (arg!="stats")
+      return "";
+    slab_statistics st;
+    slab_stats(st);
+    return "Slab pools "+print_INT_(int(st.pools))+", chunks "+print_INT_(int(st.chunks))+", allocated "+gen(longlong(st.allocated)).print()+", freed "+gen(longlong(st.freed)).print()+", remote freed "+gen(longlong(st.remote_freed)).print();
+  }
+
+  static string diag_arena(const string & arg){
+    if (arg=="on" || arg=="off")
+      arena_eval(arg=="on");
+    else if (arg!="stats")
+      return "";
+    return arena_stats();
+  }
+
+  static string diag_parsecache(const string & arg){
+    if (arg=="stats")
+      return parse_cache_stats();
+    int n=atoi(arg.c_str());
+    if (n<0 || (!n && arg!="0"))
+      return "";
+    parse_cache_size(n);
+    return "Parse cache size set to "+print_INT_(n);
+  }
+
+  static string diag_gcdcache(const string & arg){
+    if (arg=="stats")
+      return gcd_cache_stats();
+    double f=atof(arg.c_str());
+    if (f<0 || f>=1e10 || (!f && arg!="0"))
+      return "";
+    gcd_cache_size(size_t(f));
+    return "Gcd cache size set to "+gen(f).print();
+  }
+
+  static string diag_cache(const string & arg){
+    string res;
+    caseval_cache.lock();
+    if (arg=="stats")
+      res="Cache hits "+print_INT_(caseval_cache.hits)+", misses "+print_INT_(caseval_cache.misses)+", entries "+print_INT_(caseval_cache.entries.size())+", size "+print_INT_(caseval_cache.used)+"/"+print_INT_(caseval_cache.budget);
+    else {
+      double f=atof(arg.c_str());
+      if (f>=0 && f<1e10 && (f || arg=="0")){
+	caseval_cache.budget=size_t(f);
+	caseval_cache.hits=caseval_cache.misses=0;
+	caseval_cache.clear();
+	res="Cache size set to "+gen(f).print();
+      }
+    }
+    caseval_cache.unlock();
+    return res;
+  }
+
+  struct diag_feature {
+    const char * name;
+    string (* f)(const string & arg);
+  };
+
+  static const diag_feature diag_features[]={
+    {"arena",diag_arena},
+    {"cache",diag_cache},
+    {"gcdcache",diag_gcdcache},
+    {"hashcons",diag_hashcons},
+    {"parsecache",diag_parsecache},
+    {"slab",diag_slab},
+    {"stats",diag_stats},
+    {"trace",diag_trace},
+  };
+
+  static string caseval_diag(const char * s){
+    const char * arg=strchr(s,' ');
+    string name(s,arg?arg-s:strlen(s));
+    int n=sizeof(diag_features)/sizeof(diag_feature);
+    for (int i=0;i<n;++i){
+      if (name!=diag_features[i].name)
+	continue;
+      string res=diag_features[i].f(arg?arg+1:"stats");
+      return res.empty()?"diag "+name+": unknown argument":res;
+    }
+    string res="diag features:";
+    for (int i=0;i<n;++i)
+      res+=string(i?", ":" ")+diag_features[i].name;
+    return res;
+  }
+
   const char * caseval(const char *s){
     //printf("%s\n",s);
     ctrl_c=interrupted=false;
@@ -16839,6 +18635,7 @@ void sprint_double(char * s,double d){
     static context * contextptr=0;
     if (!contextptr) contextptr=new context;
     context & C=*contextptr;
+    caseval_tunables tunables(&C);
     if (!strcmp(s,"caseval contextptr"))
       return (const char *) contextptr;
     // history_plot(contextptr).clear(); // must be commented otherwise matplotl fails
@@ -16957,13 +18754,28 @@ void sprint_double(char * s,double d){
     const char init[]="init geogebra";
     const char close[]="close geogebra";
     if (!strcmp(s,init)){
+      init_geogebra(1,0); // defaults of the contexts created later
       init_geogebra(1,&C);
       return "geogebra mode on";
     }
     if (!strcmp(s,close)){
+      init_geogebra(0,0); // defaults of the contexts created later
       init_geogebra(0,&C);
       return "geogebra mode off";
     }
+    if (!strncmp(s,"diag",4) && (!s[4] || s[4]==' ')){
+      S=caseval_diag(s[4]?s+5:"");
+      return S.c_str();
+    }
+    if (!strncmp(s,"memory ",7)){
+      double f=atof(s+7);
+      if (f>=0){
+	caseval_maxmem=f*1048576;
+	store_tunables(_TUNE_CASEVAL_MAXMEM,&C);
+	S=f?"Max eval memory set to "+gen(f).print()+"M":string("No eval memory limit");
+	return S.c_str();
+      }
+    }
 #ifdef TIMEOUT
     if (strlen(s)>8){
       string args(s);
@@ -16972,6 +18784,7 @@ void sprint_double(char * s,double d){
 	double f=atof(t.c_str());
 	if (f>=0 && f<24*60){
 	  caseval_maxtime=f;
+	  store_tunables(_TUNE_CASEVAL_MAXTIME,&C);
 	  S="Max eval time set to "+gen(f).print();
 	  return S.c_str();
 	}
@@ -16981,6 +18794,7 @@ void sprint_double(char * s,double d){
 	int f=atoi(t.c_str());
 	if (f>0 && f<1e6){
 	  caseval_mod=f;
+	  store_tunables(_TUNE_CASEVAL_MOD,&C);
 	  S="Check every "+gen(f).print();
 	  return S.c_str();
 	}
@@ -16990,89 +18804,36 @@ void sprint_double(char * s,double d){
     interrupted=false;
     caseval_begin=time(0);    
 #endif
-#ifdef HAVE_LIBPTHREAD
-    gen g;
-    caseval_param cp={s,0,&C,PTHREAD_MUTEX_INITIALIZER};
-    pthread_t pth;
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    int cres=pthread_create(&pth,&attr,thread_caseval,(void *)&cp);
-    if (cres){
-      g=gen(s,&C);
-      g=equaltosto(g,&C);
-      g=iprotecteval(g,1,&C);
+    // after the commands above, they are answered without cache
+    string cache_key;
+    unsigned cache_stores=0;
+    if (caseval_cache.budget){
+      cache_key=caseval_cache_key(s,&C);
+      if (caseval_cache_find(cache_key,S,cache_stores))
+	return S.c_str();
     }
-    else {
-      // void * ptr;
+    perf_begin();
+#ifdef HAVE_LIBPTHREAD
 #ifdef TIMEOUT
-      double d=caseval_maxtime;
+    gen g=caseval_run(s,contextptr,caseval_maxtime);
 #else
-      double d=3;
+    gen g=caseval_run(s,contextptr,3);
 #endif
-      usleep(10000);
-      for (;d>0;--d){
-	for (unsigned k=0;k<100;++k){
-	  if (ctrl_c || interrupted){
-	    d=0;
-	    break;
-	  }
-	  int locked=pthread_mutex_trylock(&cp.mutex);
-	  if (!locked){
-	    pthread_mutex_unlock(&cp.mutex);
-	    void * ptr;
-	    cres=pthread_join(pth,&ptr);
-	    d=-1;
-	    if (cres){
-	      g=string2gen("Thread join error",false);
-	      g.subtype=-1;
-	    }
-	    else
-	      g=cp.ans;
-	    break;
-	  }
-	  usleep(10000);
-	}
-      }
-      if (d==0){
-	ctrl_c=interrupted=true;
-	usleep(200000);
-	pthread_cancel(pth);
-	// cres=pthread_join(pth,NULL); // does not work
-	g=string2gen("Timeout",false);
-	g.subtype=-1;
-      }
-      pthread_attr_destroy(&attr);
+    if (contextptr!=&C){
+      // the evaluation in C was abandoned, C may still be in use
+      S=g.print(contextptr);
+      return S.c_str();
     }
 #else
-    gen g(s,&C);
-    g=equaltosto(g,&C);
-    if (g.type==_VECT && !g._VECTptr->empty() && g._VECTptr->front().is_symb_of_sommet(at_set_language)){
-      vecteur v=*g._VECTptr;
-      iprotecteval(v.front(),1,&C);
-      v.erase(v.begin());
-      if (g.subtype==_SEQ__VECT && v.size()==1)
-	g=v.front();
-      else
-	g=gen(v,g.subtype);
-    }
-    gen gp=g;
-    if (gp.is_symb_of_sommet(at_add_autosimplify))
-      gp=gp._SYMBptr->feuille;
-#ifdef KHICAS
-    bool push=false;
-#else
-    bool push=!gp.is_symb_of_sommet(at_mathml) && !gp.is_symb_of_sommet(at_set_language);
-#endif
-    //bool push=!g.is_symb_of_sommet(at_mathml);
-    if (push){
-      history_in(&C).push_back(g);
-      // COUT << "hin " << g << '\n';
-    }
-    g=iprotecteval(g,1,&C);
-    if (push){
-      history_out(&C).push_back(g);
-      // COUT << "hout " << g << '\n';
+    eval_token token;
+    bool budget=caseval_maxmem>0 && !current_eval_token;
+    if (budget){
+      token.set_memory_limit(size_t(caseval_maxmem));
+      set_current_eval_token(&token);
     }
+    gen g=caseval_eval(s,&C);
+    if (budget)
+      set_current_eval_token(0);
 #endif
 #if (defined(EMCC) || defined(EMCC2)) && !defined SDL_KHICAS
     // compile with -s LEGACY_GL_EMULATION=1
@@ -17204,6 +18965,10 @@ void sprint_double(char * s,double d){
 #endif // !defined GIAC_GGB
 #endif // NUWMORKS
     }
+    // cache only if no global variable was stored and no setting changed
+    // during evaluation (e.g. by a user function)
+    if (!cache_key.empty() && !ctrl_c && !interrupted && S.compare(0,10,"GIAC_ERROR") && !cache_key.compare(0,cache_key.find('\n'),caseval_cache_settings(&C)))
+      caseval_cache_store(cache_key,S,cache_stores,&C);
     return S.c_str();
   }
 
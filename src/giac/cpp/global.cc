@@ -60,6 +60,12 @@ using namespace std;
 #ifdef HAVE_PWD_H
 #include <pwd.h>
 #endif
+#if defined HAVE_UNISTD_H && !defined __MINGW_H && !defined EMCC && !defined EMCC2 && !defined KHICAS && !defined NSPIRE_NEWLIB && !defined FXCG
+#define GIAC_BINARY_ARCHIVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
 #include <string.h>
 #include <stdexcept>
 #include <algorithm>
@@ -80,6 +86,8 @@ using namespace std;
 #include "tex.h"
 #include "path.h"
 #include "input_lexer.h"
+#include "maple.h"
+#include "solve.h"
 #include "giacintl.h"
 #ifdef HAVE_LOCALE_H
 #include <locale.h>
@@ -237,7 +245,7 @@ int my_sprintf(char * s, const char * format, ...){
 int ctrl_c_interrupted(int exception){
   if (!giac::ctrl_c && !giac::interrupted)
     return 0;
-  giac::ctrl_c=giac::interrupted=0;
+  giac::ctrl_c=giac::interrupted=false;
 #ifndef NO_STDEXCEPT
   if (exception)
     giac::setsizeerr("Interrupted");
@@ -2016,9 +2024,9 @@ namespace giac {
     return double(CLOCK())/1000000; // CLOCKS_PER_SEC;
   }
 #endif
-  time_t caseval_begin,caseval_current;
-  double caseval_maxtime=15; // max 15 seconds
-  int caseval_n=0,caseval_mod=0,caseval_unitialized=-123454321;
+  GIAC_THREAD_LOCAL time_t caseval_begin,caseval_current;
+  GIAC_THREAD_LOCAL double caseval_maxtime=15; // max 15 seconds
+  GIAC_THREAD_LOCAL int caseval_n=0,caseval_mod=0,caseval_unitialized=-123454321;
 #if !defined POCKETCAS
   void control_c(){
 #if defined NSPIRE || defined KHICAS || defined SDL_KHICAS
@@ -2033,6 +2041,9 @@ namespace giac {
       ctrl_c=interrupted=true; 
     }
 #else
+    eval_token * t=current_eval_token;
+    if (t && t->poll())
+      return;
     if (caseval_unitialized!=-123454321){
       caseval_unitialized=-123454321;
       caseval_mod=0;
@@ -2225,6 +2236,82 @@ extern "C" void Sleep(unsigned int miliSecond);
       return _evaled_table_;
   }
 
+  // copy the mask tunables of the current thread to t
+  static void read_tunables(unsigned mask,eval_tunables & t){
+    if (mask & _TUNE_POWLOG2FLOAT)
+      t.powlog2float=powlog2float;
+    if (mask & _TUNE_MPZ_MAXLOG2)
+      t.mpz_maxlog2=MPZ_MAXLOG2;
+#ifdef TIMEOUT
+    if (mask & _TUNE_CASEVAL_MAXTIME)
+      t.caseval_maxtime=caseval_maxtime;
+    if (mask & _TUNE_CASEVAL_MOD)
+      t.caseval_mod=caseval_mod;
+#endif
+    if (mask & _TUNE_THREADS)
+      t.threads=threads;
+    if (mask & _TUNE_HEAP_MULT)
+      t.heap_mult=heap_mult;
+    if (mask & _TUNE_MODGCD_CACHESIZE)
+      t.modgcd_cachesize=modgcd_cachesize;
+    if (mask & _TUNE_CASEVAL_MAXMEM)
+      t.caseval_maxmem=caseval_maxmem;
+  }
+
+  void store_tunables(unsigned mask,GIAC_CONTEXT){
+    if (!contextptr || !contextptr->globalptr)
+      return;
+    eval_tunables & t=contextptr->globalptr->_tunables_;
+    t.set |= mask;
+    read_tunables(mask,t);
+  }
+
+  extern const eval_tunables default_tunables;
+
+  void save_tunables(eval_tunables & t){
+    t.set=_TUNE_ALL;
+    read_tunables(_TUNE_ALL,t);
+  }
+
+  void restore_tunables(const eval_tunables & t){
+    powlog2float=t.powlog2float;
+    MPZ_MAXLOG2=t.mpz_maxlog2;
+#ifdef TIMEOUT
+    caseval_maxtime=t.caseval_maxtime;
+    caseval_mod=t.caseval_mod;
+#endif
+    threads=t.threads;
+    heap_mult=t.heap_mult;
+    modgcd_cachesize=t.modgcd_cachesize;
+    caseval_maxmem=t.caseval_maxmem;
+  }
+
+  void install_tunables(GIAC_CONTEXT){
+    if (!contextptr || !contextptr->globalptr)
+      return;
+    // fields that are not set take their default value, the thread may
+    // have evaluated another context before
+    const eval_tunables & c=contextptr->globalptr->_tunables_;
+    eval_tunables t(default_tunables);
+    if (c.set & _TUNE_POWLOG2FLOAT)
+      t.powlog2float=c.powlog2float;
+    if (c.set & _TUNE_MPZ_MAXLOG2)
+      t.mpz_maxlog2=c.mpz_maxlog2;
+    if (c.set & _TUNE_CASEVAL_MAXTIME)
+      t.caseval_maxtime=c.caseval_maxtime;
+    if (c.set & _TUNE_CASEVAL_MOD)
+      t.caseval_mod=c.caseval_mod;
+    if (c.set & _TUNE_THREADS)
+      t.threads=c.threads;
+    if (c.set & _TUNE_HEAP_MULT)
+      t.heap_mult=c.heap_mult;
+    if (c.set & _TUNE_MODGCD_CACHESIZE)
+      t.modgcd_cachesize=c.modgcd_cachesize;
+    if (c.set & _TUNE_CASEVAL_MAXMEM)
+      t.caseval_maxmem=c.caseval_maxmem;
+    restore_tunables(t);
+  }
+
   static void * _extra_ptr_=0;
   void * & extra_ptr(GIAC_CONTEXT){
     if (contextptr && contextptr->globalptr )
@@ -3733,12 +3820,12 @@ extern "C" void Sleep(unsigned int miliSecond);
   int printprog=0;
 #if defined __APPLE__ || defined VISUALC || defined __MINGW_H || defined BESTA_OS || defined NSPIRE || defined FXCG || defined NSPIRE_NEWLIB || defined KHICAS || defined SDL_KHICAS
 #ifdef _WIN32
-  int threads=atoi(getenv("NUMBER_OF_PROCESSORS"));
+  GIAC_THREAD_LOCAL int threads=atoi(getenv("NUMBER_OF_PROCESSORS"));
 #else
-  int threads=1;
+  GIAC_THREAD_LOCAL int threads=1;
 #endif
 #else
-  int threads=sysconf (_SC_NPROCESSORS_ONLN);
+  GIAC_THREAD_LOCAL int threads=sysconf (_SC_NPROCESSORS_ONLN);
 #endif
   unsigned max_pairs_by_iteration=32768; 
   // gbasis max number of pairs by F4 iteration
@@ -3862,14 +3949,393 @@ extern "C" void Sleep(unsigned int miliSecond);
   // int GBASISF4_BUCHBERGER=5;
   const int BUFFER_SIZE=16384;
 #endif
-  volatile bool ctrl_c=false,interrupted=false,kbd_interrupted=false;
+  interrupt_flags global_interrupt_flags={false,false};
+  GIAC_THREAD_LOCAL interrupt_flags * current_interrupt_flags=&global_interrupt_flags;
+  const interrupt_flag<0> ctrl_c;
+  const interrupt_flag<1> interrupted;
+  volatile bool kbd_interrupted=false;
+
+  GIAC_THREAD_LOCAL eval_token * current_eval_token=0;
+
+  // tokens installed by set_current_eval_token, ctrl_c_signal_handler
+  // raises their ctrl_c flag (tokens beyond EVAL_TOKEN_MAX only see the
+  // timeout)
+#define EVAL_TOKEN_MAX 256
+  static eval_token * volatile active_eval_tokens[EVAL_TOKEN_MAX];
+
+  void set_current_eval_token(eval_token * t){
+    eval_token * old=current_eval_token;
+    if (old!=t){
+      if (old){
+	for (int i=0;i<EVAL_TOKEN_MAX;++i){
+	  if (active_eval_tokens[i]==old){
+	    active_eval_tokens[i]=0;
+	    break;
+	  }
+	}
+      }
+      if (t){
+	for (int i=0;i<EVAL_TOKEN_MAX;++i){
+#ifdef __GNUC__
+	  if (__sync_bool_compare_and_swap(&active_eval_tokens[i],(eval_token *)0,t))
+	    break;
+#else
+	  if (!active_eval_tokens[i]){
+	    active_eval_tokens[i]=t;
+	    break;
+	  }
+#endif
+	}
+      }
+    }
+    current_eval_token=t;
+    current_interrupt_flags=t?&t->flags:&global_interrupt_flags;
+  }
+
+  eval_token::~eval_token(){
+    for (int i=0;i<EVAL_TOKEN_MAX;++i){
+      if (active_eval_tokens[i]==this)
+	active_eval_tokens[i]=0;
+    }
+  }
+
+  void eval_token::set_timeout(double maxtime){
+    cancelled=false;
+    polls=0;
+    flags._ctrl_c=flags._interrupted=false;
+    mem=0;
+    outofmem=false;
+#if defined KHICAS || defined SDL_KHICAS
+    deadline=0;
+#else
+    deadline=maxtime>0?realtime()+maxtime:0;
+#endif
+  }
+
+  void eval_token::cancel(){
+    cancelled=true;
+    flags._ctrl_c=flags._interrupted=true;
+  }
+
+  bool eval_token::expired(){
+#if !defined KHICAS && !defined SDL_KHICAS
+    if (!cancelled && deadline>0 && realtime()>=deadline)
+      cancel();
+#endif
+    return cancelled;
+  }
+
+  bool eval_cancelled(){
+    eval_token * t=current_eval_token;
+    return t && t->cancelled;
+  }
+
+  bool memory_exceeded(){
+    eval_token * t=current_eval_token;
+    return t && t->outofmem;
+  }
+
+  GIAC_THREAD_LOCAL double caseval_maxmem=0;
+
+  // defined for all builds since imvector (vector.h) tests the flag, it
+  // is only set when GIAC_MEMORY_BUDGET is defined
+  bool memory_budget_on=false;
+
+  // the thread pool tasks of an evaluation are charged to its token (see
+  // pool_run in threaded.cc), the charges are atomic
+  void memory_charge_(size_t bytes){
+    eval_token * t=current_eval_token;
+    if (!t || !t->maxmem)
+      return;
+#ifdef GIAC_ATOMIC_BUILTINS
+    size_t mem=__atomic_add_fetch(&t->mem,bytes,__ATOMIC_RELAXED);
+#else
+    size_t mem=(t->mem += bytes);
+#endif
+    if (mem>t->maxmem && !t->outofmem){
+      t->outofmem=true;
+      t->cancel();
+    }
+  }
+
+  // objects allocated by a previous evaluation may be freed by this one
+  void memory_release_(size_t bytes){
+    eval_token * t=current_eval_token;
+    if (!t)
+      return;
+#ifdef GIAC_ATOMIC_BUILTINS
+    size_t mem=__atomic_load_n(&t->mem,__ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&t->mem,&mem,mem>bytes?mem-bytes:0,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+      ;
+#else
+    t->mem=t->mem>bytes?t->mem-bytes:0;
+#endif
+  }
+
+#ifdef GIAC_MEMORY_BUDGET
+#if !defined USE_GMP_REPLACEMENTS && !defined BF2GMP_H
+  // same as GMP default functions, with charges
+  static void * budget_gmp_alloc(size_t n){
+    memory_charge(n);
+    void * res=malloc(n);
+    if (!res){
+      CERR << "GNU MP: Cannot allocate memory (size=" << n << ")" << '\n';
+      abort();
+    }
+    return res;
+  }
+
+  static void * budget_gmp_realloc(void * ptr,size_t old_size,size_t new_size){
+    if (new_size>old_size)
+      memory_charge(new_size-old_size);
+    else
+      memory_release(old_size-new_size);
+    void * res=realloc(ptr,new_size);
+    if (!res){
+      CERR << "GNU MP: Cannot reallocate memory (old_size=" << old_size << " new_size=" << new_size << ")" << '\n';
+      abort();
+    }
+    return res;
+  }
+
+  static void budget_gmp_free(void * ptr,size_t size){
+    memory_release(size);
+    free(ptr);
+  }
+#endif
+#endif // GIAC_MEMORY_BUDGET
+
+  void eval_token::set_memory_limit(size_t bytes){
+    maxmem=bytes;
+#ifdef GIAC_MEMORY_BUDGET
+    if (bytes && !memory_budget_on){
+      memory_budget_on=true;
+#if !defined USE_GMP_REPLACEMENTS && !defined BF2GMP_H
+      mp_set_memory_functions(budget_gmp_alloc,budget_gmp_realloc,budget_gmp_free);
+#endif
+    }
+#endif
+  }
+
+  bool memory_check(double bytes){
+    eval_token * t=current_eval_token;
+    if (!t || !t->maxmem)
+      return true;
+    if (!t->outofmem && t->mem+bytes<=t->maxmem)
+      return true;
+    if (!t->outofmem){
+      t->outofmem=true;
+      t->cancel();
+    }
+    return false;
+  }
+
+  bool perf_on=false;
+  longlong perf_counters[PERF_N];
+  static longlong perf_last[PERF_N]; // counters of the previous evaluation
+  static GIAC_THREAD_LOCAL unsigned perf_active=0; // running timers
+
+  static const char * const perf_names[PERF_N]={
+    0,0,"alloc_zint",0,"alloc_cplx",0,0,"alloc_vect","alloc_symb",
+    "mult_small","mult_medium","mult_large",
+    "gcd_heu","gcd_modular","gcd_ez","gcd_psr","gcd_cache_hits","gcd_cache_misses",
+    "f4_matrices","f4_rows","f4_cols","f4_maxrows","f4_maxcols",
+    "primes",
+    "time_parse","time_eval","time_mult","time_gcd","time_factor","time_gbasis"
+  };
+
+  void perf_max(int c,longlong n){
+    if (!perf_on)
+      return;
+#ifdef GIAC_ATOMIC_BUILTINS
+    longlong cur=__atomic_load_n(&perf_counters[c],__ATOMIC_RELAXED);
+    while (cur<n && !__atomic_compare_exchange_n(&perf_counters[c],&cur,n,true,__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+      ;
+#else
+    if (perf_counters[c]<n)
+      perf_counters[c]=n;
+#endif
+  }
+
+  perf_timer::perf_timer(int c_):c(-1),t0(0){
+    if (!perf_on)
+      return;
+    unsigned bit=1u << (c_-PERF_TIME_PARSE);
+    if (perf_active & bit)
+      return;
+    perf_active |= bit;
+    c=c_;
+    t0=realtime();
+  }
+
+  perf_timer::~perf_timer(){
+    if (c<0)
+      return;
+    perf_active &= ~(1u << (c-PERF_TIME_PARSE));
+    perf_add(c,longlong((realtime()-t0)*1e6));
+  }
+
+  void perf_stats(bool on){
+    if (on && !perf_on){
+      for (int i=0;i<PERF_N;++i)
+	perf_counters[i]=perf_last[i]=0;
+    }
+    perf_on=on;
+  }
+
+  bool perf_stats(){
+    return perf_on;
+  }
+
+  void perf_begin(){
+    if (!perf_on)
+      return;
+    for (int i=0;i<PERF_N;++i){
+#ifdef GIAC_ATOMIC_BUILTINS
+      perf_last[i]=__atomic_exchange_n(&perf_counters[i],0,__ATOMIC_RELAXED);
+#else
+      perf_last[i]=perf_counters[i];
+      perf_counters[i]=0;
+#endif
+    }
+  }
+
+  string perf_json(bool last){
+    const longlong * v=last?perf_last:perf_counters;
+    string s="{";
+    for (int i=0;i<PERF_N;++i){
+      if (!perf_names[i])
+	continue;
+      if (s.size()>1)
+	s += ',';
+      s += '"';
+      s += perf_names[i];
+      s += "\":";
+      char buf[32];
+      sprintf(buf,"%lld",(long long) v[i]);
+      s += buf;
+    }
+    return s+"}";
+  }
+
+  bool trace_on=false;
+  struct trace_event {
+    const char * name;
+    longlong arg;
+    double ts,dur; // microseconds since trace_start
+    int tid;
+  };
+  static vector<trace_event> trace_events;
+  static double trace_t0=0;
+  static int trace_ntids=0;
+  static unsigned trace_dropped=0;
+  static GIAC_THREAD_LOCAL int trace_tid=0; // 1 for the first thread traced
+  const int TRACE_MAXDEPTH=32;
+  static GIAC_THREAD_LOCAL const char * trace_open[TRACE_MAXDEPTH]; // open scopes
+  static GIAC_THREAD_LOCAL int trace_depth=0;
+  const unsigned TRACE_MAXEVENTS=1<<20;
+  const double TRACE_MINDUR=5e-6; // shorter events are not recorded
+#ifdef HAVE_LIBPTHREAD
+  static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+  void trace_scope::begin(const char * name_){
+    if (trace_depth>=TRACE_MAXDEPTH)
+      return;
+    for (int i=0;i<trace_depth;++i){
+      if (trace_open[i]==name_)
+	return;
+    }
+    trace_open[trace_depth++]=name=name_;
+    t0=realtime();
+  }
+
+  void trace_scope::end(){
+    double t1=realtime();
+    --trace_depth;
+    if (t1-t0<TRACE_MINDUR)
+      return;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&trace_mutex);
+#endif
+    if (!trace_tid)
+      trace_tid=++trace_ntids;
+    if (trace_events.size()<TRACE_MAXEVENTS){
+      trace_event e={name,arg,(t0-trace_t0)*1e6,(t1-t0)*1e6,trace_tid};
+      trace_events.push_back(e);
+    }
+    else
+      ++trace_dropped;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&trace_mutex);
+#endif
+  }
+
+  void trace_start(){
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&trace_mutex);
+#endif
+    trace_events.clear();
+    trace_dropped=0;
+    trace_t0=realtime();
+    trace_on=true;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&trace_mutex);
+#endif
+  }
+
+  string trace_json(){
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&trace_mutex);
+#endif
+    string s="{\"traceEvents\":[";
+    char buf[128];
+    for (size_t i=0;i<trace_events.size();++i){
+      const trace_event & e=trace_events[i];
+      if (i)
+	s += ",\n";
+      s += "{\"name\":\"";
+      s += e.name;
+      sprintf(buf,"\",\"ph\":\"X\",\"ts\":%.1f,\"dur\":%.1f,\"pid\":1,\"tid\":%d",e.ts,e.dur,e.tid);
+      s += buf;
+      if (e.arg>=0){
+	sprintf(buf,",\"args\":{\"arg\":%lld}",(long long) e.arg);
+	s += buf;
+      }
+      s += '}';
+    }
+    sprintf(buf,"],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%u}}\n",trace_dropped);
+    s += buf;
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&trace_mutex);
+#endif
+    return s;
+  }
+
+  bool trace_save(const string & filename){
+    trace_on=false;
+    string s=trace_json();
+    FILE * f=fopen(filename.c_str(),"w");
+    if (!f)
+      return false;
+    bool ok=fwrite(s.c_str(),1,s.size(),f)==s.size();
+    return fclose(f)==0 && ok;
+  }
 #ifdef GIAC_HAS_STO_38
-  double powlog2float=1e4*10; // increase max int size for HP Prime
-  int MPZ_MAXLOG2=8600*10; // max 2^8600 about 1K*10
+  GIAC_THREAD_LOCAL double powlog2float=1e4*10; // increase max int size for HP Prime
+  GIAC_THREAD_LOCAL int MPZ_MAXLOG2=8600*10; // max 2^8600 about 1K*10
 #else
-  double powlog2float=1e8;
-  int MPZ_MAXLOG2=80000000; // 100 millions bits
+  GIAC_THREAD_LOCAL double powlog2float=1e8;
+  GIAC_THREAD_LOCAL int MPZ_MAXLOG2=80000000; // 100 millions bits
 #endif
+
+  // tunables of a thread before any change, for install_tunables
+  static eval_tunables initial_tunables(){
+    eval_tunables t;
+    read_tunables(_TUNE_ALL,t);
+    return t;
+  }
+  const eval_tunables default_tunables=initial_tunables();
 #ifdef HAVE_LIBNTL
   int PROOT_FACTOR_MAXDEG=300;
 #else
@@ -3905,7 +4371,13 @@ extern "C" void Sleep(unsigned int miliSecond);
   pid_t child_id=0; // child process (to replace by a vector of childs?)
 
   void ctrl_c_signal_handler(int signum){
-    ctrl_c=true;
+    global_interrupt_flags._ctrl_c=true;
+    // evaluations running with a token do not read the global flags
+    for (int i=0;i<EVAL_TOKEN_MAX;++i){
+      eval_token * t=active_eval_tokens[i];
+      if (t)
+	t->flags._ctrl_c=true;
+    }
 #if !defined KHICAS && !defined SDL_KHICAS && !defined NSPIRE_NEWLIB && !defined WIN32 && !defined BESTA_OS && !defined NSPIRE && !defined FXCG && !defined POCKETCAS && !defined __MINGW_H
     if (child_id)
       kill(child_id,SIGINT);
@@ -5707,6 +6179,71 @@ NULL,NULL,SW_SHOWNORMAL);
     return ptr;
   }
 
+  // copy the parts of g that may be modified in place by sto (=<),
+  // including those inside symbolics (program bodies, local initializers),
+  // changed is set if the result is not g itself
+  static gen snapshot_copy(const gen & g,bool & changed){
+    switch (g.type){
+    case _VECT: {
+      vecteur v(*g._VECTptr);
+      iterateur it=v.begin(),itend=v.end();
+      for (;it!=itend;++it)
+	*it=snapshot_copy(*it,changed);
+      changed=true;
+      return gen(v,g.subtype);
+    }
+    case _MAP: {
+      gen res=makemap();
+      gen_map::const_iterator it=g._MAPptr->begin(),itend=g._MAPptr->end();
+      for (;it!=itend;++it)
+	(*res._MAPptr)[it->first]=snapshot_copy(it->second,changed);
+      res.subtype=g.subtype;
+      changed=true;
+      return res;
+    }
+    case _STRNG:
+      changed=true;
+      return string2gen(*g._STRNGptr,g.subtype==-1);
+    case _SYMB: {
+      // symbolics without mutable leaves stay shared
+      bool ch=false;
+      gen f=snapshot_copy(g._SYMBptr->feuille,ch);
+      if (!ch)
+	return g;
+      changed=true;
+      return symbolic(g._SYMBptr->sommet,f);
+    }
+    }
+    return g;
+  }
+
+  context * clone_snapshot(const context * contextptr){
+    if (!contextptr)
+      return clone_context(0);
+    context * ptr = new context;
+    *ptr->globalptr = *contextptr->globalptr;
+    sym_tab::const_iterator it=contextptr->tabptr->begin(),itend=contextptr->tabptr->end();
+    for (;it!=itend;++it){
+      if (it->second.type==_POINTER_)
+	continue;
+      bool changed=false;
+      (*ptr->tabptr)[it->first]=snapshot_copy(it->second,changed);
+    }
+    *ptr->quoted_global_vars=*contextptr->quoted_global_vars;
+    *ptr->rootofs=*contextptr->rootofs;
+    return ptr;
+  }
+
+  context * snapshot_context(const context * contextptr){
+    context * ptr=clone_snapshot(contextptr);
+    // clones may be evaluated by other threads
+    sym_tab::const_iterator it=ptr->tabptr->begin(),itend=ptr->tabptr->end();
+    for (;it!=itend;++it)
+      publish_gen(it->second);
+    publish_gen(*ptr->rootofs);
+    return ptr;
+  }
+
   context::~context(){
     // CERR << "delete context " << this << '\n';
     if (!previous){
@@ -6223,6 +6760,7 @@ NULL,NULL,SW_SHOWNORMAL);
      _currently_scanned_=g._currently_scanned_;
      _max_sum_sqrt_=g._max_sum_sqrt_;
      _max_sum_add_=g._max_sum_add_;
+     _tunables_=g._tunables_;
      _turtle_=g._turtle_;
 #if !defined KHICAS && !defined SDL_KHICAS
      _turtle_stack_=g._turtle_stack_;
@@ -7024,6 +7562,7 @@ unsigned int ConvertUTF8toUTF162 (
 	res=it->second;
       else {
 	res=identificateur(sch);
+	publish_gen(res);
 	syms()[sch]=res;
       }
       unlock_syms_mutex();  
@@ -7173,15 +7712,458 @@ unsigned int ConvertUTF8toUTF162 (
     return archive_restore(f,(size_t (*)(void * p, size_t nbBytes,size_t NbElements, void *file))fread,contextptr);
   }
 
+  // Portable binary archive, version 1. Unlike archive_save it does not
+  // depend on the in-memory layout of gen: all integers are little endian.
+  // Header: "GIACBIN" version(1 byte) payload size(8 bytes), then one node.
+  // A node is type(1) subtype(1) followed by
+  // _INT_: 4 bytes; _DOUBLE_: 8 bytes IEEE (subtype 0)
+  // _ZINT: signed limb count(4) + 64 bits limbs, least significant first
+  // _CPLX, _FRAC, _MOD: 2 nodes
+  // _VECT: count(4) kind(1), kind 1 = packed 4 bytes _INT_ values, else nodes
+  // _MAP: count(4) + key and value nodes
+  // _POLY: dim(4) count(4) order(1), all exponents (2 bytes each), coeffs
+  // _SYMB: function + feuille node; _FUNC: function
+  //   a function is its archive index(2), for index 0 followed by the name
+  // _IDNT, _STRNG: length(4) + name/string
+  // Other types can not be saved. Nodes are nested at most
+  // BINARY_ARCHIVE_MAXDEPTH deep.
+  // Bulk data (limbs, exponents, packed integers) is read directly from the
+  // buffer, binary_archive_read_file maps the file instead of reading it.
+  static const char binary_archive_magic[]="GIACBIN";
+  static const unsigned char binary_archive_version=1;
+#define BINARY_ARCHIVE_MAXDEPTH 4096
+
+  static void binary_put(std::string & s,ulonglong u,int nbytes){
+    for (int i=0;i<nbytes;++i,u >>= 8)
+      s += char(u & 0xff);
+  }
+
+  static void binary_put_string(std::string & s,const char * ch,size_t l){
+    binary_put(s,l,4);
+    s.append(ch,l);
+  }
+
+  static bool binary_little_endian(){
+    unsigned u=1;
+    return *(unsigned char *)&u==1;
+  }
+
+  static void binary_put_function(std::string & s,const unary_function_ptr & f){
+    short i=archive_function_index(f);
+    binary_put(s,(unsigned short) i,2);
+    if (!i)
+      binary_put_string(s,f.ptr()->s,strlen(f.ptr()->s));
+  }
+
+  static bool binary_save(std::string & s,const gen & g,int depth,GIAC_CONTEXT){
+    if (++depth>BINARY_ARCHIVE_MAXDEPTH)
+      return false;
+    s += char(g.type);
+    // the subtype of a double overlaps its value on some layouts
+    s += char(g.type==_DOUBLE_?0:g.subtype);
+    switch (g.type){
+    case _INT_:
+      binary_put(s,(unsigned) g.val,4);
+      return true;
+    case _DOUBLE_: {
+      double d=g._DOUBLE_val;
+      ulonglong u;
+      memcpy(&u,&d,sizeof(u));
+      binary_put(s,u,8);
+      return true;
+    }
+    case _ZINT: {
+      const mpz_t & z=*g._ZINTptr;
+      size_t n=mpz_sgn(z)?(mpz_sizeinbase(z,2)+63)/64:0;
+      binary_put(s,(unsigned) (mpz_sgn(z)<0?-int(n):int(n)),4);
+      if (!n)
+	return true;
+      size_t pos=s.size();
+      s.resize(pos+8*n);
+      size_t count=0;
+      mpz_export(&s[pos],&count,-1,8,-1,0,z);
+      return count==n;
+    }
+    case _CPLX:
+      return binary_save(s,*g._CPLXptr,depth,contextptr) && binary_save(s,*(g._CPLXptr+1),depth,contextptr);
+    case _MOD:
+      return binary_save(s,*g._MODptr,depth,contextptr) && binary_save(s,*(g._MODptr+1),depth,contextptr);
+    case _FRAC:
+      return binary_save(s,g._FRACptr->num,depth,contextptr) && binary_save(s,g._FRACptr->den,depth,contextptr);
+    case _VECT: {
+      const_iterateur it=g._VECTptr->begin(),itend=g._VECTptr->end();
+      binary_put(s,itend-it,4);
+      const_iterateur jt=it;
+      for (;jt!=itend;++jt){
+	if (jt->type!=_INT_ || jt->subtype)
+	  break;
+      }
+      s += char(jt==itend);
+      if (jt==itend){
+	for (;it!=itend;++it)
+	  binary_put(s,(unsigned) it->val,4);
+	return true;
+      }
+      for (;it!=itend;++it){
+	if (!binary_save(s,*it,depth,contextptr))
+	  return false;
+      }
+      return true;
+    }
+    case _MAP: {
+      binary_put(s,g._MAPptr->size(),4);
+      gen_map::const_iterator it=g._MAPptr->begin(),itend=g._MAPptr->end();
+      for (;it!=itend;++it){
+	if (!binary_save(s,it->first,depth,contextptr) || !binary_save(s,it->second,depth,contextptr))
+	  return false;
+      }
+      return true;
+    }
+    case _POLY: {
+      const polynome & p=*g._POLYptr;
+      binary_put(s,p.dim,4);
+      binary_put(s,p.coord.size(),4);
+      char order=_PLEX_ORDER;
+      if (p.is_strictly_greater==i_total_revlex_is_strictly_greater)
+	order=_REVLEX_ORDER;
+      if (p.is_strictly_greater==i_total_lex_is_strictly_greater)
+	order=_TDEG_ORDER;
+      s += order;
+      vector< monomial<gen> >::const_iterator it=p.coord.begin(),itend=p.coord.end();
+      for (;it!=itend;++it){
+	if (int(it->index.size())!=p.dim)
+	  return false;
+	index_t::const_iterator jt=it->index.begin(),jtend=it->index.end();
+	for (;jt!=jtend;++jt)
+	  binary_put(s,(unsigned short) *jt,2);
+      }
+      for (it=p.coord.begin();it!=itend;++it){
+	if (!binary_save(s,it->value,depth,contextptr))
+	  return false;
+      }
+      return true;
+    }
+    case _SYMB:
+      binary_put_function(s,g._SYMBptr->sommet);
+      return binary_save(s,g._SYMBptr->feuille,depth,contextptr);
+    case _FUNC:
+      binary_put_function(s,*g._FUNCptr);
+      return true;
+    case _IDNT:
+      binary_put_string(s,g._IDNTptr->id_name,strlen(g._IDNTptr->id_name));
+      return true;
+    case _STRNG:
+      binary_put_string(s,g._STRNGptr->c_str(),g._STRNGptr->size());
+      return true;
+    }
+    return false;
+  }
+
+  bool binary_archive_save(std::string & s,const gen & g,GIAC_CONTEXT){
+    size_t start=s.size();
+    s.append(binary_archive_magic,7);
+    s += char(binary_archive_version);
+    binary_put(s,0,8);
+    size_t pos=s.size();
+    if (!binary_save(s,g,0,contextptr)){
+      s.resize(start);
+      return false;
+    }
+    ulonglong size=s.size()-pos;
+    for (int i=0;i<8;++i,size >>= 8)
+      s[pos-8+i]=char(size & 0xff);
+    return true;
+  }
+
+  struct binary_reader {
+    const unsigned char * ptr, * end;
+    bool get(ulonglong & u,int nbytes){
+      if (end-ptr<nbytes)
+	return false;
+      u=0;
+      for (int i=nbytes-1;i>=0;--i)
+	u=(u << 8) | ptr[i];
+      ptr += nbytes;
+      return true;
+    }
+    bool get(unsigned & u,int nbytes){
+      ulonglong v;
+      if (!get(v,nbytes))
+	return false;
+      u=unsigned(v);
+      return true;
+    }
+    bool get_string(std::string & s){
+      unsigned l;
+      if (!get(l,4) || unsigned(end-ptr)<l)
+	return false;
+      s.assign((const char *) ptr,l);
+      ptr += l;
+      return true;
+    }
+  };
+
+  static bool binary_get_function(binary_reader & r,unary_function_ptr & f,GIAC_CONTEXT){
+    unsigned i;
+    if (!r.get(i,2))
+      return false;
+    if (i){
+      if (!archive_function_tab_length)
+	archive_function_tab();
+      if (int(i)>=archive_function_tab_length)
+	return false;
+      f=archive_function_tab()[i-1];
+      return true;
+    }
+    string name;
+    if (!r.get_string(name))
+      return false;
+    gen res(name,contextptr);
+    if (res.type!=_FUNC)
+      return false;
+    f=*res._FUNCptr;
+    return true;
+  }
+
+  // a _CPLX, _FRAC or _MOD exactly as saved (no normalization)
+  static gen binary_pair(unsigned char t,const gen & a,const gen & b){
+    gen res;
+#ifdef SMARTPTR64
+    if (t==_CPLX)
+      * ((ulonglong * ) &res) = ulonglong(new ref_complex(a,b)) << 16;
+    else if (t==_FRAC)
+      * ((ulonglong * ) &res) = ulonglong(new ref_fraction(fraction(a,b))) << 16;
+    else
+      * ((ulonglong * ) &res) = ulonglong(new ref_modulo(a,b)) << 16;
+#else
+    if (t==_CPLX)
+      res.__CPLXptr=new ref_complex(a,b);
+    else if (t==_FRAC)
+      res.__FRACptr=new ref_fraction(fraction(a,b));
+    else
+      res.__MODptr=new ref_modulo(a,b);
+#endif
+    res.type=t;
+    return res;
+  }
+
+  static bool binary_restore(binary_reader & r,gen & res,int depth,GIAC_CONTEXT){
+    if (r.end-r.ptr<2 || ++depth>BINARY_ARCHIVE_MAXDEPTH)
+      return false;
+    unsigned char t=r.ptr[0];
+    signed char st=r.ptr[1];
+    r.ptr += 2;
+    unsigned u;
+    switch (t){
+    case _INT_:
+      if (!r.get(u,4))
+	return false;
+      res=int(u);
+      res.subtype=st;
+      return true;
+    case _DOUBLE_: {
+      ulonglong v;
+      if (!r.get(v,8))
+	return false;
+      double d;
+      memcpy(&d,&v,sizeof(d));
+      res=d;
+      return true;
+    }
+    case _ZINT: {
+      if (!r.get(u,4))
+	return false;
+      int n=int(u);
+      size_t l=n<0?-n:n;
+      if (size_t(r.end-r.ptr)/8<l)
+	return false;
+      ref_mpz_t * m=new ref_mpz_t(64*l);
+      mpz_import(m->z,l,-1,8,-1,0,r.ptr);
+      r.ptr += 8*l;
+      if (n<0)
+	mpz_neg(m->z,m->z);
+      res=gen(m);
+      return true;
+    }
+    case _CPLX: case _MOD: case _FRAC: {
+      gen a,b;
+      if (!binary_restore(r,a,depth,contextptr) || !binary_restore(r,b,depth,contextptr))
+	return false;
+      res=binary_pair(t,a,b);
+      res.subtype=st;
+      return true;
+    }
+    case _VECT: {
+      if (!r.get(u,4) || r.ptr==r.end)
+	return false;
+      bool packed=*r.ptr++;
+      if (unsigned(r.end-r.ptr)/(packed?4:2)<u)
+	return false;
+      res=gen(vecteur(0),st);
+      vecteur & v=*res._VECTptr;
+      v.reserve(u);
+      for (unsigned k=0;k<u;++k){
+	unsigned w;
+	if (packed && r.get(w,4))
+	  v.push_back(int(w));
+	else {
+	  v.push_back(0);
+	  if (packed || !binary_restore(r,v.back(),depth,contextptr))
+	    return false;
+	}
+      }
+      return true;
+    }
+    case _MAP: {
+      if (!r.get(u,4) || unsigned(r.end-r.ptr)/4<u)
+	return false;
+      res=makemap();
+      res.subtype=st;
+      for (unsigned k=0;k<u;++k){
+	gen a,b;
+	if (!binary_restore(r,a,depth,contextptr) || !binary_restore(r,b,depth,contextptr))
+	  return false;
+	(*res._MAPptr)[a]=b;
+      }
+      return true;
+    }
+    case _POLY: {
+      unsigned dim,n;
+      if (!r.get(dim,4) || !r.get(n,4) || r.ptr==r.end)
+	return false;
+      int order=*r.ptr++;
+      if (dim && unsigned(r.end-r.ptr)/(2*dim)<n)
+	return false;
+      polynome p(dim);
+      change_monomial_order(p,order);
+      p.coord.reserve(n);
+      index_t i(dim);
+      bool le=binary_little_endian() && sizeof(deg_t)==2;
+      for (unsigned k=0;k<n;++k){
+	if (le && dim)
+	  memcpy(&i.front(),r.ptr,2*dim);
+	else {
+	  for (unsigned j=0;j<dim;++j)
+	    i[j]=deg_t(r.ptr[2*j] | (r.ptr[2*j+1] << 8));
+	}
+	r.ptr += 2*dim;
+	p.coord.push_back(monomial<gen>(0,index_m(i)));
+      }
+      vector< monomial<gen> >::iterator it=p.coord.begin(),itend=p.coord.end();
+      for (;it!=itend;++it){
+	if (!binary_restore(r,it->value,depth,contextptr))
+	  return false;
+      }
+      res=gen(p);
+      return true;
+    }
+    case _SYMB: case _FUNC: {
+      unary_function_ptr f(*at_plus);
+      if (!binary_get_function(r,f,contextptr))
+	return false;
+      if (t==_FUNC)
+	res=f;
+      else {
+	gen fe;
+	if (!binary_restore(r,fe,depth,contextptr))
+	  return false;
+	res=symbolic(f,fe);
+      }
+      res.subtype=st;
+      return true;
+    }
+    }
+    string s;
+    if ((t!=_IDNT && t!=_STRNG) || !r.get_string(s))
+      return false;
+    if (t==_IDNT){
+      lock_syms_mutex();
+      sym_string_tab::const_iterator it=syms().find(s),itend=syms().end();
+      if (it!=itend)
+	res=it->second;
+      else {
+	res=identificateur(s);
+	publish_gen(res);
+	syms()[s]=res;
+      }
+      unlock_syms_mutex();
+      return true;
+    }
+    res=string2gen(s,false);
+    res.subtype=st;
+    return true;
+  }
+
+  gen binary_archive_restore(const char * buf,size_t len,GIAC_CONTEXT){
+    binary_reader r;
+    r.ptr=(const unsigned char *) buf;
+    r.end=r.ptr+len;
+    ulonglong size;
+    if (len<16 || memcmp(buf,binary_archive_magic,7) || r.ptr[7]!=binary_archive_version)
+      return undef;
+    r.ptr += 8;
+    if (!r.get(size,8) || size>ulonglong(r.end-r.ptr))
+      return undef;
+    r.end=r.ptr+size;
+    gen res;
+    if (!binary_restore(r,res,0,contextptr) || r.ptr!=r.end)
+      return undef;
+    return res;
+  }
+
+  bool binary_archive_write_file(const char * filename,const gen & g,GIAC_CONTEXT){
+    string s;
+    if (!binary_archive_save(s,g,contextptr))
+      return false;
+    FILE * f=fopen(filename,"wb");
+    if (!f)
+      return false;
+    bool ok=fwrite(s.c_str(),1,s.size(),f)==s.size();
+    return fclose(f)==0 && ok;
+  }
+
+  gen binary_archive_read_file(const char * filename,GIAC_CONTEXT){
+#ifdef GIAC_BINARY_ARCHIVE_MMAP
+    int fd=open(filename,O_RDONLY);
+    if (fd<0)
+      return undef;
+    struct stat st;
+    if (fstat(fd,&st) || st.st_size==0){
+      close(fd);
+      return undef;
+    }
+    void * buf=mmap(0,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (buf==MAP_FAILED)
+      return undef;
+    gen res;
+    try {
+      res=binary_archive_restore((const char *) buf,st.st_size,contextptr);
+    } catch (...){
+      munmap(buf,st.st_size);
+      throw;
+    }
+    munmap(buf,st.st_size);
+    return res;
+#else
+    FILE * f=fopen(filename,"rb");
+    if (!f)
+      return undef;
+    string s;
+    char tmp[4096];
+    for (size_t n;(n=fread(tmp,1,sizeof(tmp),f))>0;)
+      s.append(tmp,n);
+    fclose(f);
+    return binary_archive_restore(s.c_str(),s.size(),contextptr);
+#endif
+  }
+
   void init_geogebra(bool on,GIAC_CONTEXT){
 #ifndef FXCG
     setlocale(LC_NUMERIC,"POSIX");
 #endif
-    _decimal_digits_=on?13:12;
-    _all_trig_sol_=on;
-    _withsqrt_=!on;
-    _calc_mode_=on?1:0;
-    _eval_equaltosto_=on?0:1;
+    // the setters change the process defaults (copied by new contexts)
+    // only without a session, other threads may be creating contexts
     eval_equaltosto(on?0:1,contextptr);
     decimal_digits(on?13:12,contextptr);
     all_trig_sol(on,contextptr);
@@ -7193,7 +8175,9 @@ unsigned int ConvertUTF8toUTF162 (
     //caseval_maxtime=5;
     caseval_n=0;
     caseval_mod=10;
+    store_tunables(_TUNE_CASEVAL_MOD,contextptr);
 #endif
+    store_tunables(_TUNE_POWLOG2FLOAT | _TUNE_MPZ_MAXLOG2,contextptr);
   }
 
   vecteur giac_current_status(bool save_history,GIAC_CONTEXT){
@@ -7631,14 +8615,13 @@ void update_lexer_localization(const std::vector<int> & v,std::map<std::string,s
 	ustl::equal_range(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),
 		    std::pair<const char *,gen>(s,0),
 		    tri);
-#else
-      std::pair<charptr_gen *,charptr_gen *> p=
-	equal_range(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),
-		    std::pair<const char *,gen>(s,0),
-		    tri);
-#endif
       if (p.first!=p.second && p.first!=builtin_lexer_functions_end())
 	return (p.first->second.subtype!=T_UNARY_OP-256);
+#else
+      charptr_gen * f=builtin_lexer_functions_find(s);
+      if (f!=builtin_lexer_functions_end())
+	return (f->second.subtype!=T_UNARY_OP-256);
+#endif
       map_charptr_gen::const_iterator i = lexer_functions().find(s);
       if (i==lexer_functions().end())
 	return false;
@@ -7718,8 +8701,7 @@ void update_lexer_localization(const std::vector<int> & v,std::map<std::string,s
 
 #if defined EMCC || defined EMCC2 || defined SIMU
   bool cas_builtin(const char * s,GIAC_CONTEXT){
-    std::pair<charptr_gen *,charptr_gen *> p=std::equal_range(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),std::pair<const char *,gen>(s,0),tri);
-    bool res=p.first!=p.second && p.first!=builtin_lexer_functions_end();
+    bool res=builtin_lexer_functions_find(s)!=builtin_lexer_functions_end();
     if (res)
       return res;
     gen g;
@@ -7795,7 +8777,8 @@ void update_lexer_localization(const std::vector<int> & v,std::map<std::string,s
       std::map<std::string,std::vector<string> >::const_iterator j=lexer_translator().find(ts);
       if (j!=lexer_translator().end() && !j->second.empty())
 	ts=j->second.back();
-      std::pair<charptr_gen *,charptr_gen *> p=equal_range(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),std::pair<const char *,gen>(ts.c_str(),0),tri);
+      charptr_gen * f=builtin_lexer_functions_find(ts.c_str());
+      std::pair<charptr_gen *,charptr_gen *> p(f,f==builtin_lexer_functions_end()?f:f+1);
 #endif
       if (p.first!=p.second && p.first!=builtin_lexer_functions_end()){
 	if (p.first->second.subtype==T_TO-256)
@@ -7889,6 +8872,7 @@ void update_lexer_localization(const std::vector<int> & v,std::map<std::string,s
 		++i;
 	      }
 	      res = identificateur(name);
+	      publish_gen(res);
 	      lock_syms_mutex();
 	      syms()[name] = res;
 	      unlock_syms_mutex();
@@ -7938,12 +8922,15 @@ void update_lexer_localization(const std::vector<int> & v,std::map<std::string,s
 	    res=args.front();
 	  else 
 	    res=_prod(args,contextptr);
+	  publish_gen(res);
 	  lock_syms_mutex();
 	  syms()[s]=res;
 	  unlock_syms_mutex();
 	  return T_SYMBOL;
 	} // end 38 compatibility mode
 	res = identificateur(s);
+	// shared by all the threads that parse this name
+	publish_gen(res);
 	lock_syms_mutex();
 	syms()[s] = res;
 	unlock_syms_mutex();
@@ -7965,8 +8952,10 @@ void update_lexer_localization(const std::vector<int> & v,std::map<std::string,s
 	continue;
       lock_syms_mutex();
       sym_string_tab::const_iterator i = syms().find(it->_IDNTptr->id_name),iend=syms().end();
-      if (i==iend)
+      if (i==iend){
+	publish_gen(*it);
 	syms()[it->_IDNTptr->name()] = *it;
+      }
       unlock_syms_mutex();  
     }
   }
@@ -8973,6 +9962,59 @@ void update_lexer_localization(const std::vector<int> & v,std::map<std::string,s
       return * ans;
     }
 
+    // open addressing table of positions in builtin_lexer_functions,
+    // replaces the binary search of find_or_make_symbol by one strcmp
+    static vector<int> * builtin_lexer_hash=0;
+
+    static unsigned builtin_lexer_hashval(const char * s){
+      unsigned h=2166136261u;
+      for (;*s;++s)
+	h=(h^(unsigned char)*s)*16777619u;
+      return h;
+    }
+
+    void builtin_lexer_functions_index(){
+      unsigned n=builtin_lexer_functions_number,size=1;
+      while (size<2*n)
+	size*=2;
+      vector<int> * tab=new vector<int>(size,-1);
+      charptr_gen * b=builtin_lexer_functions_begin();
+      for (unsigned i=0;i<n;++i){
+	unsigned h=builtin_lexer_hashval(b[i].first)&(size-1);
+	while ((*tab)[h]>=0)
+	  h=(h+1)&(size-1);
+	(*tab)[h]=i;
+      }
+      vector<int> * old=builtin_lexer_hash;
+      builtin_lexer_hash=tab;
+      delete old;
+    }
+
+    charptr_gen * builtin_lexer_functions_find(const char * s){
+      if (!builtin_lexer_hash || !builtin_lexer_functions_sorted){
+#ifdef STATIC_BUILTIN_LEXER_FUNCTIONS
+	std::pair<charptr_gen *,charptr_gen *> p=equal_range(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),std::pair<const char *,gen>(s,0),tri);
+	return p.first!=p.second?p.first:builtin_lexer_functions_end();
+#else
+	// still registering, the table is not sorted
+	charptr_gen * it=builtin_lexer_functions_begin(),* itend=builtin_lexer_functions_end();
+	for (;it!=itend;++it){
+	  if (!strcmp(it->first,s))
+	    break;
+	}
+	return it;
+#endif
+      }
+      const vector<int> & tab=*builtin_lexer_hash;
+      unsigned mask=unsigned(tab.size())-1,h=builtin_lexer_hashval(s)&mask;
+      charptr_gen * b=builtin_lexer_functions_begin();
+      for (;tab[h]>=0;h=(h+1)&mask){
+	if (!strcmp(b[tab[h]].first,s))
+	  return b+tab[h];
+      }
+      return builtin_lexer_functions_end();
+    }
+
 
 #ifdef STATIC_BUILTIN_LEXER_FUNCTIONS
     
@@ -747,7 +747,7 @@ namespace giac {
   identificateur::identificateur(const identificateur & s){
     ref_count_ptr=s.ref_count_ptr;
     if (ref_count_ptr)
-      ++(*ref_count_ptr);
+      ref_count_incr(ref_count_ptr);
     value=s.value;
     quoted=s.quoted;
     localvalue=s.localvalue;
@@ -756,8 +756,7 @@ namespace giac {
 
   identificateur::~identificateur(){
     if (ref_count_ptr){
-      --(*ref_count_ptr);
-      if (!(*ref_count_ptr)){
+      if (ref_count_decr(ref_count_ptr)){
 	int_string_shortint_bool * ptr = (int_string_shortint_bool *) ref_count_ptr;
 	if (ptr->s_dynalloc)
 	  delete [] ptr->s;
@@ -779,8 +778,7 @@ namespace giac {
 
   identificateur & identificateur::operator =(const identificateur & s){
     if (ref_count_ptr){
-      --(*ref_count_ptr);
-      if (!(*ref_count_ptr)){
+      if (ref_count_decr(ref_count_ptr)){
 	int_string_shortint_bool * ptr = (int_string_shortint_bool *) ref_count_ptr;
 	if (ptr->s_dynalloc)
 	  delete [] ptr->s;
@@ -793,7 +791,7 @@ namespace giac {
     }
     ref_count_ptr=s.ref_count_ptr;
     if (ref_count_ptr)
-      ++(*ref_count_ptr);
+      ref_count_incr(ref_count_ptr);
     value=s.value;
     quoted=s.quoted;
     localvalue=s.localvalue;
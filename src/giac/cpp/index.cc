@@ -21,6 +21,7 @@ using namespace std;
 #include "index.h"
 #include <cmath>
 #include <stdio.h>
+#include <string.h>
 #include <stdexcept>
 #ifdef DEBUG_SUPPORT
 #include "giacintl.h"
@@ -483,6 +484,52 @@ namespace giac {
   }
 
 #else
+#if defined x86_64 && defined __GNUC__ && defined __BYTE_ORDER__ && __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__ && (HAS_POLY_VARS_OTHER==1)
+  // an inline index_m is 2 words of 4 deg_t: taille and 3 exponents, then
+  // 4 exponents, monomial operations below work on the words directly
+#define INDEX_M_PACKED
+  typedef ulonglong index_word_t;
+  static const index_word_t index_word_high=0x8000800080008000ULL;
+
+  // mask of the first n deg_t of a word
+  static inline index_word_t index_lanes(int n){
+    return n<=0?0:(n>=4?~index_word_t(0):(index_word_t(1)<<(16*n))-1);
+  }
+
+  // memcpy keeps the word access of the deg_t fields alias safe
+  static inline void index_words(const index_m & i,index_word_t * w){
+    memcpy(w,&i.taille,2*sizeof(index_word_t));
+  }
+
+  // deg_t by deg_t addition/subtraction modulo 2^16 without carry
+  static inline index_word_t index_word_add(index_word_t a,index_word_t b){
+    return ((a&~index_word_high)+(b&~index_word_high)) ^ ((a^b)&index_word_high);
+  }
+
+  static inline index_word_t index_word_sub(index_word_t a,index_word_t b){
+    return ((a|index_word_high)-(b&~index_word_high)) ^ ((a^~b)&index_word_high);
+  }
+
+  // compare inline indices of the same size in lexicographic order,
+  // returns the sign of the first non-zero difference
+  static inline int index_packed_lex_compare(const index_m & v1,const index_m & v2){
+    index_word_t w1[2],w2[2];
+    index_words(v1,w1); index_words(v2,w2);
+    int n=v1.taille/2;
+    index_word_t d=(w1[0]^w2[0]) & index_lanes(n+1) & ~index_word_t(0xffff);
+    if (d){
+      int pos=__builtin_ctzll(d)/16-1;
+      return v1.direct[pos]>v2.direct[pos]?1:-1;
+    }
+    d=(w1[1]^w2[1]) & index_lanes(n-3);
+    if (d){
+      int pos=__builtin_ctzll(d)/16;
+      return v1.other[pos]>v2.other[pos]?1:-1;
+    }
+    return 0;
+  }
+#endif
+
   index_t index_m::iref() const { 
     if ( (taille % 2)==0)
       return riptr->i;
@@ -589,6 +636,12 @@ namespace giac {
     }
     if (i1.taille!=i2.taille)
       return false;
+#ifdef INDEX_M_PACKED
+    index_word_t w1[2],w2[2];
+    index_words(i1,w1); index_words(i2,w2);
+    int n=i1.taille/2;
+    return !((w1[0]^w2[0]) & index_lanes(n+1)) && !((w1[1]^w2[1]) & index_lanes(n-3));
+#endif
     const deg_t * i1ptr=i1.direct, *i1end=i1ptr+i1.taille/2,* i2ptr=i2.direct;
     for (;i1ptr!=i1end;++i2ptr,++i1ptr){
       if (*i1ptr!=*i2ptr)
@@ -635,6 +688,17 @@ namespace giac {
 
   
   index_m operator + (const index_m & a, const index_m & b){
+#ifdef INDEX_M_PACKED
+    if (a.taille % 2 && b.taille % 2){
+      index_m res;
+      index_word_t wa[2],wb[2],w[2];
+      index_words(a,wa); index_words(b,wb);
+      w[0]=(index_word_add(wa[0],wb[0]) & ~index_word_t(0xffff)) | (wa[0] & 0xffff);
+      w[1]=index_word_add(wa[1],wb[1]);
+      memcpy(&res.taille,w,sizeof(w));
+      return res;
+    }
+#endif
     const deg_t * ita=&*a.begin(), * itb=&*b.begin();
     int s=int(a.size());
     const deg_t * itaend=ita+s;
@@ -661,6 +725,17 @@ namespace giac {
   }
 
   index_m operator - (const index_m & a, const index_m & b){
+#ifdef INDEX_M_PACKED
+    if (a.taille % 2 && b.taille % 2){
+      index_m res;
+      index_word_t wa[2],wb[2],w[2];
+      index_words(a,wa); index_words(b,wb);
+      w[0]=(index_word_sub(wa[0],wb[0]) & ~index_word_t(0xffff)) | (wa[0] & 0xffff);
+      w[1]=index_word_sub(wa[1],wb[1]);
+      memcpy(&res.taille,w,sizeof(w));
+      return res;
+    }
+#endif
     index_t::const_iterator ita=a.begin();
     index_t::const_iterator itaend=a.end();
     index_t::const_iterator itb=b.begin();
@@ -747,6 +822,12 @@ namespace giac {
   }
 
   bool i_lex_is_greater(const index_m & v1, const index_m & v2){
+#ifdef INDEX_M_PACKED
+    if (v1.taille % 2 && v2.taille % 2){
+      int c=index_packed_lex_compare(v1,v2);
+      return c?c>0:true;
+    }
+#endif
     index_t::const_iterator it1=v1.begin();
     index_t::const_iterator it2=v2.begin();
     index_t::const_iterator it1end=v1.end();
@@ -782,6 +863,12 @@ namespace giac {
   }
 
   bool i_lex_is_strictly_greater(const index_m & v1, const index_m & v2){
+#ifdef INDEX_M_PACKED
+    if (v1.taille % 2 && v2.taille % 2){
+      int c=index_packed_lex_compare(v1,v2);
+      return c?c>0:false;
+    }
+#endif
     index_t::const_iterator it1=v1.begin();
     index_t::const_iterator it2=v2.begin();
     index_t::const_iterator it1end=v1.end();
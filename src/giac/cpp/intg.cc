@@ -5912,6 +5912,9 @@ namespace giac {
     gen debut=v[2],fin=v[3];
     if (is_greater(abs(fin-debut),type?max_sum_add(contextptr):LIST_SIZE_LIMIT,contextptr))
       return gendimerr(contextptr);
+    // the list of seq is built in one vecteur
+    if (type==0 && debut.type==_INT_ && fin.type==_INT_ && step.type==_INT_ && !memory_check((std::abs(double(fin.val)-debut.val)/std::abs(double(step.val))+1)*sizeof(gen)))
+      return gensizeerr(gettext("Memory limit exceeded"));
     vecteur res;
     if (is_strictly_greater(debut,fin,contextptr)){
       if (is_positive(step,contextptr))
@@ -149,7 +149,7 @@ const int xwaspy_shift=33; // must be between 32 and 63, reflect in xcas.js and
 
 #if defined NUMWORKS && defined DEVICE
   void py_ck_ctrl_c(){
-    if (giac::ctrl_c || giac::interrupted)
+    if (ctrl_c || interrupted)
       raisememerr();
   }
 #else
@@ -210,7 +210,7 @@ int python_init(int stack_size,int heap_size){
 }
 
 int micropy_ck_eval(const char *line){
-  giac::ctrl_c=giac::interrupted=false;
+  ctrl_c=interrupted=false;
   giac::freeze=false;
   if (python_heap && line[0]==0)
     return 1;
@@ -5267,7 +5267,7 @@ string longhelp(const char * s){
 #ifndef BW
   gen select_var(GIAC_CONTEXT){
     giac::history_plot(contextptr).clear();
-    kbd_interrupted=giac::ctrl_c=giac::interrupted=false;
+    kbd_interrupted=ctrl_c=interrupted=false;
 #ifdef QUICKJS
     if (xcas_python_eval<0){
       update_js_vars();
@@ -12615,8 +12615,8 @@ namespace xcas {
       set_abort();
       g=protecteval(g,level,contextptr);
       clear_abort();
-      giac::ctrl_c=false;
-      kbd_interrupted=giac::interrupted=false;
+      ctrl_c=false;
+      kbd_interrupted=interrupted=false;
       if (i<plot_instructions.size())
 	plot_instructions[i]=g;
       else
@@ -15860,15 +15860,15 @@ namespace xcas {
 		tmp=(*op._FUNCptr)(args,contextptr);
 		clear_abort();
 		esc_flag=0;
-		giac::ctrl_c=false;
-		kbd_interrupted=giac::interrupted=false;
+		ctrl_c=false;
+		kbd_interrupted=interrupted=false;
 	      }
 	      else
 		tmp=symbolic(*op._FUNCptr,args);
 	      //cout << "sel " << value._EQWptr->g << " " << tmp << " " << goto_sel << "\n";
 	      esc_flag=0;
-	      giac::ctrl_c=false;
-	      kbd_interrupted=giac::interrupted=false;
+	      ctrl_c=false;
+	      kbd_interrupted=interrupted=false;
 	      if (!is_undef(tmp)){
 		xcas::replace_selection(eq,tmp,gsel,&goto_sel,contextptr);
 		if (addarg){
@@ -15998,8 +15998,8 @@ namespace xcas {
     }
     //Console_Output("Done"); return ;
     esc_flag=0;
-    giac::ctrl_c=false;
-    giac::kbd_interrupted=giac::interrupted=false;
+    ctrl_c=false;
+    giac::kbd_interrupted=interrupted=false;
   }
 
 #if defined NSPIRE_NEWLIB && !defined BW
@@ -16670,8 +16670,8 @@ namespace xcas {
       gen gs=g;
       g=protecteval(g,1,contextptr);
       clear_abort();
-      giac::ctrl_c=false;
-      kbd_interrupted=giac::interrupted=false;
+      ctrl_c=false;
+      kbd_interrupted=interrupted=false;
       // define the function
       if (check_do_graph(g,gs,7,contextptr)==KEY_SHUTDOWN)
 	return KEY_SHUTDOWN;
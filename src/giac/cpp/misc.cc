@@ -6777,10 +6777,16 @@ static define_unary_function_eval (__os_version,&_os_version,_os_version_s);
       }
       return g;
     }
-    if (*args._STRNGptr=="init geogebra")
+    // geogebra mode of the calling session only: caseval(const char *) would
+    // also switch its own static context, shared by all threads
+    if (*args._STRNGptr=="init geogebra"){
       init_geogebra(1,contextptr);
-    if (*args._STRNGptr=="close geogebra")
+      return string2gen("geogebra mode on",false);
+    }
+    if (*args._STRNGptr=="close geogebra"){
       init_geogebra(0,contextptr);
+      return string2gen("geogebra mode off",false);
+    }
 #ifdef TIMEOUT
     if (args._STRNGptr->size()>8 && args._STRNGptr->substr(0,8)=="timeout "){
       string t=args._STRNGptr->substr(8,args._STRNGptr->size()-8);
@@ -6789,6 +6795,7 @@ static define_unary_function_eval (__os_version,&_os_version,_os_version_s);
 	caseval_maxtime=f;
 	caseval_n=0;
 	caseval_mod=10;
+	store_tunables(_TUNE_CASEVAL_MAXTIME | _TUNE_CASEVAL_MOD,contextptr);
 	return string2gen("Max eval time set to "+gen(f).print(),false);
       }
     }
@@ -6797,6 +6804,7 @@ static define_unary_function_eval (__os_version,&_os_version,_os_version_s);
       int f=atoi(t.c_str());
       if (f>0 && f<1e6){
 	caseval_mod=f;
+	store_tunables(_TUNE_CASEVAL_MOD,contextptr);
 	return string2gen("Check every "+gen(f).print(),false);
       }
     }
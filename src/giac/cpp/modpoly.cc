@@ -1363,6 +1363,9 @@ namespace giac {
       return;
     }
     int product_deg=as+bs;
+    perf_timer timer(PERF_TIME_MULT);
+    if (timer.outer())
+      perf_mult(double(as+1)*(bs+1));
     if (&a==&new_coord){
       vecteur tmp;
       mulmodpoly(a,b,env,tmp,maxdeg);
@@ -1752,6 +1755,9 @@ namespace giac {
       mulmodpoly(a,b.front(),env,new_coord);
       return;
     }
+    perf_timer timer(PERF_TIME_MULT);
+    if (timer.outer())
+      perf_mult(double(a.size())*b.size());
     if (env && env->moduloon && is_zero(env->coeff)){
       mulmodpoly(a,b,env,new_coord,maxdeg);
       return ;
@@ -4434,6 +4440,9 @@ namespace giac {
     bool large=test/(1ULL<<63) > (1ULL<<63)/modulo;
     new_coord.clear();
     if (a.empty() || b.empty()) return;
+    perf_timer timer(PERF_TIME_MULT);
+    if (timer.outer())
+      perf_mult(double(a.size())*b.size());
     vector<longlong>::const_iterator ita_begin=a.begin(),ita=a.begin(),ita_end=a.end(),itb=b.begin(),itb_end=b.end();
     for ( ; ita!=ita_end; ++ita ){
       vector<longlong>::const_iterator ita_cur=ita,itb_cur=itb;
@@ -7373,6 +7382,7 @@ namespace giac {
   }
 
   bool gcd_modular(const polynome &p_orig, const polynome & q_orig, polynome & pgcd,polynome & pcofactor,polynome & qcofactor,bool compute_cofactors){
+    perf_add(PERF_GCD_MODULAR);
     if (debug_infolevel>1)
       CERR << "gcd modular algo begin " << CLOCK() << '\n';
     int dim=p_orig.dim;
@@ -7428,6 +7438,8 @@ namespace giac {
   }
 
   bool mod_gcd(const polynome &p_orig, const polynome & q_orig, const gen & modulo, polynome & pgcd,polynome & pcofactor,polynome & qcofactor,bool compute_cofactors){
+    trace_scope scope("mod_gcd",modulo.type==_INT_?modulo.val:-1);
+    perf_add(PERF_PRIMES);
     if (debug_infolevel)
       CERR << "modgcd begin " << CLOCK()*1e-6 << '\n';
     int dim=p_orig.dim;
@@ -14376,6 +14388,7 @@ namespace giac {
 
 
   void * do_thread_fftmult(void * ptr_){
+    trace_scope scope("thread_fftmult");
     thread_fftmult_t * ptr=(thread_fftmult_t *) ptr_;
     modpoly curres;
     if (fftmultp1234(*ptr->p,*ptr->q,ptr->P,ptr->Q,curres,ptr->prime,*ptr->a,*ptr->b,*ptr->resp1,*ptr->resp2,*ptr->resp3,*ptr->Wp1,*ptr->Wp2,*ptr->Wp3,*ptr->Wp4,*ptr->tmp_p,*ptr->tmp_q,false))
@@ -15405,7 +15418,7 @@ namespace giac {
 	int ps=int(primes.size());
 #ifdef HAVE_LIBPTHREAD
 	if (nthreads>1){
-	  vector<pthread_t> tab(nthreads);
+	  vector<thread_task> tab(nthreads);
 	  vector<thread_fftmult_t> multparam(nthreads);
 	  vector<bool> busy(nthreads,false);
 	  vector< vector<int> > av(nthreads,vector<int>(n)),bv(nthreads,vector<int>(n)),resp1v(nthreads,vector<int>(n)),resp2v(nthreads,vector<int>(n)),resp3v(nthreads,vector<int>(n)),Wp1v(nthreads,vector<int>(n)),Wp2v(nthreads,vector<int>(n)),Wp3v(nthreads,vector<int>(n)),Wp4v(nthreads,vector<int>(n)),tmp_pv(nthreads,vector<int>(n)),tmp_qv(nthreads,vector<int>(n));
@@ -15426,7 +15439,7 @@ namespace giac {
 	      multparam[j].prime=primes[i];
 	      bool res=true;
 	      busy[j]=true;
-	      if (j<nthreads-1) res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_fftmult,(void *) &multparam[j]);
+	      if (j<nthreads-1) res=thread_task_create(&tab[j],do_thread_fftmult,(void *) &multparam[j]);
 	      if (res){
 		do_thread_fftmult((void *)&multparam[j]);
 		busy[j]=false;
@@ -15435,7 +15448,7 @@ namespace giac {
 	    for (int j=0;j<nthreads;++j){
 	      void * ptr=(void *)&nthreads; // non-zero initialisation
 	      if (j<nthreads-1 && busy[j])
-		pthread_join(tab[j],&ptr);
+		thread_task_join(tab[j],&ptr);
 	    }
 	    for (int j=0;j<nthreads;++j){
 	      prime=multparam[j].prime;
@@ -11947,9 +11947,9 @@ static vecteur densityscale(double xmin,double xmax,double ymin,double ymax,doub
 	if (debug_infolevel>20)
 	  *logptr(contextptr) << s << '\n';
 	// read function from lexer_functions
-	std::pair<charptr_gen *,charptr_gen *> p= equal_range(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),std::pair<const char *,gen>(s.c_str(),0),tri);
-	if (p.first!=p.second && p.first!=builtin_lexer_functions_end())
-	  return p.first->second;
+	charptr_gen * f=builtin_lexer_functions_find(s.c_str());
+	if (f!=builtin_lexer_functions_end())
+	  return f->second;
 	map_charptr_gen::const_iterator i = lexer_functions().find(s.c_str());
 	if (i==lexer_functions().end()) // should be error
 	  return undef;
@@ -12451,6 +12451,12 @@ static vecteur densityscale(double xmin,double xmax,double ymin,double ymax,doub
     gen b=(*args._VECTptr)[1];
     if (a.type!=_STRNG)
       return gensizeerr(contextptr);
+    if (s==3 && (*args._VECTptr)[2]==string2gen("portable",false)){
+      // portable binary archive (binary_archive_save), read by unarchive
+      if (!binary_archive_write_file(a._STRNGptr->c_str(),b,contextptr))
+	return gensizeerr(gettext("Unable to write a portable archive in file ")+a.print(contextptr));
+      return b;
+    }
     if (s==3){ // new binary archive format
       ::FILE * f=fopen(a._STRNGptr->c_str(),"w");
       if (!f)
@@ -12481,7 +12487,13 @@ static vecteur densityscale(double xmin,double xmax,double ymin,double ymax,doub
     if (!f)
       return gensizeerr(gettext("Unable to read file"));
     char * buf = new char[101];
-    fread(buf,sizeof(char),4,f);
+    size_t n=fread(buf,sizeof(char),4,f);
+    if (n==4 && !memcmp(buf,"GIAC",4)){
+      delete [] buf;
+      fclose(f);
+      // undef if the archive is invalid
+      return binary_archive_read_file(args._STRNGptr->c_str(),contextptr);
+    }
     if (buf[0]=='-' && buf[1]=='1' && buf[2]==' '){
       delete [] buf;
       gen res=archive_restore(f,contextptr);
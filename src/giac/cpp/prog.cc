@@ -1224,6 +1224,7 @@ namespace giac {
 	sym_string_tab::const_iterator i = syms().find(s);
 	if (i == syms().end()) {
 	  *it = *(new identificateur(s));
+	  publish_gen(*it);
 	  syms()[s] = *it;
 	} else {
 	  // std::cerr << "lexer" << s << '\n';
@@ -7094,9 +7095,9 @@ namespace giac {
     if (j==l-1)
     */      
     cs=a.print(contextptr)+"::"+cs;
-    std::pair<charptr_gen *,charptr_gen *> p= equal_range(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),std::pair<const char *,gen>(cs.c_str(),0),tri);
-    if (p.first!=p.second && p.first!=builtin_lexer_functions_end()){
-      c=p.first->second;
+    charptr_gen * f=builtin_lexer_functions_find(cs.c_str());
+    if (f!=builtin_lexer_functions_end()){
+      c=f->second;
       if (b.is_symb_of_sommet(at_of))
 	return c(b._SYMBptr->feuille[1],contextptr);
       else
@@ -7930,6 +7931,7 @@ namespace giac {
     if (args.type!=_INT_)
       return threads;
     threads=giacmax(absint(args.val),1);
+    store_tunables(_TUNE_THREADS,contextptr);
     parent_cas_setup(contextptr);
     return args;
   }
@@ -8051,6 +8053,7 @@ namespace giac {
 	vecteur & vv =*v[7]._VECTptr;
 	if (vv.size()>=4){
 	  threads=std::max(1,int(evalf_double(vv[0],1,contextptr)._DOUBLE_val));
+	  store_tunables(_TUNE_THREADS,contextptr);
 	  MAX_RECURSION_LEVEL=std::max(int(evalf_double(vv[1],1,contextptr)._DOUBLE_val),1);
 	  debug_infolevel=std::max(0,int(evalf_double(vv[2],1,contextptr)._DOUBLE_val));
 	  DEFAULT_EVAL_LEVEL=std::max(1,int(evalf_double(vv[3],1,contextptr)._DOUBLE_val));
@@ -10241,11 +10244,16 @@ namespace giac {
   define_unary_function_ptr5( at_tableseq ,alias_at_tableseq,&__tableseq,_QUOTE_ARGUMENTS,true);
 
   gen protectevalorevalf(const gen & g,int level,bool approx,GIAC_CONTEXT){
+    perf_timer timer(PERF_TIME_EVAL);
+    trace_scope scope("eval");
     gen res;
 #ifdef HAVE_LIBGSL //
     gsl_set_error_handler_off();
 #endif //
-    ctrl_c = false; interrupted=false;
+    if (!eval_cancelled()){
+      ctrl_c = false; interrupted=false;
+    }
+    install_tunables(contextptr);
     // save cas_setup in case of an exception
     vecteur cas_setup_save = cas_setup(contextptr);
     if (cas_setup_save.size()>5 && cas_setup_save[5].type==_VECT && cas_setup_save[5]._VECTptr->size()==2){
@@ -10273,11 +10281,20 @@ namespace giac {
       *debug_ptr(contextptr)=dbg;
       res=string2gen(e.what(),false);
       res.subtype=-1;
+      bool c=ctrl_c,i=interrupted;
       ctrl_c=false; interrupted=false;
-      // something went wrong, so restore the old cas_setup
+      // something went wrong, so restore the old cas_setup (it evaluates,
+      // the flags of a cancelled evaluation are raised again after)
       cas_setup(cas_setup_save, contextptr);
+      if (eval_cancelled()){
+	ctrl_c=c; interrupted=i;
+      }
     }
 #endif
+    if (memory_exceeded()){
+      res=string2gen(gettext("Memory limit exceeded"),false);
+      res.subtype=-1;
+    }
     return res;
   }
 
@@ -13181,10 +13198,10 @@ namespace giac {
       res=syms()[s];
     else {
       unit_conversion_map()[s+1]=equiv;
-      if (is_unit_rom(s,res))
-	syms()[s]=res;
-      else
-	res = (syms()[s] = new ref_identificateur(s));
+      if (!is_unit_rom(s,res))
+	res = new ref_identificateur(s);
+      publish_gen(res);
+      syms()[s]=res;
     }
     unlock_syms_mutex();  
     return res;
@@ -882,6 +882,7 @@ namespace giac {
     }
     if (args.type!=_IDNT)
       return gensizeerr("Invalid purgenoassume "+args.print(contextptr));
+    caseval_cache_invalidate(args._IDNTptr->id_name);
     if (!contextptr)
       return _purge(args,0);
     const char * ch=args._IDNTptr->id_name;
@@ -933,6 +934,8 @@ namespace giac {
     if (args.is_symb_of_sommet(at_at)){
       gen & f = args._SYMBptr->feuille;
       if (f.type==_VECT && f._VECTptr->size()==2){
+	if (f._VECTptr->front().type==_IDNT)
+	  caseval_cache_invalidate(f._VECTptr->front()._IDNTptr->id_name);
 	gen m = eval(f._VECTptr->front(),eval_level(contextptr),contextptr);
 	gen indice=eval(f._VECTptr->back(),eval_level(contextptr),contextptr);
 	if (m.type==_MAP){
@@ -976,6 +979,7 @@ namespace giac {
     }
     if (args.type!=_IDNT)
       return symbolic(at_purge,args);
+    caseval_cache_invalidate(args._IDNTptr->id_name);
     // REMOVED! args.eval(eval_level(contextptr),contextptr); 
     if (contextptr){
       if (contextptr->globalcontextptr!=contextptr){ 
@@ -455,7 +455,26 @@ namespace giac {
     // return e;
   }
 
+  static bool has_subst_(const gen & e,const gen & i,const gen & newi,gen & newe,bool quotesubst,GIAC_CONTEXT);
+
+  // current subst memo, see dag_memo
+  static GIAC_THREAD_LOCAL dag_memo * subst_memo=0;
+
   static bool has_subst(const gen & e,const gen & i,const gen & newi,gen & newe,bool quotesubst,GIAC_CONTEXT){
+    if (!subst_memo || !dag_memo::shared(e))
+      return has_subst_(e,i,newi,newe,quotesubst,contextptr);
+    if (const gen * ptr=subst_memo->find(e)){
+      if (ptr->_SYMBptr==e._SYMBptr)
+	return false;
+      newe=*ptr;
+      return true;
+    }
+    bool b=has_subst_(e,i,newi,newe,quotesubst,contextptr);
+    subst_memo->insert(e,b?newe:e);
+    return b;
+  }
+
+  static bool has_subst_(const gen & e,const gen & i,const gen & newi,gen & newe,bool quotesubst,GIAC_CONTEXT){
     switch (e.type){
     case _INT_: case _ZINT: case _DOUBLE_: case _REAL: case _STRNG: case _MOD: case _SPOL1: case _USER: case _EXT:
       return false;
@@ -571,6 +590,7 @@ namespace giac {
     if (i.type!=_IDNT && i.type!=_SYMB && i.type!=_FUNC && i!=cst_i)
       *logptr(contextptr) << gettext("Warning, replacing ") << i << gettext(" by ") << newi << gettext(", a substitution variable should perhaps be purged.") << '\n';
     gen res;
+    dag_memo memo(subst_memo,0,0);
     if (has_subst(e,i,newi,res,quotesubst,contextptr))
       return res;
     else
@@ -2387,6 +2407,7 @@ namespace giac {
     return res;
   }
 
+  bool is_constant_idnt(const gen & g); // FIXME -> prog.h
   gen simplify(const gen & e_orig,GIAC_CONTEXT){
     if (e_orig.type<=_POLY || is_inf(e_orig) || has_num_coeff(e_orig))
       return e_orig;
@@ -2409,7 +2430,8 @@ namespace giac {
 	if (!vbasevar.empty() && vexp.type==_FRAC && vexp._FRACptr->num==1 && vexp._FRACptr->den.type==_INT_){
 	  for (int j=0;j<vbasevar.size();++j){
 	    gen var=vbasevar[j],a,b;
-	    if (var.type==_IDNT && is_linear_wrt(vbase,var,a,b,contextptr) && !is_zero(a=ratnormal(a,contextptr))){
+	    // not pi: assuming on it would purge its global value
+	    if (var.type==_IDNT && !is_constant_idnt(var) && is_linear_wrt(vbase,var,a,b,contextptr) && !is_zero(a=ratnormal(a,contextptr))){
 	      // vbase=(a*var+b)^1/vexp.den
 	      // replace a*var+b by t^vexp.den, hence var=(t^vexp.den-b)/a
 	      gen e2;
@@ -1460,6 +1460,7 @@ namespace giac {
   // value is 0 if i=sqrt(-1) is not in the algebraic number field from lvnum
   // otherwise it is an extension or fraction extension/integer.
   bool sym2r (const gen &e,const gen & iext,const vecteur &l, const vecteur & lv, const vecteur & lvnum,const vecteur & lvden, int l_size,gen & num,gen & den,GIAC_CONTEXT){
+    trace_scope scope("sym2r");
     int n=0;
     switch (e.type ) {
     case _INT_: case _DOUBLE_: case _ZINT: case _REAL: case _FLOAT_:
@@ -2150,6 +2151,7 @@ namespace giac {
   }
 
   gen r2sym(const polynome & p, const vecteur & l,GIAC_CONTEXT){
+    trace_scope scope("r2sym");
     if (p.coord.empty())
       return 0;
     if (p.dim==0){
@@ -2161,6 +2163,7 @@ namespace giac {
   }
 
   gen r2sym(const fraction & f, const vecteur & l,GIAC_CONTEXT){
+    trace_scope scope("r2sym");
     if (f.den.type==_POLY && is_positive(-f.den._POLYptr->coord.front())){
       return rdiv(r2sym(-f.num,l,contextptr),r2sym(-f.den,l,contextptr),contextptr);
     }
@@ -2605,6 +2608,7 @@ namespace giac {
   }
 
   gen r2sym(const gen & p, const vecteur & l,GIAC_CONTEXT){
+    trace_scope scope("r2sym");
     if (p.type==_VECT){
       gen res=r2sym(*p._VECTptr,l,contextptr);
       if (res.type==_VECT)
@@ -32,6 +32,12 @@ extern "C" {
 #include <system.h>
 }
 #endif
+#if defined HAVE_PTHREAD_H || defined HAVE_LIBPTHREAD
+#include <pthread.h>
+#include <deque>
+#endif
+#include <list>
+#include <map>
 
 #ifndef NO_NAMESPACE_GIAC
 namespace giac {
@@ -53,13 +59,226 @@ mpz_class smod(const mpz_class & a,int reduce){
 }
 #endif
 
-  double heap_mult=20000;
+#if defined HAVE_PTHREAD_H || defined HAVE_LIBPTHREAD
+  // Thread pool: one deque per worker and one for tasks submitted from
+  // outside the pool, all protected by pool_mutex (tasks are coarse).
+  // A worker runs the most recent task of its own deque first (nested
+  // tasks, data still in cache), then the oldest queued task of the
+  // outside deque or of another worker (stealing).
+  struct thread_budget {
+    int nthreads; // threads of the evaluation thread that owns the budget
+    int running; // tasks queued or running on the pool
+    // evaluation state of the owner, read and written with pool_mutex
+    eval_token * token;
+    interrupt_flags * flags;
+    eval_tunables tunables;
+  };
+  static pthread_mutex_t pool_mutex=PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t pool_work=PTHREAD_COND_INITIALIZER; // task queued
+  static pthread_cond_t pool_done=PTHREAD_COND_INITIALIZER; // task finished
+  static vector< deque<thread_task *> > * pool_queues=0; // 0: outside, i: worker i
+  static int pool_workers=0,pool_idle=0,pool_queued=0,pool_maxworkers=0;
+  const int POOL_MAXWORKERS=64;
+  static GIAC_THREAD_LOCAL int pool_self=0; // worker number, 0 outside the pool
+  static GIAC_THREAD_LOCAL thread_budget * pool_budget=0; // budget of the running task
+  static GIAC_THREAD_LOCAL thread_budget * root_budget=0;
+  static GIAC_THREAD_LOCAL int pool_pending=0; // see thread_task::pending
+
+  int thread_pool_size(){
+    return pool_workers;
+  }
+
+  // called with pool_mutex locked
+  static thread_task * pool_pop(int w){
+    vector< deque<thread_task *> > & Q=*pool_queues;
+    int n=int(Q.size());
+    if (w && !Q[w].empty()){
+      thread_task * t=Q[w].back();
+      Q[w].pop_back();
+      return t;
+    }
+    for (int i=0;i<n;++i){
+      if (i!=w && !Q[i].empty()){
+	thread_task * t=Q[i].front();
+	Q[i].pop_front();
+	return t;
+      }
+    }
+    return 0;
+  }
+
+  // call the function of t, an exception is kept for thread_task_join
+  static void * pool_call(thread_task * t){
+    try {
+      return t->f(t->arg);
+    }
+    catch (std::exception & e){
+      t->error=new std::runtime_error(e.what());
+    }
+    catch (...){
+      t->error=new std::runtime_error("Unknown exception in thread task");
+    }
+    return 0;
+  }
+
+  // run t in the current thread with the budget and evaluation state of its
+  // owner, pool_mutex is locked on entry and exit, t has been removed from
+  // its deque
+  static void pool_run(thread_task * t){
+    --pool_queued;
+    t->state=1;
+    thread_budget * tb=t->budget;
+    eval_token * token=tb->token;
+    interrupt_flags * flags=tb->flags;
+    eval_tunables tunables(tb->tunables);
+    pthread_mutex_unlock(&pool_mutex);
+    thread_budget * b=pool_budget;
+    eval_token * token0=current_eval_token;
+    interrupt_flags * flags0=current_interrupt_flags;
+    eval_tunables tunables0;
+    save_tunables(tunables0);
+    pool_budget=tb;
+    current_eval_token=token;
+    current_interrupt_flags=flags;
+    restore_tunables(tunables);
+    void * res=pool_call(t);
+    pool_budget=b;
+    current_eval_token=token0;
+    current_interrupt_flags=flags0;
+    restore_tunables(tunables0);
+    pthread_mutex_lock(&pool_mutex);
+    t->res=res;
+    --tb->running;
+    --*t->pending;
+    t->state=2;
+    pthread_cond_broadcast(&pool_done);
+  }
+
+  static void * pool_worker(void * ptr){
+    pool_self=int((size_t) ptr);
+    pthread_mutex_lock(&pool_mutex);
+    for (;;){
+      thread_task * t=pool_pop(pool_self);
+      if (t){
+	--pool_idle;
+	pool_run(t);
+	++pool_idle;
+	continue;
+      }
+      pthread_cond_wait(&pool_work,&pool_mutex);
+    }
+    return 0;
+  }
+
+  // start one more worker if there are less than n, pool_mutex locked
+  static void pool_grow(int n){
+    if (pool_workers>=n)
+      return;
+    pool_queues->push_back(deque<thread_task *>());
+    pthread_t th;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+    int res=pthread_create(&th,&attr,pool_worker,(void *)(size_t) (pool_workers+1));
+    pthread_attr_destroy(&attr);
+    if (res)
+      pool_queues->pop_back();
+    else {
+      ++pool_workers;
+      ++pool_idle;
+    }
+  }
+
+  int thread_task_create(thread_task * t,void * (* f)(void *),void * arg){
+    t->f=f;
+    t->arg=arg;
+    t->res=0;
+    t->state=0;
+    t->pending=&pool_pending;
+    t->error=0;
+    thread_budget * b=pool_budget;
+    if (!b){
+      // outside the pool: the calling evaluation thread owns the budget
+      if (!root_budget){
+	root_budget=new thread_budget;
+	root_budget->running=0;
+      }
+      b=root_budget;
+    }
+    t->budget=b;
+    pthread_mutex_lock(&pool_mutex);
+    if (b==root_budget){
+      b->nthreads=threads;
+      b->token=current_eval_token;
+      b->flags=current_interrupt_flags;
+      save_tunables(b->tunables);
+    }
+    if (threads_allowed && b->running<b->nthreads-1){
+      if (!pool_queues){
+	pool_queues=new vector< deque<thread_task *> >(1);
+	pool_maxworkers=int(sysconf(_SC_NPROCESSORS_ONLN))-1; // more if threads is larger
+      }
+      if (pool_idle<=pool_queued)
+	pool_grow(std::min(std::max(pool_maxworkers,b->nthreads-1),POOL_MAXWORKERS));
+      if (pool_idle>pool_queued){
+	++b->running;
+	++pool_queued;
+	++pool_pending;
+	t->queue=pool_self;
+	(*pool_queues)[t->queue].push_back(t);
+	pthread_cond_signal(&pool_work);
+	pthread_mutex_unlock(&pool_mutex);
+	return 0;
+      }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    // no worker available: run in the caller
+    t->res=pool_call(t);
+    t->state=2;
+    return 0;
+  }
+
+  int thread_task_join(thread_task & t,void ** res){
+    if (t.state!=2){
+      pthread_mutex_lock(&pool_mutex);
+      if (t.state==0){
+	// not started yet, run it here
+	deque<thread_task *> & q=(*pool_queues)[t.queue];
+	q.erase(find(q.begin(),q.end(),&t));
+	pool_run(&t);
+      }
+      while (t.state!=2)
+	pthread_cond_wait(&pool_done,&pool_mutex);
+      pthread_mutex_unlock(&pool_mutex);
+    }
+    if (res)
+      *res=t.res;
+    if (t.error){
+      std::runtime_error e(*t.error);
+      delete t.error;
+      t.error=0;
+      // the other tasks of this thread may use the frames the exception
+      // unwinds, wait until they are finished
+      pthread_mutex_lock(&pool_mutex);
+      while (pool_pending)
+	pthread_cond_wait(&pool_done,&pool_mutex);
+      pthread_mutex_unlock(&pool_mutex);
+      throw e;
+    }
+    return 0;
+  }
+
+#endif
+
+  GIAC_THREAD_LOCAL double heap_mult=20000;
   gen _heap_mult(const gen & g0,GIAC_CONTEXT){
     if ( g0.type==_STRNG && g0.subtype==-1) return  g0;
     gen g=evalf_double(g0,1,contextptr);
     if (g.type!=_DOUBLE_)
       return heap_mult;
-    return heap_mult=g._DOUBLE_val;
+    heap_mult=g._DOUBLE_val;
+    store_tunables(_TUNE_HEAP_MULT,contextptr);
+    return heap_mult;
   }
   static const char _heap_mult_s []="heap_mult";
   static define_unary_function_eval (__heap_mult,&_heap_mult,_heap_mult_s);
@@ -133,13 +352,15 @@ mpz_class smod(const mpz_class & a,int reduce){
   static define_unary_function_eval (__modresultant,&_modresultant,_modresultant_s);
   define_unary_function_ptr5( at_modresultant ,alias_at_modresultant,&__modresultant,0,true);
 
-  double modgcd_cachesize=6291456;
+  GIAC_THREAD_LOCAL double modgcd_cachesize=6291456;
   gen _modgcd_cachesize(const gen & g0,GIAC_CONTEXT){
     if ( g0.type==_STRNG && g0.subtype==-1) return  g0;
     gen g=evalf_double(g0,1,contextptr);
     if (g.type!=_DOUBLE_)
       return modgcd_cachesize;
-    return modgcd_cachesize=g._DOUBLE_val;
+    modgcd_cachesize=g._DOUBLE_val;
+    store_tunables(_TUNE_MODGCD_CACHESIZE,contextptr);
+    return modgcd_cachesize;
   }
   static const char _modgcd_cachesize_s []="modgcd_cachesize";
   static define_unary_function_eval (__modgcd_cachesize,&_modgcd_cachesize,_modgcd_cachesize_s);
@@ -1811,6 +2032,9 @@ mpz_class smod(const mpz_class & a,int reduce){
     bool large=test/RAND_MAX>RAND_MAX/modulo;
     new_coord.clear();
     if (ita0==ita_end || itb0==itb_end) return;
+    perf_timer timer(PERF_TIME_MULT);
+    if (timer.outer())
+      perf_mult(double(ita_end-ita0)*(itb_end-itb0));
     vector<int>::const_iterator ita_begin=ita0,ita=ita0,itb=itb0;
     for ( ; ita!=ita_end; ++ita ){
       vector<int>::const_iterator ita_cur=ita,itb_cur=itb;
@@ -2325,6 +2549,7 @@ mpz_class smod(const mpz_class & a,int reduce){
 
 #ifndef NO_TEMPLATE_MULTGCD
   static void * do_recursive_gcd_call(void * ptr_){
+    trace_scope scope("thread_gcd");
 #ifdef TIMEOUT
     control_c();
 #endif
@@ -2461,6 +2686,7 @@ mpz_class smod(const mpz_class & a,int reduce){
 
   // Modular gcd in "internal form"
   static bool mod_gcd(const vector< T_unsigned<int,hashgcd_U> > & p_orig,const vector< T_unsigned<int,hashgcd_U> > & q_orig,int modulo,vector< T_unsigned<int,hashgcd_U> > & d, vector< T_unsigned<int,hashgcd_U> > & pcofactor, vector< T_unsigned<int,hashgcd_U> > & qcofactor,const std::vector<hashgcd_U> & vars, bool compute_pcofactor,bool compute_qcofactor,bool & divtest,vector< vector<int> > & pv,vector< vector<int> > & qv,vector< vector<int> > & dv,vector< vector<int> > & dpv,vector< vector<int> > & dim2gcdv,vector< vector<int> > & dim2pcofactorv,vector< vector<int> > & dim2qcofactorv,int nthreads){
+    trace_scope scope("mod_gcd",modulo);
 #ifdef NO_TEMPLATE_MULTGCD
     return false;
 #else
@@ -2831,7 +3057,7 @@ mpz_class smod(const mpz_class & a,int reduce){
 	// Now, gcd divides pD for gcddeg+1 values of x1
 	// degree(pD)<=degree(gcd)
 	// gcd_mutex_lock();
-	if (hashdivrem(p,pD,pquo,tmprem,vars,modulo,0,false,0/* 0:default, 1: check divisibility only heap div*/)==1 && tmprem.empty()){
+	if (hashdivides2(p,q,pD,pquo,qquo,vars,modulo,0,false)){
 	  // If pD divides both P and Q, then the degree wrt variables
 	  // x1,...,xn-1 is the right one (because it is <= since pD 
 	  // divides the gcd and >= since pD(xn=one of the try) was a gcd
@@ -2850,28 +3076,26 @@ mpz_class smod(const mpz_class & a,int reduce){
 	  // if P=pD*cofactor is true for degree(P) values of x1
 	  // and same for Q, and the degrees wrt xn of pD and cofactors
 	  // have sum equal to degree of P or Q + lcoeff then pD is the gcd
-	  if (hashdivrem(q,pD,qquo,tmprem,vars,modulo,0,false,0)==1 && tmprem.empty()){
-	    // gcd_mutex_unlock();
-	    if (dcont.size()==1 && dcont.front().g==1 && dcont.front().u==0)
-	      d.swap(pD);
-	    else
-	      smallmult(pD,dcont,d,modulo,0);
-	    smallmult(invmod(d.front().g,modulo),d,d,modulo);
-	    if (compute_pcofactor){
-	      smallmult(pcofactor,pquo,pcofactor,modulo,0);
-	      smallmult(smod(longlong(p_orig.front().g)*invmod(pcofactor.front().g,modulo),modulo),pcofactor,pcofactor,modulo);
-	    }
-	    if (compute_qcofactor){
-	      smallmult(qcofactor,qquo,qcofactor,modulo,0);
-	      smallmult(smod(longlong(q_orig.front().g)*invmod(qcofactor.front().g,modulo),modulo),qcofactor,qcofactor,modulo);
-	    }
-	    if (debug_infolevel>20-dim)
-	      CERR << "gcdmod found dim " << dim << " " << CLOCK() << '\n';
-	    if (pqswap)
-	      swap(pcofactor,qcofactor);
-	    return true;
-	  } // end if hashdivrem(q,...)	      
-	} // end if hashdivrem(p,...)
+	  // gcd_mutex_unlock();
+	  if (dcont.size()==1 && dcont.front().g==1 && dcont.front().u==0)
+	    d.swap(pD);
+	  else
+	    smallmult(pD,dcont,d,modulo,0);
+	  smallmult(invmod(d.front().g,modulo),d,d,modulo);
+	  if (compute_pcofactor){
+	    smallmult(pcofactor,pquo,pcofactor,modulo,0);
+	    smallmult(smod(longlong(p_orig.front().g)*invmod(pcofactor.front().g,modulo),modulo),pcofactor,pcofactor,modulo);
+	  }
+	  if (compute_qcofactor){
+	    smallmult(qcofactor,qquo,qcofactor,modulo,0);
+	    smallmult(smod(longlong(q_orig.front().g)*invmod(qcofactor.front().g,modulo),modulo),qcofactor,qcofactor,modulo);
+	  }
+	  if (debug_infolevel>20-dim)
+	    CERR << "gcdmod found dim " << dim << " " << CLOCK() << '\n';
+	  if (pqswap)
+	    swap(pcofactor,qcofactor);
+	  return true;
+	} // end if hashdivides2(p,q,...)
 	//gcd_mutex_unlock();
 	if (debug_infolevel>20-dim)
 	  CERR << "Gcdmod bad guess " << '\n';
@@ -3062,7 +3286,7 @@ mpz_class smod(const mpz_class & a,int reduce){
       gcd_call_param_v[nthreads-1].dim2palphaptr=&dim2palpha_nthreads;
       gcd_call_param_v[nthreads-1].dim2qalphaptr=&dim2qalpha_nthreads;
 #ifdef HAVE_PTHREAD_H
-      pthread_t tab[nthreads-1];
+      thread_task tab[nthreads-1];
 #endif
       for (int thread=0;thread<nthreads;++thread){
 	int vpos=int(alphav.size())-(nthreads-thread);
@@ -3075,7 +3299,7 @@ mpz_class smod(const mpz_class & a,int reduce){
 	if (thread==nthreads-1)
 	  do_recursive_gcd_call((void *)&gcd_call_param_v[thread]);
 	else { // launch gcd computation in a separate thread
-	  bool res=pthread_create(&tab[thread],(pthread_attr_t *) NULL,do_recursive_gcd_call,(void *) &gcd_call_param_v[thread]);
+	  bool res=thread_task_create(&tab[thread],do_recursive_gcd_call,(void *) &gcd_call_param_v[thread]);
 	  if (res)
 	    do_recursive_gcd_call((void *)&gcd_call_param_v[thread]);
 	}
@@ -3093,7 +3317,7 @@ mpz_class smod(const mpz_class & a,int reduce){
 	int vpos=alphav.size()-(nthreads-thread);
 	// wait for thread to finish
 	void * ptr;
-	pthread_join(tab[thread],&ptr);
+	thread_task_join(tab[thread],&ptr);
 	if (!ptr){
 	  if (dim2) 
 	    dim2gcdv[vpos].clear();
@@ -3203,30 +3427,28 @@ mpz_class smod(const mpz_class & a,int reduce){
 		if (debug_infolevel>20-dim)
 		  CERR << CLOCK()*1e-6 << " SPMOD trygcd" << '\n';
 		pp_mod_last(trygcd,0,modulo,varxn,var2,tmpcont);
-		if (hashdivrem(p,trygcd,pquo,tmprem,vars,modulo,0,false)==1 && tmprem.empty()){
-		  if (hashdivrem(q,trygcd,qquo,tmprem,vars,modulo,0,false)==1 && tmprem.empty()){
-		    if (dcont.size()==1 && dcont.front().g==1 && dcont.front().u==0)
-		      d.swap(trygcd);
-		    else
-		      smallmult(trygcd,dcont,d,modulo,0);
-		    smallmult(invmod(d.front().g,modulo),d,d,modulo);
-		    if (compute_pcofactor){
-		      smallmult(pcofactor,pquo,pcofactor,modulo,0);
-		    smallmult(smod(longlong(p_orig.front().g)*invmod(pcofactor.front().g,modulo),modulo),pcofactor,pcofactor);
-		    }
-		    if (compute_qcofactor){
-		      smallmult(qcofactor,qquo,qcofactor,modulo,0);
-		      smallmult(smod(longlong(q_orig.front().g)*invmod(qcofactor.front().g,modulo),modulo),qcofactor,qcofactor);
-		    }
-		    if (debug_infolevel>20-dim)
-		      CERR << "gcdmod found dim " << dim << " " << CLOCK() << '\n';
-		    if (pqswap){
-		      swap(pcofactor,qcofactor);
-		      swap(dim2pcofactorv,dim2qcofactorv);
-		    }
-		    return true;
-		  } // end q divisible by trygcd
-		} // end p divisible by trygcd
+		if (hashdivides2(p,q,trygcd,pquo,qquo,vars,modulo,0,false)){
+		  if (dcont.size()==1 && dcont.front().g==1 && dcont.front().u==0)
+		    d.swap(trygcd);
+		  else
+		    smallmult(trygcd,dcont,d,modulo,0);
+		  smallmult(invmod(d.front().g,modulo),d,d,modulo);
+		  if (compute_pcofactor){
+		    smallmult(pcofactor,pquo,pcofactor,modulo,0);
+		  smallmult(smod(longlong(p_orig.front().g)*invmod(pcofactor.front().g,modulo),modulo),pcofactor,pcofactor);
+		  }
+		  if (compute_qcofactor){
+		    smallmult(qcofactor,qquo,qcofactor,modulo,0);
+		    smallmult(smod(longlong(q_orig.front().g)*invmod(qcofactor.front().g,modulo),modulo),qcofactor,qcofactor);
+		  }
+		  if (debug_infolevel>20-dim)
+		    CERR << "gcdmod found dim " << dim << " " << CLOCK() << '\n';
+		  if (pqswap){
+		    swap(pcofactor,qcofactor);
+		    swap(dim2pcofactorv,dim2qcofactorv);
+		  }
+		  return true;
+		} // end p and q divisible by trygcd
 	      } // end m invertible
 	    } // end if (dim>2 && gcddeg-nzero==e)
 	  } // end if (!compute_cof && nzero)
@@ -3637,7 +3859,281 @@ mpz_class smod(const mpz_class & a,int reduce){
     return 0;
   }
 
+  // image of the Z gcd modulo one prime, computed by do_modgcd_prime in
+  // a pool task, ok is false for an unlucky prime
+  struct modgcd_prime_t {
+    const vector< T_unsigned<gen,hashgcd_U> > * p_orig,* q_orig;
+    const vector<hashgcd_U> * vars;
+    const index_t * shift_vars,* pdeg,* qdeg;
+    int modulo,lg,lp,lq,nthreads;
+    bool ok,divtest;
+    vector< T_unsigned<int,hashgcd_U> > g,pcof,qcof;
+    index_t gdeg;
+  };
+
+  // the task runs with the interrupt flags of the evaluation that
+  // created it (pool_run), a Ctrl-C or a timeout skips the remaining primes
+  static void * do_modgcd_prime(void * ptr){
+    modgcd_prime_t & a=*(modgcd_prime_t *) ptr;
+    a.ok=false;
+#ifdef TIMEOUT
+    control_c();
+#endif
+    if (ctrl_c || interrupted)
+      return ptr;
+    int modulo=a.modulo;
+    vector< T_unsigned<int,hashgcd_U> > p,q;
+    index_t pdegmod,qdegmod;
+    smod(*a.p_orig,modulo,p);
+    degree(p,*a.shift_vars,pdegmod);
+    if (pdegmod!=*a.pdeg || ctrl_c || interrupted)
+      return ptr;
+    smod(*a.q_orig,modulo,q);
+    degree(q,*a.shift_vars,qdegmod);
+    if (qdegmod!=*a.qdeg)
+      return ptr;
+    vector< vector<int> > pv,qv,dv,dpv,dim2gcdv,dim2pcofactorv,dim2qcofactorv;
+    if (!mod_gcd(p,q,modulo,a.g,a.pcof,a.qcof,*a.vars,true,true,a.divtest,pv,qv,dv,dpv,dim2gcdv,dim2pcofactorv,dim2qcofactorv,a.nthreads))
+      return ptr;
+    degree(a.g,*a.shift_vars,a.gdeg);
+    // normalize g, pcof, qcof
+    smallmult(smod(longlong(a.lg)*invmod(a.g.front().g,modulo),modulo),a.g,a.g,modulo);
+    smallmult(smod(longlong(a.lp)*invmod(a.pcof.front().g,modulo),modulo),a.pcof,a.pcof,modulo);
+    smallmult(smod(longlong(a.lq)*invmod(a.qcof.front().g,modulo),modulo),a.qcof,a.qcof,modulo);
+    a.ok=true;
+    return ptr;
+  }
+
+  // chinese remainder of the images v[i] modulo mods[i] by a product tree,
+  // the result is v[0] modulo mods[0]. Each level halves the number of
+  // images, a coefficient is combined log2(v.size()) times instead of
+  // v.size() times by successive ichinrem. Stops on Ctrl-C or timeout,
+  // the caller checks the flags before using v[0]
+  struct ichinrem_tree_t {
+    vector< vector< T_unsigned<gen,hashgcd_U> > > v;
+    vector<gen> mods;
+  };
+
+  static void * do_ichinrem_tree(void * ptr){
+    ichinrem_tree_t & t=*(ichinrem_tree_t *) ptr;
+    size_t n=t.v.size();
+    for (size_t step=1;step<n;step*=2){
+#ifdef TIMEOUT
+      control_c();
+#endif
+      if (ctrl_c || interrupted)
+	return ptr;
+      for (size_t i=0;i+step<n;i+=2*step){
+	ichinrem(t.v[i+step],t.mods[i+step],t.v[i],t.mods[i]);
+	t.mods[i]=t.mods[i]*t.mods[i+step];
+      }
+    }
+    return ptr;
+  }
+
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+  // run f on each arg as pool tasks. Joining from the last one, the caller
+  // runs the tasks no worker has taken yet. An exception in a task is
+  // rethrown once all the tasks are finished, they use the caller frame
+  static void thread_task_run_all(void * (* f)(void *),const vector<void *> & args){
+    vector<thread_task> tasks(args.size());
+    for (size_t i=0;i<args.size();++i)
+      thread_task_create(&tasks[i],f,args[i]);
+    string error;
+    for (size_t i=tasks.size();i-->0;){
+      try {
+	thread_task_join(tasks[i],0);
+      }
+      catch (std::runtime_error & e){
+	error=e.what();
+      }
+    }
+    if (!error.empty())
+      throw std::runtime_error(error);
+  }
+#endif
+
+  // gcd cache (gcd_cache_scope in threaded.h): entries are kept in most
+  // recently used order, the index maps the hash of the unordered pair of
+  // operands to the entries, a hit compares the operands and swaps the
+  // cofactors if they were given in the other order
+  struct gcd_cache_entry {
+    vector< T_unsigned<gen,hashgcd_U> > p,q,d,pcof,qcof;
+    vector<hashgcd_U> vars;
+    size_t key,size;
+  };
+  struct gcd_cache_t {
+    size_t used;
+    list<gcd_cache_entry> entries;
+    multimap<size_t,list<gcd_cache_entry>::iterator> index;
+    gcd_cache_t():used(0){}
+    void erase(list<gcd_cache_entry>::iterator it){
+      multimap<size_t,list<gcd_cache_entry>::iterator>::iterator jt=index.lower_bound(it->key),jtend=index.upper_bound(it->key);
+      for (;jt!=jtend;++jt){
+	if (jt->second==it){
+	  index.erase(jt);
+	  break;
+	}
+      }
+      used -= it->size;
+      entries.erase(it);
+    }
+  };
+  static size_t gcd_cache_budget=0;
+  // shared by the caches of concurrent evaluations, the budget and the
+  // counters are read and written under gcd_cache_mutex
+  static unsigned gcd_cache_hits=0,gcd_cache_misses=0,gcd_cache_evicted=0;
+#ifdef HAVE_LIBPTHREAD
+  static pthread_mutex_t gcd_cache_mutex=PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+  static void gcd_cache_lock(){
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_lock(&gcd_cache_mutex);
+#endif
+  }
+  
+  static void gcd_cache_unlock(){
+#ifdef HAVE_LIBPTHREAD
+    pthread_mutex_unlock(&gcd_cache_mutex);
+#endif
+  }
+  static GIAC_THREAD_LOCAL gcd_cache_t * gcd_cache_current=0;
+
+  gcd_cache_scope::gcd_cache_scope():c(0){
+    gcd_cache_lock();
+    bool on=gcd_cache_budget!=0;
+    gcd_cache_unlock();
+    if (on && !gcd_cache_current)
+      gcd_cache_current=(gcd_cache_t *) (c=new gcd_cache_t);
+  }
+
+  gcd_cache_scope::~gcd_cache_scope(){
+    if (!c)
+      return;
+    gcd_cache_current=0;
+    delete (gcd_cache_t *) c;
+  }
+
+  void gcd_cache_size(size_t bytes){
+    gcd_cache_lock();
+    gcd_cache_budget=bytes;
+    gcd_cache_hits=gcd_cache_misses=gcd_cache_evicted=0;
+    gcd_cache_unlock();
+  }
+
+  string gcd_cache_stats(){
+    gcd_cache_lock();
+    unsigned hits=gcd_cache_hits,misses=gcd_cache_misses,evicted=gcd_cache_evicted;
+    size_t budget=gcd_cache_budget;
+    gcd_cache_unlock();
+    return "Gcd cache hits "+print_INT_(int(hits))+", misses "+print_INT_(int(misses))+", evicted "+print_INT_(int(evicted))+", budget "+print_INT_(int(budget));
+  }
+
+  static size_t gcd_cache_hash(const vector< T_unsigned<gen,hashgcd_U> > & p,size_t & size){
+    size_t h=p.size();
+    vector< T_unsigned<gen,hashgcd_U> >::const_iterator it=p.begin(),itend=p.end();
+    size += p.capacity()*sizeof(T_unsigned<gen,hashgcd_U>);
+    for (;it!=itend;++it){
+      const gen & g=it->g;
+      size_t gh;
+      if (g.type==_INT_)
+	gh=g.val;
+      else if (g.type==_ZINT){
+	gh=mpz_getlimbn(*g._ZINTptr,0)+mpz_size(*g._ZINTptr)*0x9e3779b9;
+	size += sizeof(ref_mpz_t)+mpz_size(*g._ZINTptr)*sizeof(mp_limb_t);
+      }
+      else
+	gh=g.type;
+      h = h*1000003 ^ (size_t(it->u)*0x9e3779b9+gh);
+    }
+    return h;
+  }
+
+  // gcd_cache_find and gcd_cache_insert are called with gcd_cache_mutex held
+  static bool gcd_cache_find(const vector< T_unsigned<gen,hashgcd_U> > & p,const vector< T_unsigned<gen,hashgcd_U> > & q,const std::vector<hashgcd_U> & vars,size_t key,vector< T_unsigned<gen,hashgcd_U> > & d, vector< T_unsigned<gen,hashgcd_U> > & pcofactor, vector< T_unsigned<gen,hashgcd_U> > & qcofactor){
+    gcd_cache_t & c=*gcd_cache_current;
+    multimap<size_t,list<gcd_cache_entry>::iterator>::iterator jt=c.index.lower_bound(key),jtend=c.index.upper_bound(key);
+    for (;jt!=jtend;++jt){
+      list<gcd_cache_entry>::iterator it=jt->second;
+      if (it->vars!=vars)
+	continue;
+      bool swapped=false;
+      if (it->p!=p || it->q!=q){
+	if (it->p!=q || it->q!=p)
+	  continue;
+	swapped=true;
+      }
+      d=it->d;
+      pcofactor=swapped?it->qcof:it->pcof;
+      qcofactor=swapped?it->pcof:it->qcof;
+      c.entries.splice(c.entries.begin(),c.entries,it);
+      return true;
+    }
+    return false;
+  }
+
+  static void gcd_cache_insert(const vector< T_unsigned<gen,hashgcd_U> > & p,const vector< T_unsigned<gen,hashgcd_U> > & q,const std::vector<hashgcd_U> & vars,size_t key,size_t size,const vector< T_unsigned<gen,hashgcd_U> > & d,const vector< T_unsigned<gen,hashgcd_U> > & pcofactor,const vector< T_unsigned<gen,hashgcd_U> > & qcofactor){
+    gcd_cache_t & c=*gcd_cache_current;
+    // results take about as much room as the operands
+    size=2*size+sizeof(gcd_cache_entry);
+    size_t budget=gcd_cache_budget;
+    // at most a quarter of the memory budget of the evaluation
+    if (current_eval_token && current_eval_token->maxmem && budget>current_eval_token->maxmem/4)
+      budget=current_eval_token->maxmem/4;
+    if (size>budget/4)
+      return;
+    while (c.used+size>budget && !c.entries.empty()){
+      c.erase(--c.entries.end());
+      ++gcd_cache_evicted;
+    }
+    c.entries.push_front(gcd_cache_entry());
+    gcd_cache_entry & e=c.entries.front();
+    e.p=p; e.q=q; e.d=d; e.pcof=pcofactor; e.qcof=qcofactor; e.vars=vars;
+    e.key=key; e.size=size;
+    c.used += size;
+    c.index.insert(pair<const size_t,list<gcd_cache_entry>::iterator>(key,c.entries.begin()));
+  }
+
+  static bool gcd_uncached(const vector< T_unsigned<gen,hashgcd_U> > & p_orig,const vector< T_unsigned<gen,hashgcd_U> > & q_orig,vector< T_unsigned<gen,hashgcd_U> > & d, vector< T_unsigned<gen,hashgcd_U> > & pcofactor, vector< T_unsigned<gen,hashgcd_U> > & qcofactor,const std::vector<hashgcd_U> & vars, bool compute_cofactors,int nthreads);
+
   bool gcd(const vector< T_unsigned<gen,hashgcd_U> > & p_orig,const vector< T_unsigned<gen,hashgcd_U> > & q_orig,vector< T_unsigned<gen,hashgcd_U> > & d, vector< T_unsigned<gen,hashgcd_U> > & pcofactor, vector< T_unsigned<gen,hashgcd_U> > & qcofactor,const std::vector<hashgcd_U> & vars, bool compute_cofactors,int nthreads){
+    if (!gcd_cache_current)
+      return gcd_uncached(p_orig,q_orig,d,pcofactor,qcofactor,vars,compute_cofactors,nthreads);
+    size_t size=0,hp=gcd_cache_hash(p_orig,size),hq=gcd_cache_hash(q_orig,size);
+    // symmetric in p and q
+    size_t key=(hp+hq)^(hp*hq);
+    gcd_cache_lock();
+    bool found;
+    try {
+      found=gcd_cache_find(p_orig,q_orig,vars,key,d,pcofactor,qcofactor);
+    } catch (...){
+      gcd_cache_unlock();
+      throw;
+    }
+    if (found){
+      ++gcd_cache_hits;
+      gcd_cache_unlock();
+      perf_add(PERF_GCD_CACHE_HITS);
+      return true;
+    }
+    ++gcd_cache_misses;
+    gcd_cache_unlock();
+    perf_add(PERF_GCD_CACHE_MISSES);
+    if (!gcd_uncached(p_orig,q_orig,d,pcofactor,qcofactor,vars,compute_cofactors,nthreads))
+      return false;
+    gcd_cache_lock();
+    try {
+      gcd_cache_insert(p_orig,q_orig,vars,key,size,d,pcofactor,qcofactor);
+    } catch (...){
+      gcd_cache_unlock();
+      throw;
+    }
+    gcd_cache_unlock();
+    return true;
+  }
+
+  static bool gcd_uncached(const vector< T_unsigned<gen,hashgcd_U> > & p_orig,const vector< T_unsigned<gen,hashgcd_U> > & q_orig,vector< T_unsigned<gen,hashgcd_U> > & d, vector< T_unsigned<gen,hashgcd_U> > & pcofactor, vector< T_unsigned<gen,hashgcd_U> > & qcofactor,const std::vector<hashgcd_U> & vars, bool compute_cofactors,int nthreads){
 #ifdef NO_TEMPLATE_MULTGCD
     return false;
 #else
@@ -3768,79 +4264,143 @@ mpz_class smod(const mpz_class & a,int reduce){
 	}
 	if (divtest) {
 	  // division test
-	  vector< T_unsigned<gen,hashgcd_U> > dtest(d),pquo,qquo,rem;
+	  vector< T_unsigned<gen,hashgcd_U> > dtest(d),pquo,qquo;
 	  ppz(d,0,true);
-	  if (hashdivrem(p_orig,dtest,pquo,rem,vars,0 /* reduce */,0/*qmax*/,false)==1 && rem.empty()){
-	    if (hashdivrem(q_orig,dtest,qquo,rem,vars,0 /* reduce */,0/*qmax*/,false)==1 && rem.empty()){
-	      pcofactor=pquo;
-	      qcofactor=qquo;
-	      return true;
-	    }
+	  if (hashdivides2(p_orig,q_orig,dtest,pquo,qquo,vars,0 /* reduce */,0/*qmax*/,false)){
+	    pcofactor=pquo;
+	    qcofactor=qquo;
+	    return true;
 	  }
 	  d=dtest;
 	}
       } // end for (;;)
       return false;
     } // end if (is_complex)
-    // gcd in Z[x1,..,xn]
-    vector< T_unsigned<int,hashgcd_U> > p,q,g,pcof,qcof;
+    // gcd in Z[x1,..,xn]: a batch of primes is reduced at the same time
+    // on the pool, the images of the expected degree are combined by a
+    // product tree before the chinese remainder with d
+    int nprimes=0; // images in d
+    gen lcbound=abs(gcdlcoeff,context0)*max(max(p_orig,context0),max(q_orig,context0));
+    int lcbits=sizeinbase2(lcbound);
+    vector<modgcd_prime_t> images;
+    ichinrem_tree_t dtree,ptree,qtree;
     for (;;){
-      m=nextprime(m+1);
 #ifdef TIMEOUT
       control_c();
 #endif
-      if (ctrl_c || interrupted || m.type!=_INT_)
+      if (ctrl_c || interrupted)
 	return false;
-      int modulo=m.val;
-      int lg=smod(gcdlcoeff,modulo).val,lp=smod(lcoeffp,modulo).val,lq=smod(lcoeffq,modulo).val;
-      if (!lg || !lp || !lq)
-	continue;
-      smod(p_orig,modulo,p);
-      degree(p,shift_vars,pdegmod);
-      if (pdegmod!=pdeg)
-	continue;
-      smod(q_orig,modulo,q);
-      degree(q,shift_vars,qdegmod);
-      if (qdegmod!=qdeg)
-	continue;
-      if (!mod_gcd(p,q,modulo,g,pcof,qcof,vars,compute_cofactors,compute_cofactors,divtest,pv,qv,dv,dpv,dim2gcdv,dim2pcofactorv,dim2qcofactorv,nthreads))
-	continue;
-      degree(g,shift_vars,gdegmod);
-      // normalize g, pcof, qcof
-      smallmult(smod(longlong(lg)*invmod(g.front().g,modulo),modulo),g,g,modulo);
-      smallmult(smod(longlong(lp)*invmod(pcof.front().g,modulo),modulo),pcof,pcof,modulo);
-      smallmult(smod(longlong(lq)*invmod(qcof.front().g,modulo),modulo),qcof,qcof,modulo);
-      // CERR << " g " << g << " pcof " << pcof << "qcof " << qcof << '\n';
-      int cmp=compare(gdegmod,gdeg);
-      if (cmp==0){ // bad reduction
-	continue;
+      // the first prime is alone (small gcds need one prime), then about
+      // enough primes for the coefficients of p and q
+      int batch=1;
+      if (nprimes && nthreads>1)
+	batch=giacmax(1,giacmin(nthreads,(lcbits+28)/29-nprimes));
+      images.resize(batch);
+      for (int i=0;i<batch;++i){
+	modgcd_prime_t & a=images[i];
+	for (;;){
+	  m=nextprime(m+1);
+	  if (m.type!=_INT_)
+	    return false;
+	  a.modulo=m.val;
+	  a.lg=smod(gcdlcoeff,a.modulo).val;
+	  a.lp=smod(lcoeffp,a.modulo).val;
+	  a.lq=smod(lcoeffq,a.modulo).val;
+	  if (a.lg && a.lp && a.lq)
+	    break;
+	}
+	a.p_orig=&p_orig; a.q_orig=&q_orig; a.vars=&vars;
+	a.shift_vars=&shift_vars; a.pdeg=&pdeg; a.qdeg=&qdeg;
+	a.nthreads=batch==1?nthreads:1;
       }
-      if (cmp==-1){
-	// restart
-	d.clear();
-	pcofactor.clear();
-	qcofactor.clear();
-	pimod=1;
-	continue;
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+      if (batch>1){
+	vector<void *> args(batch);
+	for (int i=0;i<batch;++i)
+	  args[i]=(void *) &images[i];
+	thread_task_run_all(do_modgcd_prime,args);
       }
-      if (cmp==-2){
-	// same degrees, chinese remainder
-	ichinrem(g,modulo,d,pimod);
-	if (compute_cofactors){
-	  ichinrem(pcof,modulo,pcofactor,pimod);
-	  ichinrem(qcof,modulo,qcofactor,pimod);
+      else
+#endif
+	for (int i=0;i<batch;++i)
+	  do_modgcd_prime((void *) &images[i]);
+      if (ctrl_c || interrupted)
+	return false;
+      // same rules as one prime at a time, in the order of the primes
+      dtree.v.clear(); ptree.v.clear(); qtree.v.clear(); dtree.mods.clear();
+      bool changed=false;
+      for (int i=0;i<batch;++i){
+	modgcd_prime_t & a=images[i];
+	if (!a.ok)
+	  continue;
+	// CERR << " g " << a.g << " pcof " << a.pcof << "qcof " << a.qcof << '\n';
+	int cmp=compare(a.gdeg,gdeg);
+	if (cmp==0) // bad reduction
+	  continue;
+	if (cmp==-1){
+	  // restart
+	  d.clear();
+	  pcofactor.clear();
+	  qcofactor.clear();
+	  pimod=1;
+	  nprimes=0;
+	  dtree.v.clear(); ptree.v.clear(); qtree.v.clear(); dtree.mods.clear();
+	  changed=false;
+	  continue;
 	}
-	pimod = modulo * pimod;
-      }
-      else {
-	// restart with this modular gcd
-	unmod(g,d,modulo);
-	if (compute_cofactors){
-	  unmod(pcof,pcofactor,modulo);
-	  unmod(qcof,qcofactor,modulo);
+	if (cmp!=-2){
+	  // restart with this modular gcd
+	  d.clear();
+	  pcofactor.clear();
+	  qcofactor.clear();
+	  pimod=1;
+	  nprimes=0;
+	  dtree.v.clear(); ptree.v.clear(); qtree.v.clear(); dtree.mods.clear();
+	  gdeg=a.gdeg;
 	}
-	pimod=modulo;
-	gdeg=gdegmod;
+	divtest=a.divtest;
+	changed=true;
+	dtree.v.push_back(vector< T_unsigned<gen,hashgcd_U> >());
+	unmod(a.g,dtree.v.back(),a.modulo);
+	ptree.v.push_back(vector< T_unsigned<gen,hashgcd_U> >());
+	unmod(a.pcof,ptree.v.back(),a.modulo);
+	qtree.v.push_back(vector< T_unsigned<gen,hashgcd_U> >());
+	unmod(a.qcof,qtree.v.back(),a.modulo);
+	dtree.mods.push_back(a.modulo);
+      }
+      if (!changed)
+	continue;
+      {
+	trace_scope scope("crt",dtree.v.size());
+	ptree.mods=qtree.mods=dtree.mods;
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+	if (dtree.v.size()>1 && nthreads>1){
+	  vector<void *> args(3);
+	  args[0]=(void *) &dtree; args[1]=(void *) &ptree; args[2]=(void *) &qtree;
+	  thread_task_run_all(do_ichinrem_tree,args);
+	}
+	else
+#endif
+	  {
+	    do_ichinrem_tree((void *) &dtree);
+	    do_ichinrem_tree((void *) &ptree);
+	    do_ichinrem_tree((void *) &qtree);
+	  }
+	if (ctrl_c || interrupted)
+	  return false;
+	if (nprimes==0){
+	  swap(d,dtree.v.front());
+	  swap(pcofactor,ptree.v.front());
+	  swap(qcofactor,qtree.v.front());
+	  pimod=dtree.mods.front();
+	}
+	else {
+	  ichinrem(dtree.v.front(),dtree.mods.front(),d,pimod);
+	  ichinrem(ptree.v.front(),dtree.mods.front(),pcofactor,pimod);
+	  ichinrem(qtree.v.front(),dtree.mods.front(),qcofactor,pimod);
+	  pimod = dtree.mods.front() * pimod;
+	}
+	nprimes += int(dtree.v.size());
       }
       // are we finished?
       if (compute_cofactors){
@@ -3865,14 +4425,12 @@ mpz_class smod(const mpz_class & a,int reduce){
       }
       if (divtest) {
 	// division test
-	vector< T_unsigned<gen,hashgcd_U> > dtest(d),pquo,qquo,rem;
+	vector< T_unsigned<gen,hashgcd_U> > dtest(d),pquo,qquo;
 	ppz(d,0,true);
-	if (hashdivrem(p_orig,dtest,pquo,rem,vars,0 /* reduce */,0/*qmax*/,false)==1 && rem.empty()){
-	  if (hashdivrem(q_orig,dtest,qquo,rem,vars,0 /* reduce */,0/*qmax*/,false)==1 && rem.empty()){
-	    pcofactor=pquo;
-	    qcofactor=qquo;
-	    return true;
-	  }
+	if (hashdivides2(p_orig,q_orig,dtest,pquo,qquo,vars,0 /* reduce */,0/*qmax*/,false)){
+	  pcofactor=pquo;
+	  qcofactor=qquo;
+	  return true;
 	}
 	d=dtest;
       }
@@ -4929,13 +5487,11 @@ mpz_class smod(const mpz_class & a,int reduce){
 	// ?FIXME? use pseudo-division test 
 	if (debug_infolevel)
 	  CERR << CLOCK() << " algmodgcd hashdivrem " << test.size() <<'\n';// << " " << test << '\n';
-	if (test==prevtest && hashdivrem(p0,test,Pcof,tmprem,vars,pminmodulo,0,true)==1 && tmprem.empty()){
-	  if (hashdivrem(q0,test,Qcof,tmprem,vars,pminmodulo,0,true)==1 && tmprem.empty()){
-	    if (debug_infolevel)
-	      CERR << CLOCK() << " algmodgcd hashdivrem success" << '\n';
-	    D=test;
-	    return 1;
-	  }
+	if (test==prevtest && hashdivides2(p0,q0,test,Pcof,Qcof,vars,pminmodulo,0,true)){
+	  if (debug_infolevel)
+	    CERR << CLOCK() << " algmodgcd hashdivrem success" << '\n';
+	  D=test;
+	  return 1;
 	}
 	prevtest=test;
 	if (debug_infolevel)
@@ -5184,6 +5740,7 @@ mpz_class smod(const mpz_class & a,int reduce){
 
 #ifndef NO_TEMPLATE_MULTGCD
   static void * do_recursive_gcd_ext_call(void * ptr_){
+    trace_scope scope("thread_gcd_ext");
 #ifdef TIMEOUT
     control_c();
 #endif
@@ -5712,7 +6269,7 @@ mpz_class smod(const mpz_class & a,int reduce){
       } // end for (int thread=0;thread<nthreads;++thread)
       vector<gcd_call_param<vector<int> > > gcd_call_param_v(nthreads,gcd_par);
 #ifdef HAVE_PTHREAD_H
-      pthread_t tab[nthreads-1];
+      thread_task tab[nthreads-1];
 #endif
       for (int thread=0;thread<nthreads;++thread){
 	int vpos=int(alphav.size())-(nthreads-thread);
@@ -5725,7 +6282,7 @@ mpz_class smod(const mpz_class & a,int reduce){
 	if (thread==nthreads-1)
 	  do_recursive_gcd_ext_call((void *)&gcd_call_param_v[thread]);
 	else { // launch gcd computation in a separate thread
-	  bool res=pthread_create(&tab[thread],(pthread_attr_t *) NULL,do_recursive_gcd_ext_call,(void *) &gcd_call_param_v[thread]);
+	  bool res=thread_task_create(&tab[thread],do_recursive_gcd_ext_call,(void *) &gcd_call_param_v[thread]);
 	  if (res)
 	    do_recursive_gcd_ext_call((void *)&gcd_call_param_v[thread]);
 	}
@@ -5745,7 +6302,7 @@ mpz_class smod(const mpz_class & a,int reduce){
 #ifdef HAVE_PTHREAD_H
 	if (thread!=nthreads-1){
 	  void * ptr;
-	  pthread_join(tab[thread],&ptr);
+	  thread_task_join(tab[thread],&ptr);
 	  if (!ptr){
 	    gcdv[vpos].clear(); gcd_ext_ok=0;
 	  }
@@ -5822,25 +6379,23 @@ mpz_class smod(const mpz_class & a,int reduce){
 		}
 		// Check if trygcd is the gcd!
 		pp_mod(trygcd,0,modulo,varxn,var2,tmpcont);
-		if (hashdivrem(p,trygcd,pquo,tmprem,vars,modulo,0,false)==1 && tmprem.empty()){
-		  if (hashdivrem(q,trygcd,qquo,tmprem,vars,modulo,0,false)==1 && tmprem.empty()){
-		    smallmult(trygcd,dcont,d,modulo,0);
-		    smallmult(invmod(d.front().g,modulo),d,d,modulo);
-		    if (compute_pcofactor){
-		      smallmult(pcofactor,pquo,pcofactor,modulo,0);
-		    smallmult(smod(longlong(p_orig.front().g)*invmod(pcofactor.front().g,modulo),modulo),pcofactor,pcofactor);
-		    }
-		    if (compute_qcofactor){
-		      smallmult(qcofactor,qquo,qcofactor,modulo,0);
-		      smallmult(smod(longlong(q_orig.front().g)*invmod(qcofactor.front().g,modulo),modulo),qcofactor,qcofactor);
-		    }
-		    if (debug_infolevel>20-dim)
-		      CERR << "gcdmod found dim " << dim << " " << CLOCK() << '\n';
-		    if (pqswap)
-		      swap(pcofactor,qcofactor);
-		    return true;
-		  } // end q divisible by trygcd
-		} // end p divisible by trygcd
+		if (hashdivides2(p,q,trygcd,pquo,qquo,vars,modulo,0,false)){
+		  smallmult(trygcd,dcont,d,modulo,0);
+		  smallmult(invmod(d.front().g,modulo),d,d,modulo);
+		  if (compute_pcofactor){
+		    smallmult(pcofactor,pquo,pcofactor,modulo,0);
+		  smallmult(smod(longlong(p_orig.front().g)*invmod(pcofactor.front().g,modulo),modulo),pcofactor,pcofactor);
+		  }
+		  if (compute_qcofactor){
+		    smallmult(qcofactor,qquo,qcofactor,modulo,0);
+		    smallmult(smod(longlong(q_orig.front().g)*invmod(qcofactor.front().g,modulo),modulo),qcofactor,qcofactor);
+		  }
+		  if (debug_infolevel>20-dim)
+		    CERR << "gcdmod found dim " << dim << " " << CLOCK() << '\n';
+		  if (pqswap)
+		    swap(pcofactor,qcofactor);
+		  return true;
+		} // end p and q divisible by trygcd
 	      } // end m invertible
 	    } // end if (dim>2 && )
 	  } // end SPMOD
@@ -3601,6 +3601,7 @@ namespace giac {
 	  }
 	}
 	if (!done) {// store b globally
+	  caseval_cache_invalidate(name);
 	  if (contains(lidnt(a),b)){
 	    if (a.is_symb_of_sommet(at_when) || a.is_symb_of_sommet(at_ifte) || a.is_symb_of_sommet(at_program))
 	      *logptr(contextptr) << b.print(contextptr)+gettext(": recursive definition") << '\n';
@@ -3632,6 +3633,7 @@ namespace giac {
 	else
 	  return gensizeerr(b.print(contextptr)+gettext(": recursive definition (in sto) "));
       }
+      caseval_cache_invalidate(name);
       if (b._IDNTptr->localvalue && !b._IDNTptr->localvalue->empty() && (b.subtype!=_GLOBAL__EVAL))
 	b._IDNTptr->localvalue->back()=aa;
       else {
@@ -3695,6 +3697,8 @@ namespace giac {
         return ret;
       if (destination.type==_IDNT && destination._IDNTptr->quoted)
 	*destination._IDNTptr->quoted |= 2; // set dirty bit
+      if (destination.type==_IDNT)
+	caseval_cache_invalidate(destination._IDNTptr->id_name);
       gen valeur;
       if (!contextptr && in_place && destination.type==_IDNT && destination._IDNTptr->localvalue && !destination._IDNTptr->localvalue->empty() && local_eval(contextptr) )
 	valeur=do_local_eval(*destination._IDNTptr,eval_level(contextptr),false);
@@ -3888,14 +3892,9 @@ namespace giac {
 	  return sto(m,destination,in_place,contextptr);
 	}
       } // valeur.type==_MAP
-      vecteur * vptr=0;
-      vecteur v;
-      if (in_place)
-	vptr=valeur._VECTptr;
-      else {
-	v=*valeur._VECTptr;
-	vptr=&v;
-      }
+      // store in valeur itself if it is not shared, otherwise in a copy
+      bool own=in_place || valeur.ref_count()==1;
+      vecteur * vptr=valeur._VECTptr;
       bool indicedeuxpoints=indice.is_symb_of_sommet(*at_deuxpoints);
       if ( (indice.is_symb_of_sommet(*at_interval) || indicedeuxpoints)&& indice._SYMBptr->feuille.type==_VECT && indice._SYMBptr->feuille._VECTptr->size()==2){
 	gen deb=indice._SYMBptr->feuille._VECTptr->front();
@@ -3908,7 +3907,11 @@ namespace giac {
 	  return gendimerr();
 	if (a.type==_VECT && a._VECTptr->size()!=fin.val-deb.val+1)
 	  return gendimerr(contextptr);
-	int is=int(in_place?vptr->size():v.size());
+	if (!own){
+	  valeur=gen(*vptr,valeur.subtype);
+	  vptr=valeur._VECTptr;
+	}
+	int is=int(vptr->size());
 	for (;is<=fin.val;++is){
 	  vptr->push_back(zero);
 	}
@@ -3922,13 +3925,17 @@ namespace giac {
 	}
 	if (in_place)
 	  return valeur; // string2gen("Done",false);
-	return sto(gen(v,valeur.subtype),destination,in_place,contextptr);
+	return sto(valeur,destination,in_place,contextptr);
       }
       if (indice.type!=_VECT){
 	if (indice.type==_INT_ && indice.val<0)
 	  indice += int(vptr->size());
 	if (indice.type!=_INT_ || indice.val<0 || indice.val>=LIST_SIZE_LIMIT)
 	  return gentypeerr(gettext("Bad index (in sto) ")+indice.print(contextptr));
+	if (!own){
+	  valeur=gen(*vptr,valeur.subtype);
+	  vptr=valeur._VECTptr;
+	}
 	// check size
 	int is=int(vptr->size());
 	for (;is<=indice.val;++is){
@@ -3938,10 +3945,9 @@ namespace giac {
 	(*vptr)[indice.val]=a;
 	if (in_place)
 	  return valeur; // string2gen("Done",false);
-	return sto(gen(v,valeur.subtype),destination,in_place,contextptr);
+	return sto(valeur,destination,in_place,contextptr);
       }
       // here indice is of type _VECT, we store inside a matrix
-      vecteur empile;
       iterateur it=indice._VECTptr->begin(),itend=indice._VECTptr->end();
       if (itend-it==2){
 	gen i2=*(it+1);
@@ -3959,6 +3965,10 @@ namespace giac {
 	    return gendimerr(contextptr);
 	  if (!ckmatrix(*vptr))
 	    return gendimerr(contextptr);
+	  if (!own){
+	    valeur=gen(*vptr,valeur.subtype);
+	    vptr=valeur._VECTptr;
+	  }
 	  gen add=zero*vptr->front();
 	  int is=int(vptr->size());
 	  int cols=int(vptr->front()._VECTptr->size());
@@ -3966,8 +3976,10 @@ namespace giac {
 	    vptr->push_back(add);
 	  }
 	  if (!in_place){
-	    for (int i=deb.val;i<=fin.val;++i)
-	      (*vptr)[i]=*(*vptr)[i]._VECTptr;
+	    for (int i=deb.val;i<=fin.val;++i){
+	      if ((*vptr)[i].ref_count()!=1)
+		(*vptr)[i]=*(*vptr)[i]._VECTptr;
+	    }
 	  }
 	  bool i2deuxpoints=i2.is_symb_of_sommet(*at_deuxpoints);
 	  if ( (i2.is_symb_of_sommet(*at_interval) || i2deuxpoints) && i2._SYMBptr->feuille.type==_VECT && i2._SYMBptr->feuille._VECTptr->size()==2){
@@ -3993,7 +4005,7 @@ namespace giac {
 	      }
 	      if (in_place)
 		return valeur; // string2gen("Done",false);
-	      return sto(gen(v,valeur.subtype),destination,in_place,contextptr);
+	      return sto(valeur,destination,in_place,contextptr);
 	    }
 	    if (fin2.val-deb2.val!=fin.val-deb.val)
 	      return gendimerr(contextptr);	      
@@ -4022,7 +4034,7 @@ namespace giac {
 	  }
 	  if (in_place)
 	    return valeur; // string2gen("Done",false);
-	  return sto(gen(v,valeur.subtype),destination,in_place,contextptr);
+	  return sto(valeur,destination,in_place,contextptr);
 	} // end first value interval
 	if (it->type==_INT_ && it->val<0) it->val += vptr->size();
 	if (it->type!=_INT_ || it->val<0)
@@ -4032,7 +4044,11 @@ namespace giac {
 	if ( (i2.is_symb_of_sommet(*at_interval) || i2deuxpoints) && i2._SYMBptr->feuille.type==_VECT && i2._SYMBptr->feuille._VECTptr->size()==2){
 	  if (!ckmatrix(*vptr))
 	    return gendimerr(contextptr);
-	  if (!in_place)
+	  if (!own){
+	    valeur=gen(*vptr,valeur.subtype);
+	    vptr=valeur._VECTptr;
+	  }
+	  if (!in_place && (*vptr)[i1].ref_count()!=1)
 	    (*vptr)[i1]=*(*vptr)[i1]._VECTptr;
 	  gen deb2=i2._SYMBptr->feuille._VECTptr->front();
 	  gen fin2=i2._SYMBptr->feuille._VECTptr->back()+(i2deuxpoints?minus_one:zero);
@@ -4052,55 +4068,40 @@ namespace giac {
 	  }
 	  if (in_place)
 	    return valeur; // string2gen("Done",false);
-	  return sto(gen(v,valeur.subtype),destination,in_place,contextptr);	  
+	  return sto(valeur,destination,in_place,contextptr);	  
 	}
       } // end itend-it==2
+      if (!in_place){
+	// copy on write along the path, stored vectors have subtype 0
+	if (!own)
+	  valeur=gen(*vptr,0);
+	valeur.subtype=0;
+	vptr=valeur._VECTptr;
+      }
       for (;;){
 	if (it->type!=_INT_)
 	  return gentypeerr(gettext("Bad index (in sto) ")+indice.print(contextptr));
-	if (!in_place)
-	  empile.push_back(v);
-	gen tmp;
-	if (in_place){
-	  if (it->val<0) it->val += (int)(vptr->size());
-	  if (it->val<0 || it->val>= (int)(vptr->size()) )
-	    return gendimerr(contextptr);
-	  tmp=(*vptr)[it->val];
-	}
-	else {
-	  if (it->val<0) it->val += (int)(v.size());
-	  if ( it->val<0 || it->val>= (int)(v.size()) )
-	    return gendimerr(contextptr);
-	  tmp=v[it->val];	  
-	}
+	if (it->val<0) it->val += (int)(vptr->size());
+	if (it->val<0 || it->val>= (int)(vptr->size()) )
+	  return gendimerr(contextptr);
+	gen & tmp=(*vptr)[it->val];
 	++it;
 	if (it==itend)
 	  break;
 	if (tmp.type!=_VECT)
 	  return gentypeerr(gettext("Bad index (in sto) ")+indice.print(contextptr));
-	if (in_place)
-	  vptr= tmp._VECTptr;
-	else
-	  v=*tmp._VECTptr;
+	if (!in_place){
+	  if (tmp.ref_count()!=1)
+	    tmp=gen(*tmp._VECTptr,0);
+	  tmp.subtype=0;
+	}
+	vptr=tmp._VECTptr;
       }
       --itend;
-      if (in_place){
-	(*vptr)[itend->val]=a;
+      (*vptr)[itend->val]=a;
+      if (in_place)
 	return valeur; // string2gen("Done",false);
-      }
-      v[itend->val]=a;
-      vecteur oldv;
-      it=indice._VECTptr->begin();
-      for (;;){
-	if (itend==it)
-	  break;
-	--itend;
-	empile.pop_back();
-	oldv=*(empile.back()._VECTptr);
-	oldv[itend->val]=v;
-	v=oldv;
-      }
-      return sto(v,destination,in_place,contextptr);
+      return sto(valeur,destination,in_place,contextptr);
     }
     if (b.type==_FUNC){
       if (b==at_of || b==at_index){ // shortcut for python_compat(0 or 1): of:=1 or 0
@@ -2975,7 +2975,7 @@ namespace giac {
     if (&a==&res){ // in-place addition
       vecteur::iterator ita=res.begin(), itaend=res.end();
       for (;(ita!=itaend)&&(itb!=itbend);++ita,++itb){
-	*ita=*ita+*itb;
+	operator_plus_eq(*ita,*itb,context0);
       }
       for (;itb!=itbend;++itb)
 	res.push_back(*itb);
@@ -4008,6 +4008,7 @@ namespace giac {
   };
 
   void * do_thread_mmult_double(void * ptr_){
+    trace_scope scope("thread_mmult_double");
     thread_mmult_double_t * ptr=(thread_mmult_double_t *) ptr_;
     const matrix_double & a=*ptr->a;
     const matrix_double & btran=*ptr->btran;
@@ -4046,7 +4047,7 @@ namespace giac {
 #ifdef HAVE_LIBPTHREAD
     int nthreads=threads_allowed?threads:1;
     if (nthreads>1){
-      pthread_t tab[nthreads];
+      thread_task tab[nthreads];
       thread_mmult_double_t multdparam[nthreads];
       for (int j=0;j<nthreads;++j){
 	thread_mmult_double_t tmp={&A,&Btran,&C,0,0,n,rescols,Ar0,Br0,Ac0,Bc0,c0,c1,add};
@@ -4061,14 +4062,14 @@ namespace giac {
 	multdparam[j].kend=k;
 	bool res=true;
 	if (j<nthreads-1)
-	  res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_mmult_double,(void *) &multdparam[j]);
+	  res=thread_task_create(&tab[j],do_thread_mmult_double,(void *) &multdparam[j]);
 	if (res)
 	  do_thread_mmult_double((void *)&multdparam[j]);
       }
       for (int j=0;j<nthreads;++j){
 	void * ptr=(void *)&nthreads; // non-zero initialisation
 	if (j<nthreads-1)
-	  pthread_join(tab[j],&ptr);
+	  thread_task_join(tab[j],&ptr);
       }
       return ;
     } // end nthreads
@@ -4511,6 +4512,7 @@ namespace giac {
   };
 
   void * thread_mmult_mod(void * ptr_){
+    trace_scope scope("thread_mmult_mod");
     thread_mmult_mod_t * ptr = (thread_mmult_mod_t *) ptr_;
     vecteur2vectvector_int(*ptr->a,ptr->p,*ptr->ai); 
     vecteur2vectvector_int(*ptr->btran,ptr->p,*ptr->btrani);
@@ -4606,7 +4608,7 @@ namespace giac {
 #ifdef HAVE_LIBPTHREAD
     int nthreads=threads_allowed?threads:1;
     if (nthreads>1){
-      pthread_t tab[nthreads-1];
+      thread_task tab[nthreads-1];
 #ifdef __clang__
       vector< vector<int> > *tabai = (vector< vector<int> > *)alloca(nthreads*sizeof(vector< vector<int> >)),
 	*tabbtrani = (vector< vector<int> > *)alloca(nthreads*sizeof(vector< vector<int> >)),
@@ -4625,14 +4627,14 @@ namespace giac {
 	  multmodparam[j].p=p.val;
 	  bool res=true;
 	  if (j<nthreads-1)
-	    res=pthread_create(&tab[j],(pthread_attr_t *) NULL,thread_mmult_mod,(void *) &multmodparam[j]);
+	    res=thread_task_create(&tab[j],thread_mmult_mod,(void *) &multmodparam[j]);
 	  if (res)
 	    thread_mmult_mod((void *)&multmodparam[j]);
 	}
 	for (j=0;j<nthreads;++j){
 	  void * ptr=(void *)&nthreads; // non-zero initialisation
 	  if (j<nthreads-1)
-	    pthread_join(tab[j],&ptr);
+	    thread_task_join(tab[j],&ptr);
 	  if (ptr){
 	    if (i==0)
 	      vectvector_int2vecteur(*multmodparam[j].ci,c);
@@ -4680,7 +4682,7 @@ namespace giac {
 #ifdef HAVE_LIBPTHREAD
     int nthreads=threads_allowed?threads:1;
     if (nthreads>1){
-      pthread_t tab[nthreads-1];
+      thread_task tab[nthreads-1];
       thread_mmult_double_t multdparam[nthreads];
       for (int j=0;j<nthreads;++j){
 	thread_mmult_double_t tmp={&ad,&btrand,&c,0,0,n,rescols,0,0,0,0,0,0,true};
@@ -4695,14 +4697,14 @@ namespace giac {
 	multdparam[j].kend=k;
 	bool res=true;
 	if (j<nthreads-1)
-	  res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_mmult_double,(void *) &multdparam[j]);
+	  res=thread_task_create(&tab[j],do_thread_mmult_double,(void *) &multdparam[j]);
 	if (res)
 	  do_thread_mmult_double((void *)&multdparam[j]);
       }
       for (int j=0;j<nthreads;++j){
 	void * ptr=(void *)&nthreads; // non-zero initialisation
 	if (j<nthreads-1)
-	  pthread_join(tab[j],&ptr);
+	  thread_task_join(tab[j],&ptr);
       }
       return ;
     } // end nthreads
@@ -5040,6 +5042,8 @@ namespace giac {
   bool mmultck(const matrice & a, const matrice & b,matrice & res){
     if (mcols(a)!=mrows(b))
       return false; 
+    if (!memory_check(double(mrows(a))*mcols(b)*sizeof(gen)))
+      return false;
     mmult(a,b,res);
     return true;
   }
@@ -5561,6 +5565,7 @@ namespace giac {
   };
 
   void * do_thread_double_linv(void * ptr){
+    trace_scope scope("thread_double_linv");
     thread_double_lu2inv_t * p = (thread_double_lu2inv_t *) ptr;
     matrix_double & m =*p->m;
     int i=p->i;
@@ -5658,6 +5663,7 @@ namespace giac {
     // n^3/2 operations
     // the first i loop is unrolling
   void * do_thread_double_lu2inv(void * ptr){
+    trace_scope scope("thread_double_lu2inv");
     thread_double_lu2inv_t * p = (thread_double_lu2inv_t *) ptr;
     matrix_double & m =*p->m;
     int i=p->i;
@@ -5823,7 +5829,7 @@ namespace giac {
 #ifdef HAVE_LIBPTHREAD      
     int nthreads=threads_allowed?threads:1;
     if (nthreads>1 && n>40){
-      pthread_t tab[nthreads-1];
+      thread_task tab[nthreads-1];
       thread_double_lu2inv_t param[nthreads];
       int rstep=int(std::ceil(n/double(nthreads))),rstart=0,rend;
       for (int j=0;j<nthreads;++j){
@@ -5834,14 +5840,14 @@ namespace giac {
 	rstart=rend;
 	bool res=true;
 	if (j<nthreads-1)
-	  res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_double_linv,(void *) &param[j]);
+	  res=thread_task_create(&tab[j],do_thread_double_linv,(void *) &param[j]);
 	if (res)
 	  do_thread_double_linv((void *)&param[j]);
       }
       for (int j=0;j<nthreads;++j){
 	void * ptr=(void *)&nthreads; // non-zero initialisation
 	if (j<nthreads-1)
-	  pthread_join(tab[j],&ptr);
+	  thread_task_join(tab[j],&ptr);
       }
       done=true;
     }
@@ -5855,7 +5861,7 @@ namespace giac {
     done=false;
 #ifdef HAVE_LIBPTHREAD      
     if (nthreads>1 && n>40){
-      pthread_t tab[nthreads-1];
+      thread_task tab[nthreads-1];
       thread_double_lu2inv_t param[nthreads];
       int rstep=int(std::ceil(n/double(nthreads))),rstart=0,rend;
       for (int j=0;j<nthreads;++j){
@@ -5866,14 +5872,14 @@ namespace giac {
 	rstart=rend;
 	bool res=true;
 	if (j<nthreads-1)
-	  res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_double_lu2inv,(void *) &param[j]);
+	  res=thread_task_create(&tab[j],do_thread_double_lu2inv,(void *) &param[j]);
 	if (res)
 	  do_thread_double_lu2inv((void *)&param[j]);
       }
       for (int j=0;j<nthreads;++j){
 	void * ptr=(void *)&nthreads; // non-zero initialisation
 	if (j<nthreads-1)
-	  pthread_join(tab[j],&ptr);
+	  thread_task_join(tab[j],&ptr);
       }
       done=true;
     }
@@ -6633,6 +6639,7 @@ namespace giac {
   };
 
   void * thread_modrref(void * ptr_){
+    trace_scope scope("thread_modrref");
     thread_modrref_t * ptr = (thread_modrref_t *)(ptr_);
     ptr->success=in_modrref(*ptr->aptr, *ptr->Nptr,*ptr->resptr, *ptr->pivotsptr, ptr->det,ptr->l, ptr->lmax, ptr->c,ptr->cmax,ptr->fullreduction,ptr->dont_swap_below,ptr->Modulo,ptr->carac,ptr->rref_or_det_or_lu,ptr->mult_by_det_mod_p,ptr->inverting,ptr->no_initial_mod,ptr->workptr);
     return ptr;
@@ -6739,7 +6746,7 @@ namespace giac {
 #ifdef HAVE_LIBPTHREAD
     // initialize/alloc nthreads-1 copies of N, res, pivots
     int nthreads=threads_allowed?threads:1;
-    pthread_t tab[nthreads-1];
+    thread_task tab[nthreads-1];
 #ifdef __clang__
     vector< vector<int> > *Nptr = (vector< vector<int> > *)alloca((nthreads-1)*sizeof(vector< vector<int> >));
     matrice *resptr = (matrice *)alloca((nthreads-1)*sizeof(matrice));
@@ -6805,7 +6812,7 @@ namespace giac {
 	  modrrefparam[j].inverting=false;
 	  modrrefparam[j].no_initial_mod=true;
 	  modrrefparam[j].mult_by_det_mod_p=1;
-	  bool res=pthread_create(&tab[j],(pthread_attr_t *) NULL,thread_modrref,(void *) &modrrefparam[j]);
+	  bool res=thread_task_create(&tab[j],thread_modrref,(void *) &modrrefparam[j]);
 	  if (res)
 	    thread_modrref((void *)&modrrefparam[j]);	    
 	}
@@ -6837,7 +6844,7 @@ namespace giac {
 	// get back launched mod det
 	for (int j=0;j<nthreads-1;++j){
 	  void * ptr;
-	  pthread_join(tab[j],&ptr);
+	  thread_task_join(tab[j],&ptr);
 	  if (ptr && modrrefparam[j].success){
 	    gen tmpp=modrrefparam[j].Modulo;
 	    gen tmpdet_mod_p=smod(modrrefparam[j].det*invmod(factdet,tmpp),tmpp);
@@ -6931,7 +6938,7 @@ namespace giac {
 	  modrrefparam[j].no_initial_mod=true;
 	  gen tmp=(inverting || rref_or_det_or_lu==0)?det:1;
 	  modrrefparam[j].mult_by_det_mod_p=tmp;
-	  bool res=pthread_create(&tab[j],(pthread_attr_t *) NULL,thread_modrref,(void *) &modrrefparam[j]);
+	  bool res=thread_task_create(&tab[j],thread_modrref,(void *) &modrrefparam[j]);
 	  if (res)
 	    thread_modrref((void *)&modrrefparam[j]);	    
 	}
@@ -6948,7 +6955,7 @@ namespace giac {
 	// get back launched mod det
 	for (int j=0;j<nthreads-1;++j){
 	  void * ptr;
-	  pthread_join(tab[j],&ptr);
+	  thread_task_join(tab[j],&ptr);
 	  if (ptr && modrrefparam[j].success){
 	    if (rref_or_det_or_lu==3 && is_zero(det_mod_p,contextptr)){
 	      continue;
@@ -7957,6 +7964,8 @@ namespace giac {
 
   bool vecteur2vectvector_int(const vecteur & v,int modulo,vector< vector<int> > & res){
     vecteur::const_iterator it=v.begin(),itend=v.end();
+    if (it!=itend && it->type==_VECT && !memory_check(double(itend-it)*it->_VECTptr->size()*sizeof(int)))
+      return false;
     res.resize(itend-it);
     for (int i=0;it!=itend;++i,++it){
       if (it->type!=_VECT)
@@ -8684,6 +8693,7 @@ namespace giac {
   };
 
   void * do_thread_smallmodrref_upper(void * ptr_){
+    trace_scope scope("thread_smallmodrref_upper");
     smallmodrref_upper_t * ptr=(smallmodrref_upper_t *)ptr_;
     in_thread_smallmodrref_upper(*ptr->N,ptr->l,ptr->lpivot,ptr->lmax,ptr->c,ptr->cmax,ptr->modulo,1);
     return ptr;
@@ -8697,7 +8707,7 @@ namespace giac {
   void in_thread_smallmodrref_upper(vector< vector<int> > & N,int l,int lpivot,int lmax,int c,int cmax,int modulo,int parallel){
 #ifdef HAVE_LIBPTHREAD
     if (parallel!=1) {
-      pthread_t tab[parallel];
+      thread_task tab[parallel];
       smallmodrref_upper_t upperparam[parallel];
       int kstep=int(std::ceil((cmax-c)/double(parallel))),ccur=c;
       for (int j=0;j<parallel;++j){
@@ -8709,14 +8719,14 @@ namespace giac {
       for (int j=0;j<parallel;++j){
 	bool res=true;
 	if (j<parallel-1)
-	  res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_smallmodrref_upper,(void *) &upperparam[j]);
+	  res=thread_task_create(&tab[j],do_thread_smallmodrref_upper,(void *) &upperparam[j]);
 	if (res)
 	  do_thread_smallmodrref_upper((void *)&upperparam[j]);
       }
       for (int j=0;j<parallel;++j){
 	void * ptr=(void *)&parallel; // non-zero initialisation
 	if (j<parallel-1)
-	  pthread_join(tab[j],&ptr);
+	  thread_task_join(tab[j],&ptr);
       }
       return ;
     }
@@ -8938,12 +8948,14 @@ namespace giac {
   };
 
   void * do_thread_modular_reduction(void * ptr_){
+    trace_scope scope("thread_modular_reduction");
     thread_modular_reduction_t * ptr=(thread_modular_reduction_t *) ptr_;
     do_modular_reduction(*ptr->Nptr,ptr->l,ptr->pivotcol,ptr->pivotval,ptr->linit,ptr->lmax,ptr->c,ptr->effcmax,ptr->rref_or_det_or_lu,ptr->modulo);
     return ptr;
   }
     
   void * do_thread_lower_reduction(void * ptr_){
+    trace_scope scope("thread_lower_reduction");
     thread_modular_reduction_t * ptr=(thread_modular_reduction_t *) ptr_;
     if (ptr->l<ptr->lmax)
 	smallmodrref_lower(*ptr->Nptr,ptr->linit,ptr->l,ptr->lmax,ptr->c,ptr->effcmax,*ptr->pivotcols,ptr->modulo,ptr->debuginfo);
@@ -9171,7 +9183,7 @@ namespace giac {
 	makepositive(N,l,effl,c,cmax,modulo);
 #ifdef HAVE_LIBPTHREAD
 	if (nthreads>1 && double(lmax-effl)*(cmax-c)>1e5){
-	  pthread_t tab[64];
+	  thread_task tab[64];
 	  thread_modular_reduction_t redparam[64];
 	  if (nthreads>64) nthreads=64;
 	  for (int j=0;j<nthreads;++j){
@@ -9187,14 +9199,14 @@ namespace giac {
 	    redparam[j].lmax=k;
 	    bool res=true;
 	    if (j<nthreads-1)
-	      res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_lower_reduction,(void *) &redparam[j]);
+	      res=thread_task_create(&tab[j],do_thread_lower_reduction,(void *) &redparam[j]);
 	    if (res)
 	      do_thread_lower_reduction((void *)&redparam[j]);
 	  }
 	  for (int j=0;j<nthreads;++j){
 	    void * ptr=(void *)&nthreads; // non-zero initialisation
 	    if (j<nthreads-1)
-	      pthread_join(tab[j],&ptr);
+	      thread_task_join(tab[j],&ptr);
 	  }
 	  reduction_done=true;
 	}
@@ -9384,6 +9396,13 @@ namespace giac {
     }
 #endif
     for (;(l<lmax) && (c<cmax);){
+#ifdef TIMEOUT
+      control_c();
+#endif
+      if (ctrl_c || interrupted){
+	setsizeerr(gettext("Stopped by user interruption."));
+	break; // NO_STDEXCEPT
+      }
 #ifdef GIAC_DETBLOCK
       if (tryblock &&lmax-l>=3*det_blocksize && cmax-c>=3*det_blocksize && l % det_blocksize==0 && c % det_blocksize==0){
 	// try to invert block of size det_blocksize
@@ -9515,7 +9534,7 @@ namespace giac {
 	int effl=fullreduction?linit:l+1;
 #ifdef HAVE_LIBPTHREAD
 	if (nthreads>1 && double(lmax-effl)*(effcmax-c)>1e5){
-	  pthread_t tab[64];
+	  thread_task tab[64];
 	  thread_modular_reduction_t redparam[64];
 	  if (nthreads>64) nthreads=64;
 	  for (int j=0;j<nthreads;++j){
@@ -9531,14 +9550,14 @@ namespace giac {
 	    redparam[j].lmax=k;
 	    bool res=true;
 	    if (j<nthreads-1)
-	      res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_modular_reduction,(void *) &redparam[j]);
+	      res=thread_task_create(&tab[j],do_thread_modular_reduction,(void *) &redparam[j]);
 	    if (res)
 	      do_thread_modular_reduction((void *)&redparam[j]);
 	  }
 	  for (int j=0;j<nthreads;++j){
 	    void * ptr=(void *)&nthreads; // non-zero initialisation
 	    if (j<nthreads-1)
-	      pthread_join(tab[j],&ptr);
+	      thread_task_join(tab[j],&ptr);
 	  }
 	  do_reduction=false;
 	}
@@ -9750,6 +9769,13 @@ namespace giac {
     }
 #endif // GIAC_HAS_STO_38
     for (;(l<lmax) && (c<cmax);){
+#ifdef TIMEOUT
+      control_c();
+#endif
+      if (ctrl_c || interrupted){
+	setsizeerr(gettext("Stopped by user interruption."));
+	break; // NO_STDEXCEPT
+      }
       pivot=N[l][c];
       if (absdouble(pivot)<epspivot)
 	pivot=N[l][c]=0;
@@ -10017,6 +10043,11 @@ namespace giac {
     pivots.clear();
     pivots.reserve(cmax-c);
     for (;(l<lmax) && (c<cmax);){
+#ifdef TIMEOUT
+      control_c();
+#endif
+      if (ctrl_c || interrupted)
+	return false;
       if ( (!fullreduction) && (l==lmax-1) ){
 	det = smod(det*M[l][c],modulo);
 	break;
@@ -12619,6 +12650,7 @@ namespace giac {
   };
 
   void * do_thread_qr_givens_p(void * ptr_){
+    trace_scope scope("thread_qr_givens");
     thread_givens_p_t * ptr=(thread_givens_p_t *)ptr_;
     qr_givens_p(*ptr->Pptr,ptr->Pstart,ptr->Pend,ptr->cstart,ptr->n,ptr->lastcol,*ptr->coeffsptr);
     return ptr;
@@ -12748,7 +12780,7 @@ namespace giac {
 #ifdef HAVE_LIBPTHREAD
       int nthreads=threads_allowed?threads:1;
       if (nthreads>1){
-	pthread_t tab[nthreads];
+	thread_task tab[nthreads];
 	thread_givens_p_t multdparam[nthreads];
 	for (int j=0;j<nthreads;++j){
 	  thread_givens_p_t tmp={&P,0,0,cstart,n,lastcol,&coeffs};
@@ -12765,14 +12797,14 @@ namespace giac {
 	  multdparam[j].Pend=Pend;
 	  bool res=true;
 	  if (j<nthreads-1)
-	    res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_qr_givens_p,(void *) &multdparam[j]);
+	    res=thread_task_create(&tab[j],do_thread_qr_givens_p,(void *) &multdparam[j]);
 	  if (res)
 	    do_thread_qr_givens_p((void *)&multdparam[j]);
 	}
 	for (int j=0;j<nthreads;++j){
 	  void * ptr=(void *)&nthreads; // non-zero initialisation
 	  if (j<nthreads-1)
-	    pthread_join(tab[j],&ptr);
+	    thread_task_join(tab[j],&ptr);
 	}
 	done=true;
       } // end nthreads
@@ -13967,6 +13999,7 @@ namespace giac {
   };
 
   void * do_thread_mod_pcar(void * ptr_){
+    trace_scope scope("thread_mod_pcar");
     thread_mod_pcar_t * ptr=(thread_mod_pcar_t*) ptr_;
     ptr->retval=mod_pcar(*ptr->Nptr,ptr->modulo,ptr->krylov,*ptr->resptr,ptr->contextptr,ptr->compute_pmin,*ptr->ttempptr);
     return ptr_;
@@ -14186,7 +14219,7 @@ namespace giac {
     int nthreads=threads_allowed?threads:1;
     if (nthreads>1){
       // initialization
-      pthread_t tab[nthreads];
+      thread_task tab[nthreads];
       vector< vector< vector<int> > > Ntab(nthreads,N),ttemptab(nthreads,ttemp);
       vector< vector<int> > restab(nthreads,modpcar);
       thread_mod_pcar_t pcarparam[nthreads];
@@ -14207,14 +14240,14 @@ namespace giac {
           pcarparam[j].modulo=currentp.val;
           bool res=true;
           if (j<nthreads-1)
-            res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_thread_mod_pcar,(void *) &pcarparam[j]);
+            res=thread_task_create(&tab[j],do_thread_mod_pcar,(void *) &pcarparam[j]);
           if (res)
             do_thread_mod_pcar((void *)&pcarparam[j]);
         }
         for (int j=0;j<nthreads;++j){
           void * ptr=(void *)&nthreads; // non-zero initialisation
           if (j<nthreads-1)
-            pthread_join(tab[j],&ptr);
+            thread_task_join(tab[j],&ptr);
         }
         for (int j=0;j<nthreads;++j){
           if (!pcarparam[j].retval)
@@ -19574,6 +19607,7 @@ namespace giac {
   }
 
   void * do_hessenberg_p(void *ptr){
+    trace_scope scope("thread_hessenberg");
     thread_hessenberg_p_t * p=(thread_hessenberg_p_t *)(ptr);
     matrix_double & P = *p->P;
     vector<double> & oper = *p->oper;
@@ -19616,7 +19650,7 @@ namespace giac {
 #ifdef HAVE_LIBPTHREAD      
     int cend,nthreads=threads_allowed?threads:1;
     if (nthreads>1 && nH*oper.size()>1e6){
-      pthread_t tab[nthreads-1];
+      thread_task tab[nthreads-1];
       thread_hessenberg_p_t hessenbergparam[nthreads];
       cstep=int(std::ceil(cstep/double(nthreads)));
       for (int j=0;j<nthreads;++j){
@@ -19627,14 +19661,14 @@ namespace giac {
 	cstart=cend;
 	bool res=true;
 	if (j<nthreads-1)
-	  res=pthread_create(&tab[j],(pthread_attr_t *) NULL,do_hessenberg_p,(void *) &hessenbergparam[j]);
+	  res=thread_task_create(&tab[j],do_hessenberg_p,(void *) &hessenbergparam[j]);
 	if (res)
 	  do_hessenberg_p((void *)&hessenbergparam[j]);
       }
       for (int j=0;j<nthreads;++j){
 	void * ptr=(void *)&nthreads; // non-zero initialisation
 	if (j<nthreads-1)
-	  pthread_join(tab[j],&ptr);
+	  thread_task_join(tab[j],&ptr);
       }
       oper.clear();
       if (debug_infolevel>2)
@@ -954,12 +954,16 @@ AN	[0-9a-zA-Z_~ ?\200-\355\357-\376]
 	giac_yyerror(scanner,"Void string");
 #if !defined RTOS_THREADX && !defined NSPIRE && !defined FXCG && !defined GIAC_HAS_STO_38 && !defined NSPIRE_NEWLIB // && !defined NUMWORKS
       if (!builtin_lexer_functions_sorted){
-#ifndef STATIC_BUILTIN_LEXER_FUNCTIONS
-	sort(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),tri);
-#endif
+	// lookups go through the hash index, the table is sorted only
+	// when static tables are written
 	builtin_lexer_functions_sorted=true;
+	builtin_lexer_functions_index();
 	int nfunc=builtin_lexer_functions_number;
 	if (debug_infolevel==-2 || debug_infolevel==-4 || debug_infolevel==-5){
+#ifndef STATIC_BUILTIN_LEXER_FUNCTIONS
+	  sort(builtin_lexer_functions_begin(),builtin_lexer_functions_end(),tri);
+	  builtin_lexer_functions_index();
+#endif
 	  CERR << "Writing " << nfunc << " in static_lexer.h and static_extern.h "<< '\n';
 	  CERR << "Check at_FP->at_FRAC, at_IP->at_INT, at_lgamma->at_lower_incomplete_gamma, at_is_inside->at_est_dans, at_regroup->at_regrouper, at_ugamma->at_upper_incomplete_gamma, at_∡ -> at_polar_complex, at_LINEAR? -> at_IS_LINEAR" << '\n';
 	  /*
@@ -389,6 +389,35 @@ typedef longlong ref_count_t;
 typedef int ref_count_t;
 #endif
 
+// Reference counts of published objects (see publish_gen) have the
+// ref_count_shared bit set and are updated atomically, other objects are
+// owned by one thread and keep plain increments. -1 marks static objects.
+#if (defined x86_64 || defined __aarch64__) && (defined __GNUC__ || defined __clang__) && !defined GIAC_NO_ATOMIC_REFCOUNT
+#define GIAC_ATOMIC_REFCOUNT
+#endif
+// lock-free 64 bits __atomic builtins (counters shared by threads)
+#if (defined __GNUC__ || defined __clang__) && defined __GCC_ATOMIC_LLONG_LOCK_FREE && __GCC_ATOMIC_LLONG_LOCK_FREE==2
+#define GIAC_ATOMIC_BUILTINS
+#endif
+template<class T> inline T ref_count_shared_bit(){ return T(1) << (sizeof(T)*8-2); }
+template<class T> inline void ref_count_incr(volatile T * rc){
+#ifdef GIAC_ATOMIC_REFCOUNT
+  if (*rc & ref_count_shared_bit<T>()){
+    __atomic_fetch_add(rc,1,__ATOMIC_RELAXED);
+    return;
+  }
+#endif
+  ++*rc;
+}
+// true if the last reference was released
+template<class T> inline bool ref_count_decr(volatile T * rc){
+#ifdef GIAC_ATOMIC_REFCOUNT
+  if (*rc & ref_count_shared_bit<T>())
+    return __atomic_sub_fetch(rc,1,__ATOMIC_ACQ_REL)==ref_count_shared_bit<T>();
+#endif
+  return !--*rc;
+}
+
 #ifdef WINSTORE
 //tw  **NOTE** this is pulled out of winnt.h!!! I don't know why it is not found there.
 //             there is some sort of interaction in windows ARM builds... 
@@ -594,7 +594,7 @@ namespace giac {
     return 0;
   }
 
-  extern int threads;
+  extern GIAC_THREAD_LOCAL int threads;
 
   // conversion in parallel will not be much faster if T!=gen because
   // we must allocate memory for each gen
@@ -615,7 +615,7 @@ namespace giac {
     if (nthreads>1 
 	&& int(taille)>nthreads*1000
 	){
-      pthread_t tab[nthreads];
+      thread_task tab[nthreads];
       std::vector< convert_t<T,U> > arg(nthreads);
       if (coeff_apart){
 	convert_from<T,U>(it,itend,deg,jt,1); // convert first coefficients
@@ -630,14 +630,14 @@ namespace giac {
 	}
 	else {
 	  arg[i]=tmp;
-	  int res=pthread_create(&tab[i],(pthread_attr_t *) NULL,do_convert_from<T,U>,(void *) &arg[i]);
+	  int res=thread_task_create(&tab[i],do_convert_from<T,U>,(void *) &arg[i]);
 	  if (res) // thread not created
 	    convert_from<T,U>(tmp.it,tmp.itend,deg,tmp.jt,tmp.mode);
 	}
       }
       for (int i=0;i<nthreads-1;++i){
 	void * ptr;
-	pthread_join(tab[i],&ptr);
+	thread_task_join(tab[i],&ptr);
       }
       return;
     } // end if (nthreads>1)
@@ -101,6 +101,111 @@ namespace giac {
   extern six_int * tab24;
   size_t freeslotmem(); // non 0 if ALLOCSMALL is defined
 
+  // Memory budget of the current evaluation (eval_token::maxmem, see
+  // global.h): the reference objects allocated by the evaluating thread,
+  // their imvector storage (vecteur, vector.h), indices (index.h),
+  // polynomial coefficients (poly.h) and GMP integer limbs are charged to
+  // it, frees are refunded
+#if !defined KHICAS && !defined SDL_KHICAS && !defined NSPIRE && !defined FXCG && !defined EMCC && !defined EMCC2 && !defined HAVE_LIBGC && !defined GIAC_HAS_STO_38
+#define GIAC_MEMORY_BUDGET
+  // memory_budget_on is set by the first eval_token::set_memory_limit,
+  // memory_charge_ and memory_release_ are declared in vector.h
+  inline void memory_charge(size_t bytes){ if (memory_budget_on) memory_charge_(bytes); }
+  inline void memory_release(size_t bytes){ if (memory_budget_on) memory_release_(bytes); }
+#else
+  inline void memory_charge(size_t bytes){}
+  inline void memory_release(size_t bytes){}
+#endif
+
+  // Performance counters, off by default (perf_stats in global.h). They
+  // are process wide, not per context: concurrent evaluations and their
+  // helper threads add to the same counters (see perf_begin)
+  enum perf_counter_t {
+    PERF_ALLOC=0, // + gen type (_ZINT, _CPLX, _VECT, _SYMB): objects allocated
+    PERF_MULT_SMALL=_SYMB+1, // polynomial products by number of term pairs
+    PERF_MULT_MEDIUM, // >= 1e3
+    PERF_MULT_LARGE, // >= 1e6
+    PERF_GCD_HEU, // multivariate gcd calls by algorithm
+    PERF_GCD_MODULAR,
+    PERF_GCD_EZ,
+    PERF_GCD_PSR,
+    PERF_GCD_CACHE_HITS, // gcd cache (gcd_cache_scope in threaded.h)
+    PERF_GCD_CACHE_MISSES,
+    PERF_F4_MATRICES, // F4 Macaulay matrices, sum and max of their dimensions
+    PERF_F4_ROWS,
+    PERF_F4_COLS,
+    PERF_F4_MAXROWS,
+    PERF_F4_MAXCOLS,
+    PERF_PRIMES, // primes used by modular gbasis and gcd
+    PERF_TIME_PARSE, // time per phase in microseconds
+    PERF_TIME_EVAL,
+    PERF_TIME_MULT,
+    PERF_TIME_GCD,
+    PERF_TIME_FACTOR,
+    PERF_TIME_GBASIS,
+    PERF_N
+  };
+  extern bool perf_on;
+  extern longlong perf_counters[PERF_N];
+  // without GIAC_ATOMIC_BUILTINS (first.h) the counters are plain
+  // increments and concurrent updates may be lost
+  inline void perf_add(int c,longlong n=1){
+    if (perf_on)
+#ifdef GIAC_ATOMIC_BUILTINS
+      __atomic_add_fetch(&perf_counters[c],n,__ATOMIC_RELAXED);
+#else
+      perf_counters[c] += n;
+#endif
+  }
+  void perf_max(int c,longlong n);
+  // add the time elapsed in the scope to c, a timer nested in a timer of
+  // the same counter on the same thread does nothing
+  class perf_timer {
+    int c;
+    double t0;
+  public:
+    perf_timer(int c_);
+    ~perf_timer();
+    bool outer() const { return c>=0; } // counting and not nested
+  };
+  // count a polynomial product of pairs term pairs by size class, product
+  // kernels call it when their PERF_TIME_MULT timer is outer so that a
+  // product is counted once whatever kernels it dispatches to
+  inline void perf_mult(double pairs){
+    perf_add(pairs<1e3?PERF_MULT_SMALL:(pairs<1e6?PERF_MULT_MEDIUM:PERF_MULT_LARGE));
+  }
+
+  // trace_scope (timeline of internal phases) is declared in threaded.h
+
+  // Thread-local pool allocator for the small reference objects on 64 bits
+  // desktop builds (see gen.cc), disable with -DGIAC_NO_SLAB_ALLOC
+#if (defined x86_64 || defined __aarch64__) && (defined __linux__ || defined __APPLE__) && defined HAVE_LIBPTHREAD && defined CPP11 && !defined HAVE_LIBGC && !defined EMCC && !defined EMCC2 && !defined GIAC_NO_SLAB_ALLOC
+#define GIAC_SLAB_ALLOC
+#endif
+#ifdef GIAC_SLAB_ALLOC
+  // t is the gen type of the object (used by evaluation arenas)
+  void * slab_alloc(size_t size,int t);
+  void slab_free(void * ptr,size_t size);
+#define GIAC_SLAB_NEW(t) \
+  static void * operator new(size_t size){ return slab_alloc(size,t); } \
+  static void operator delete(void * ptr,size_t size){ slab_free(ptr,size); }
+#else
+#ifdef GIAC_MEMORY_BUDGET
+#define GIAC_SLAB_NEW(t) \
+  static void * operator new(size_t size){ memory_charge(size); perf_add(PERF_ALLOC+t); return ::operator new(size); } \
+  static void operator delete(void * ptr,size_t size){ memory_release(size); ::operator delete(ptr); }
+#else
+#define GIAC_SLAB_NEW(t)
+#endif
+#endif
+  struct slab_statistics {
+    size_t pools,chunks,bytes; // pools are per thread, chunks of 64K
+    ulonglong allocated,freed,remote_freed; // remote: freed by another thread
+  };
+  // all 0 if GIAC_SLAB_ALLOC is not defined, counters are approximate
+  // while other threads are allocating
+  void slab_stats(slab_statistics & s);
+
   int sprint_int(char * s,int r);
   void sprint_double(char * s,double d);
 
@@ -247,6 +352,7 @@ namespace giac {
     ref_mpz_t(size_t nbits):ref_count(1) {mpz_init2(z,int(nbits));}
     ref_mpz_t(const mpz_t & Z): ref_count(1) { mpz_init_set(z,Z); }
     ~ref_mpz_t() { mpz_clear(z); }
+    GIAC_SLAB_NEW(_ZINT)
   };
   class identificateur;
   struct ref_identificateur; // in identificateur.h
@@ -610,6 +716,12 @@ namespace giac {
   };
 
   void delete_ptr(signed char subtype,short int type_save,ref_mpz_t * ptr_save);
+  // mark g and its subobjects as shared between threads: their reference
+  // counts become atomic. Call it from the thread that owns g before
+  // handing g to other threads, published objects are never modified in
+  // place since their ref_count() is not 1 anymore.
+  void publish_gen(const gen & g);
+  bool is_published(const gen & g);
   // FIXME: for little-endian check if type/unused/subtype order is correct!
   class gen {
   public:
@@ -758,6 +870,10 @@ namespace giac {
     gen(const gen & a,const gen & b);
     gen(const std::complex<double> & c);
     gen(const gen & e);
+#ifdef CPP11
+    // move: e becomes 0, no reference count update
+    gen(gen && e) noexcept { move_from(e); }
+#endif
     gen (const identificateur & s);
     gen (ref_identificateur * sptr);
     gen (const vecteur & v,short int s=0);
@@ -795,7 +911,7 @@ namespace giac {
 	   ){
 	// optimization for ref_count access must be checked in multi-thread
 	ref_count_t * rc=(ref_count_t *) & ref_count();
-	if (*rc!=-1 && !--*rc){
+	if (*rc!=-1 && ref_count_decr(rc)){
 	  delete_gen();
 	}
       }
@@ -830,7 +946,7 @@ namespace giac {
 	  && (al >> 16)	){
 	ref_count_t * rc=(ref_count_t *)& ((ref_mpz_t *)(al>>16) )->ref_count;
 	if (*rc!=-1)
-	  ++(*rc); // increase ref count
+	  ref_count_incr(rc); // increase ref count
       }
       // Now we delete the target 
       if ( (tl &0x1f)>_DOUBLE_)
@@ -851,7 +967,7 @@ namespace giac {
 	  ){
 	ref_count_t * rc=(ref_count_t *)&a.ref_count();
 	if (*rc!=-1)
-	  ++(*rc); // increase ref count
+	  ref_count_incr(rc); // increase ref count
       }
       // Copy before deleting because the target might be embedded in a
       // with a ptr_val.ref_count of a equals to 1
@@ -873,6 +989,35 @@ namespace giac {
       return *this;
     }
 #endif // SMARTPTR64
+#ifdef CPP11
+    gen & operator = (gen && a) noexcept {
+      if (this!=&a){
+	gen tmp; // releases the previous value
+	tmp.move_from(*this);
+	move_from(a);
+      }
+      return *this;
+    }
+    // raw copy of e, then e=0
+    void move_from(gen & e) noexcept {
+#ifdef SMARTPTR64
+      * ((ulonglong *) this) = * ((ulonglong *) &e);
+      * ((ulonglong *) &e) = 0;
+#else
+#ifdef DOUBLEVAL
+      _DOUBLE_val = e._DOUBLE_val;
+#else
+      * ((ulonglong *) this) = *((ulonglong * ) &e);
+#endif
+      __ZINTptr=e.__ZINTptr;
+      type=e.type;
+      subtype=e.subtype;
+      e.type=_INT_;
+      e.subtype=0;
+      e.val=0;
+#endif
+    }
+#endif // CPP11
     int to_int() const ;
     double to_double(const context * contextptr) const;
     bool is_vector_of_size(size_t n) const;
@@ -1006,6 +1151,7 @@ namespace giac {
     ref_vecteur(unsigned s,const gen & g):ref_count(1),v(s,g) {}
     ref_vecteur(const_iterateur it,const_iterateur itend):ref_count(1),v(it,itend) {}
     ref_vecteur(const vecteur & w):ref_count(1),v(w) {}
+    GIAC_SLAB_NEW(_VECT)
   };
 
 
@@ -1054,6 +1200,7 @@ namespace giac {
     ref_complex(const std::complex<double> & c):ref_count(1),display(0),re(real(c)),im(imag(c)) {}
     ref_complex(const gen & R,const gen & I):ref_count(1),display(0),re(R),im(I) {}
     ref_complex(const gen & R,const gen & I,int display_mode):ref_count(1),display(display_mode),re(R),im(I) {}
+    GIAC_SLAB_NEW(_CPLX)
   };
   struct ref_modulo {
     volatile ref_count_t ref_count;
@@ -1112,6 +1259,10 @@ namespace giac {
   inline gen & operator -= (gen & a,const gen & b){ 
     return operator_minus_eq(a,b,context0);
   }
+  gen & operator_times_eq (gen & a,const gen & b,GIAC_CONTEXT);
+  inline gen & operator *= (gen & a,const gen & b){ 
+    return operator_times_eq(a,b,context0);
+  }
   gen operator_minus (const gen & a,const gen & b,GIAC_CONTEXT);
   gen operator - (const gen & a,const gen & b);
   gen operator - (const gen & a);
@@ -1622,16 +1773,30 @@ namespace giac {
     int size() const;
   };
 
+  // symbolic nodes in the hash-consing table carry their exact structural
+  // hash (see gen.cc), comparisons read it without lock
+#if (defined x86_64 || defined __aarch64__) && defined CPP11 && !defined GIAC_NO_HASHCONS
+#define GIAC_HASHCONS
+#endif
   struct ref_symbolic {
     volatile ref_count_t ref_count;
     symbolic s;
+#ifdef GIAC_HASHCONS
+    unsigned hash; // 0 if unknown, set while the node is in the table
+    ref_symbolic(const symbolic & S):ref_count(1),s(S),hash(0) {}
+#else
     ref_symbolic(const symbolic & S):ref_count(1),s(S) {}
+#endif
+    GIAC_SLAB_NEW(_SYMB)
   };
 #ifdef SMARTPTR64
   struct alias_ref_symbolic {
     ref_count_t ref_count;
     unary_function_eval * sommet;
     ulonglong feuille;
+#ifdef GIAC_HASHCONS
+    unsigned hash;
+#endif
   };
 #else
   struct alias_ref_symbolic {
@@ -1644,6 +1809,9 @@ namespace giac {
     longlong value;
 #else
     long value ; 
+#endif
+#ifdef GIAC_HASHCONS
+    unsigned hash;
 #endif
   };
 #endif
@@ -1823,6 +1991,69 @@ namespace giac {
 
   extern "C" const char * caseval(const char *);
   extern "C" const char * nws_caseval(const char * s);
+  // drop caseval cached results depending on name (all if name==0)
+  void caseval_cache_invalidate(const char * name);
+  // parsed expressions cache, maximal number of entries (0 disables)
+  void parse_cache_size(size_t n);
+  std::string parse_cache_stats();
+  // hash-consing: returns g where identical symbolic subtrees are one
+  // shared node carrying its structural hash while it is in the table, equality
+  // tests between such nodes return at once. Subtrees containing lists or
+  // strings are not shared (they may be modified in place by =<). The
+  // result is published. The least recently used nodes are evicted when
+  // the table is full.
+  gen hashcons(const gen & g);
+  // true if a and b are shared symbolic nodes with different structural
+  // hashes (hence a!=b), false if unknown
+  bool hashcons_differ(const gen & a,const gen & b);
+  // hash-cons the output of the parser (off by default)
+  void hashcons_parsed(bool on);
+  // maximal number of shared nodes (default 262144)
+  void hashcons_size(size_t n);
+  std::string hashcons_stats();
+  // memoization of one traversal (subst, derive, evalf) on shared symbolic
+  // nodes (ref_count>1) keyed on node identity, so that a DAG is walked
+  // once and the result keeps the sharing. The table keeps the key nodes
+  // alive. The constructor makes it the current table of the traversal
+  // (cur), the destructor restores the previous one. param/iparam identify
+  // the parameters of the traversal, a nested call with other parameters
+  // must open its own table.
+  class dag_memo {
+    dag_memo * & cur;
+    dag_memo * prev;
+    std::map<const void *,std::pair<gen,gen> > tab;
+  public:
+    const void * param;
+    longlong iparam;
+    dag_memo(dag_memo * & current,const void * p,longlong ip):cur(current),prev(current),param(p),iparam(ip){ cur=this; }
+    ~dag_memo(){ cur=prev; }
+    static bool shared(const gen & g){ return g.type==_SYMB && g.ref_count()!=1; }
+    const gen * find(const gen & g) const {
+      std::map<const void *,std::pair<gen,gen> >::const_iterator it=tab.find(g._SYMBptr);
+      return it==tab.end()?0:&it->second.second;
+    }
+    void insert(const gen & g,const gen & res){ tab[g._SYMBptr]=std::pair<gen,gen>(g,res); }
+    size_t size() const { return tab.size(); }
+  };
+  // Evaluation scoped arena (slab allocator builds, off by default). While
+  // an eval_arena is alive, the _ZINT, _VECT, _CPLX and _SYMB objects
+  // allocated by this thread come from a bump region; objects dying in
+  // the scope are destroyed and their blocks reused, objects still alive
+  // at the end are released in bulk by the destructor. keep(g) returns a
+  // copy of g that survives the arena. Objects still referenced from
+  // outside (globals, caches) are detected from their reference counts
+  // and kept, their chunks are handed over to the slab allocator. A
+  // nested or disabled arena does nothing.
+  class eval_arena {
+    void * a;
+  public:
+    eval_arena();
+    ~eval_arena();
+    gen keep(const gen & g);
+  };
+  void arena_eval(bool on);
+  bool arena_eval();
+  std::string arena_stats();
   extern "C" void stack_check_init(size_t max_stack_size);
   bool stack_check(GIAC_CONTEXT);
 
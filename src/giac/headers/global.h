@@ -79,6 +79,14 @@ inline double giac_log(double d){
 #include <pthread.h>
 #endif
 
+// evaluation state that must not be shared by threads evaluating
+// independent contexts (see eval_tunables)
+#if defined HAVE_LIBPTHREAD && __cplusplus>=201103L
+#define GIAC_THREAD_LOCAL thread_local
+#else
+#define GIAC_THREAD_LOCAL
+#endif
+
 #include "vector.h"
 #include <string>
 #if !defined( NSPIRE) && !defined(FXCG)
@@ -358,7 +366,7 @@ Boolean isLegalUTF8Sequence(const UTF8 *source, const UTF8 *sourceEnd);
   // ==-3:
   // ==-4: write static_lexer.h, static_lexer_.h and static_extern.h
   // ==-5: do not throw on errors
-  extern int threads;
+  extern GIAC_THREAD_LOCAL int threads;
   extern unsigned short int GIAC_PADIC;
 
   extern bool CAN_USE_LAPACK;
@@ -423,18 +431,95 @@ Boolean isLegalUTF8Sequence(const UTF8 *source, const UTF8 *sourceEnd);
 
   extern int PROOT_FACTOR_MAXDEG;
   extern int ABS_NBITS_EVALF;
-  extern volatile bool ctrl_c,interrupted,kbd_interrupted;
+  // interruption flags, threads share global_interrupt_flags except
+  // while they evaluate with their own eval_token
+  struct interrupt_flags {
+    volatile bool _ctrl_c,_interrupted;
+  };
+  extern interrupt_flags global_interrupt_flags;
+  extern GIAC_THREAD_LOCAL interrupt_flags * current_interrupt_flags;
+  // ctrl_c and interrupted read and write the flags of the calling thread,
+  // they are used like the volatile bool variables they replace
+  template<int I> struct interrupt_flag {
+    interrupt_flag(){}
+    static volatile bool & get(){ return I?current_interrupt_flags->_interrupted:current_interrupt_flags->_ctrl_c; }
+    operator bool() const { return get(); }
+    const interrupt_flag & operator =(bool b) const { get()=b; return *this; }
+    const interrupt_flag & operator =(const interrupt_flag & f) const { get()=bool(f); return *this; }
+    template<int J> const interrupt_flag & operator =(const interrupt_flag<J> & f) const { get()=bool(f); return *this; }
+  };
+  extern const interrupt_flag<0> ctrl_c;
+  extern const interrupt_flag<1> interrupted;
+  extern volatile bool kbd_interrupted;
+  // raises ctrl_c in the global flags and in the flags of the tokens in use
   void ctrl_c_signal_handler(int signum);
+  // cooperative cancellation token of one evaluation: the evaluating thread
+  // is never killed, cancel() raises the ctrl_c/interrupted flags of the token
+  // that are checked at the usual interruption points and the evaluation
+  // unwinds normally.
+  // control_c() cancels current_eval_token once its deadline is reached
+  // or when the memory charged by the evaluating thread exceeds maxmem
+  // (see memory_charge in gen.h), protecteval then returns the error
+  // "Memory limit exceeded"
+#define EVAL_TOKEN_POLL 64
+  struct eval_token {
+    double deadline; // in realtime() seconds, 0 if none
+    volatile bool cancelled;
+    interrupt_flags flags; // ctrl_c/interrupted of the evaluating thread
+    size_t maxmem,mem; // memory budget in bytes (0 if none), bytes charged
+    // by the evaluating thread and its thread pool tasks
+    volatile bool outofmem;
+    unsigned polls; // control_c() reads the clock every EVAL_TOKEN_POLL calls
+    eval_token():deadline(0),cancelled(false),maxmem(0),mem(0),outofmem(false),polls(0){ flags._ctrl_c=flags._interrupted=false; }
+    ~eval_token();
+    void set_timeout(double maxtime); // reset and set deadline, 0 for none
+    void set_memory_limit(size_t bytes); // 0 for none
+    void cancel();
+    bool expired(); // cancel if deadline is reached, true if cancelled
+    // same as expired() but the deadline is only checked once every
+    // EVAL_TOKEN_POLL calls, for the interruption points in hot loops
+    inline bool poll(){ return cancelled || (deadline>0 && !(++polls % EVAL_TOKEN_POLL) && expired()); }
+  };
+  extern GIAC_THREAD_LOCAL eval_token * current_eval_token;
+  // make t the token of the current thread (0 to go back to global flags)
+  void set_current_eval_token(eval_token * t);
+  // true if the current evaluation was cancelled (ctrl_c must not be reset)
+  bool eval_cancelled();
+  // true if the current evaluation exceeded its memory budget
+  bool memory_exceeded();
+  // check that bytes more fit in the memory budget of the current
+  // evaluation before a large allocation, otherwise cancel it and return
+  // false (the caller returns its usual failure code)
+  bool memory_check(double bytes);
+  extern GIAC_THREAD_LOCAL double caseval_maxmem; // in bytes, 0 if none
+  // performance counters (perf_counter_t in gen.h): perf_begin() is called
+  // before each top-level evaluation (caseval, minigiac), it keeps the
+  // counters of the previous one for perf_json(true).
+  // The counters are process wide: when several contexts are evaluated
+  // concurrently (minigiac -b -j, nodegiac asynchronous calls), each
+  // perf_begin restarts the counters of all of them and the values mix
+  // their work, they are only exact for one evaluation at a time
+  void perf_stats(bool on);
+  bool perf_stats();
+  void perf_begin();
+  std::string perf_json(bool last); // false: since perf_begin
+  // phase timeline (trace_scope in gen.h): trace_start() clears the events
+  // and starts recording, trace_save writes them in Chrome trace JSON format
+  // (chrome://tracing, ui.perfetto.dev) and stops recording
+  void trace_start();
+  std::string trace_json();
+  bool trace_save(const std::string & filename);
 #ifdef TIMEOUT
 #if !defined(EMCC) && !defined(EMCC2)
   double time(int );
 #endif
-  extern time_t caseval_begin,caseval_current;
-  extern double caseval_maxtime;
-  extern int caseval_n,caseval_mod,caseval_unitialized;
+  extern GIAC_THREAD_LOCAL time_t caseval_begin,caseval_current;
+  extern GIAC_THREAD_LOCAL double caseval_maxtime;
+  extern GIAC_THREAD_LOCAL int caseval_n,caseval_mod,caseval_unitialized;
 #endif
-  extern double powlog2float;
-  extern int MPZ_MAXLOG2;
+  extern GIAC_THREAD_LOCAL double powlog2float;
+  extern GIAC_THREAD_LOCAL int MPZ_MAXLOG2;
+  extern GIAC_THREAD_LOCAL double heap_mult,modgcd_cachesize; // see threaded.h
   extern int SET_COMPARE_MAXIDNT;
 
 #ifdef WITH_MYOSTREAM
@@ -700,6 +785,41 @@ throw(std::runtime_error("Stopped by user interruption.")); \
   };
 #endif // KHICAS
     
+  // Evaluation tunables that may be set per context. Evaluation code reads
+  // thread-local copies (powlog2float, MPZ_MAXLOG2, caseval_maxtime,
+  // caseval_mod, threads, heap_mult, modgcd_cachesize, caseval_maxmem),
+  // protecteval installs the values set for its context into the copies of
+  // the evaluating thread, the other fields get their default value.
+  // Independent contexts may be evaluated concurrently on separate threads,
+  // each with its own tunables, timeout and memory budget, provided they
+  // share no gen except the identifiers of syms() and published values
+  // (see publish_gen in gen.h, the lexer publishes the identifiers it
+  // registers). The remaining historical globals like debug_infolevel stay
+  // process-wide.
+  enum eval_tunables_mask {
+    _TUNE_POWLOG2FLOAT=1,
+    _TUNE_MPZ_MAXLOG2=2,
+    _TUNE_CASEVAL_MAXTIME=4,
+    _TUNE_CASEVAL_MOD=8,
+    _TUNE_THREADS=16,
+    _TUNE_HEAP_MULT=32,
+    _TUNE_MODGCD_CACHESIZE=64,
+    _TUNE_CASEVAL_MAXMEM=128,
+    _TUNE_ALL=255
+  };
+  struct eval_tunables {
+    unsigned set; // fields set for this context, see eval_tunables_mask
+    double powlog2float;
+    int mpz_maxlog2;
+    double caseval_maxtime;
+    int caseval_mod;
+    int threads;
+    double heap_mult;
+    double modgcd_cachesize;
+    double caseval_maxmem;
+    eval_tunables():set(0),powlog2float(0),mpz_maxlog2(0),caseval_maxtime(0),caseval_mod(0),threads(0),heap_mult(0),modgcd_cachesize(0),caseval_maxmem(0){}
+  };
+
   // a structure that should contain all global variables
   class global {
   public:
@@ -797,6 +917,7 @@ throw(std::runtime_error("Stopped by user interruption.")); \
     void * _extra_ptr_;
     char _series_variable_name_;
     unsigned short _series_default_order_;
+    eval_tunables _tunables_;
     global();  
     ~global();
     global & operator = (const global & g);
@@ -830,6 +951,15 @@ throw(std::runtime_error("Stopped by user interruption.")); \
   };
 
   context * clone_context(const context *);
+  // Snapshot of a configured context: settings, tunables, variables and
+  // user functions, assumptions and rootofs. Clones of a snapshot share
+  // its values except vectors, maps and strings, also inside symbolics
+  // like program bodies (they may be modified in place by =<), a clone
+  // costs a copy of the symbol table and of these parts. Evaluate in clones,
+  // not in the snapshot. The values of a snapshot are published (see
+  // publish_gen), clones may be evaluated in different threads.
+  context * snapshot_context(const context * contextptr);
+  context * clone_snapshot(const context * snapshot);
   void init_context(context * ptr);
   void clear_context(context * ptr);
 
@@ -861,6 +991,15 @@ throw(std::runtime_error("Stopped by user interruption.")); \
   int check_thread(context * contextptr);
   int check_threads(int i=0);
 
+  // store current thread values of the mask tunables in the context
+  void store_tunables(unsigned mask,GIAC_CONTEXT);
+  // set current thread values to the tunables set in the context
+  void install_tunables(GIAC_CONTEXT);
+  // copy all the tunables of the current thread to t, set them from t
+  // (thread pool tasks run with the tunables of their evaluation)
+  void save_tunables(eval_tunables & t);
+  void restore_tunables(const eval_tunables & t);
+
   void * & evaled_table(GIAC_CONTEXT);
   void * & extra_ptr(GIAC_CONTEXT);
 
@@ -1222,6 +1361,13 @@ throw(std::runtime_error("Stopped by user interruption.")); \
   // restore a gen from an opened file
   gen archive_restore(void * f,size_t readfunc(void * p, size_t nbBytes,size_t NbElements, void *file),GIAC_CONTEXT);
   gen archive_restore(FILE * f,GIAC_CONTEXT);
+  // portable binary archive (versioned, little endian), see global.cc
+  // append the archive of g to s
+  bool binary_archive_save(std::string & s,const gen & g,GIAC_CONTEXT);
+  // restore from a buffer, e.g. a mapped file, undef on error
+  gen binary_archive_restore(const char * buf,size_t len,GIAC_CONTEXT);
+  bool binary_archive_write_file(const char * filename,const gen & g,GIAC_CONTEXT);
+  gen binary_archive_read_file(const char * filename,GIAC_CONTEXT);
   void init_geogebra(bool on,GIAC_CONTEXT);
   vecteur giac_current_status(bool save_history,GIAC_CONTEXT);
   bool unarchive_session(const gen & g,int level,const gen & replace,GIAC_CONTEXT,bool with_history=true);
@@ -231,14 +231,25 @@ namespace giac {
   // class for memory efficient indices
   //*****************************************
 
+  // the storage is charged to the memory budget of the current evaluation
+  // (see memory_charge in gen.h), i is not resized after construction
   class ref_index_t {
   public:
     ref_count_t ref_count;
     index_t i;
-    ref_index_t():ref_count(1) {}
-    ref_index_t(int s):ref_count(1),i(s) {}
-    ref_index_t(const index_t & I):ref_count(1),i(I) {}
-    ref_index_t(index_t::const_iterator it,index_t::const_iterator itend):ref_count(1),i(it,itend) {}
+    ref_index_t():ref_count(1) { charge(); }
+    ref_index_t(int s):ref_count(1),i(s) { charge(); }
+    ref_index_t(const index_t & I):ref_count(1),i(I) { charge(); }
+    ref_index_t(index_t::const_iterator it,index_t::const_iterator itend):ref_count(1),i(it,itend) { charge(); }
+    ~ref_index_t(){
+      if (memory_budget_on)
+	memory_release_(sizeof(ref_index_t)+i.capacity()*sizeof(deg_t));
+    }
+  private:
+    void charge(){
+      if (memory_budget_on)
+	memory_charge_(sizeof(ref_index_t)+i.capacity()*sizeof(deg_t));
+    }
   };
 
   // direct access to deg_t in index_m 
@@ -261,7 +272,7 @@ namespace giac {
     // construct
     index_m(const index_m & im) { 
       riptr=im.riptr;
-      ++riptr->ref_count;
+      ref_count_incr(&riptr->ref_count);
     }
     index_m(const index_t & i){
       riptr=new ref_index_t(i);
@@ -275,17 +286,15 @@ namespace giac {
     }
     // delete
     ~index_m(){
-      --riptr->ref_count;
-      if (!riptr->ref_count)
+      if (ref_count_decr(&riptr->ref_count))
 	delete riptr;
     }
     // copy
     const index_m & operator = (const index_m & other){
-      --riptr->ref_count;
-      if (!riptr->ref_count)
+      if (ref_count_decr(&riptr->ref_count))
 	delete riptr;
       riptr=other.riptr; 
-      ++riptr->ref_count;
+      ref_count_incr(&riptr->ref_count);
       return *this;
     }
     
@@ -313,6 +322,8 @@ namespace giac {
     size_t size() const { return riptr->i.size(); }
     bool is_zero() const ; 
     size_t total_degree() const ;
+    // see publish_gen, the reference count is then updated atomically
+    void publish() const { riptr->ref_count |= ref_count_shared_bit<ref_count_t>(); }
 #ifdef KHICAS
     friend stdostream & operator << (stdostream & os,const index_m & m ){
       os << ":index_m:[ " ;
@@ -378,7 +389,7 @@ namespace giac {
 #endif
       } else {
 	riptr=im.riptr;
-	++riptr->ref_count;
+	ref_count_incr(&riptr->ref_count);
       }
     }
     index_m(const index_t & i){
@@ -463,21 +474,19 @@ namespace giac {
     // delete
     ~index_m(){
       if ( (taille % 2) == 0){
-	--riptr->ref_count;
-	if (!riptr->ref_count)
+	if (ref_count_decr(&riptr->ref_count))
 	  delete riptr;
       }
     }
     // copy
     const index_m & operator = (const index_m & other){
       if ( (taille % 2) == 0){
-	--riptr->ref_count;
-	if (!riptr->ref_count)
+	if (ref_count_decr(&riptr->ref_count))
 	  delete riptr;
       }
       if ( (other.taille % 2) == 0){
 	riptr=other.riptr; 
-	++riptr->ref_count;
+	ref_count_incr(&riptr->ref_count);
       }
       else {
 	* (size_t *) &taille = * (size_t *) &other.taille;
@@ -517,6 +526,8 @@ namespace giac {
     size_t size() const ;
     bool is_zero() const ;
     size_t total_degree() const ;
+    // see publish_gen, the reference count is then updated atomically
+    void publish() const { if ( (taille % 2) == 0) riptr->ref_count |= ref_count_shared_bit<ref_count_t>(); }
 #ifdef KHICAS
     friend stdostream & operator << (stdostream & os,const index_m & m ){
       os << ":index_m:[ " ;
@@ -111,6 +111,11 @@ namespace giac {
   typedef std::pair<const char *,gen> charptr_gen;
   charptr_gen * builtin_lexer_functions_begin();
   charptr_gen * builtin_lexer_functions_end();
+  // hash index of the builtin functions, built by set_lexer_string once
+  // registration is over (the table is not sorted on that path)
+  void builtin_lexer_functions_index();
+  // returns builtin_lexer_functions_end() if s is not a builtin
+  charptr_gen * builtin_lexer_functions_find(const char * s);
 #ifdef STATIC_BUILTIN_LEXER_FUNCTIONS
 #if defined NSPIRE || defined FXCG
   std::vector<size_t> * builtin_lexer_functions_();
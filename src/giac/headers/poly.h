@@ -219,12 +219,24 @@ namespace giac {
       return res;
     }
   };
+  // the monomial storage of copied tensors is charged to the memory budget
+  // of the current evaluation (see memory_charge in gen.h)
   template <class T> class Tref_tensor{
   public:
     ref_count_t ref_count;
     tensor<T> t;
-    Tref_tensor<T>(const tensor<T> & P): ref_count(1),t(P) {}
-    Tref_tensor<T>(int dim): ref_count(1),t(dim) {}
+    size_t charged; // bytes charged at construction, refunded on delete
+    Tref_tensor<T>(const tensor<T> & P): ref_count(1),t(P),charged(0) {
+      if (memory_budget_on){
+	charged=t.coord.capacity()*sizeof(monomial<T>);
+	memory_charge_(charged);
+      }
+    }
+    Tref_tensor<T>(int dim): ref_count(1),t(dim),charged(0) {}
+    ~Tref_tensor(){
+      if (charged)
+	memory_release_(charged);
+    }
   };
 
   // convert p to monomial represented by unsigned integers
@@ -40,6 +40,9 @@
 #include <iostream>
 #include <algorithm>
 #include <stdexcept>
+#ifdef CPP11
+#include <atomic>
+#endif
 #include "vector.h"
 #ifdef USTL
 #include <uheap.h>
@@ -224,13 +227,56 @@ namespace giac {
   }
 
 
-  extern double heap_mult,modgcd_cachesize;
+  extern GIAC_THREAD_LOCAL double heap_mult,modgcd_cachesize;
   // -1, -2, -3, force heap chains/multimap/map chains/heap multiplication
   // 0 always hashmap
   // >=1 use heap when product of number of monomials is >= value
 
+  // Timeline of internal phases (trace_start/trace_save in global.h): a
+  // trace_scope records one complete event with the calling thread id and
+  // an optional argument (e.g. the prime), nothing if tracing is off, if
+  // a scope of the same name is already open on this thread (recursion) or
+  // if it lasts less than 5 microseconds
+  extern bool trace_on;
+  class trace_scope {
+    const char * name;
+    longlong arg;
+    double t0;
+    void begin(const char * name_);
+    void end();
+  public:
+    trace_scope(const char * name_,longlong arg_=-1):name(0),arg(arg_),t0(0){ if (trace_on) begin(name_); }
+    ~trace_scope(){ if (name) end(); }
+  };
+
   extern bool threads_allowed;
-  extern int threads;
+  extern GIAC_THREAD_LOCAL int threads;
+
+#if defined HAVE_PTHREAD_H || defined HAVE_LIBPTHREAD
+  // Persistent pool of worker threads shared by the parallel kernels,
+  // thread_task_create/thread_task_join replace pthread_create/pthread_join.
+  // An evaluation thread may have threads-1 tasks queued or running on the
+  // pool, nested tasks included, further tasks run in the caller at
+  // creation. A queued task always has an idle worker reserved, joining a
+  // task that did not start yet runs it in the joining thread.
+  // Tasks run with the evaluation state of their owner (eval token and
+  // interruption flags, tunables, memory budget). An exception thrown by
+  // a task is rethrown by thread_task_join (as std::runtime_error) once
+  // the other tasks created by the joining thread are finished.
+  struct thread_budget;
+  struct thread_task {
+    void * (* f)(void *);
+    void * arg,* res;
+    thread_budget * budget;
+    int queue; // deque of the task while queued
+    volatile int state; // 0 queued, 1 running, 2 done
+    int * pending; // unfinished queued tasks of the creating thread
+    std::runtime_error * error; // thrown by f
+  };
+  int thread_task_create(thread_task * t,void * (* f)(void *),void * arg);
+  int thread_task_join(thread_task & t,void ** res);
+  int thread_pool_size(); // number of workers started
+#endif
 
   extern int debug_infolevel;
   int invmod(int n,int modulo);
@@ -805,6 +851,19 @@ namespace giac {
 
   int modsqrtminus1(int modulo);
   bool gcd(const std::vector< T_unsigned<gen,hashgcd_U> > & p_orig,const std::vector< T_unsigned<gen,hashgcd_U> > & q_orig,std::vector< T_unsigned<gen,hashgcd_U> > & d, std::vector< T_unsigned<gen,hashgcd_U> > & pcofactor, std::vector< T_unsigned<gen,hashgcd_U> > & qcofactor,const std::vector<hashgcd_U> & vars, bool compute_cofactors,int nthreads=1);
+  // Results of the gcd above are remembered while a gcd_cache_scope lives
+  // on the calling thread (one per evaluation in caseval and minigiac) if
+  // gcd_cache_size is non 0, the cache is bounded by this size and by a
+  // quarter of the memory budget of the evaluation, least recently used
+  // entries are dropped first
+  class gcd_cache_scope {
+    void * c;
+  public:
+    gcd_cache_scope();
+    ~gcd_cache_scope();
+  };
+  void gcd_cache_size(size_t bytes); // 0 (default) disables, resets stats
+  std::string gcd_cache_stats();
 
   bool gcd_ext(const std::vector< T_unsigned<gen,hashgcd_U> > & p_orig,const std::vector< T_unsigned<gen,hashgcd_U> > & q_orig,std::vector< T_unsigned<gen,hashgcd_U> > & d, std::vector< T_unsigned<gen,hashgcd_U> > & pcofactor, std::vector< T_unsigned<gen,hashgcd_U> > & qcofactor,const std::vector<hashgcd_U> & vars, bool compute_cofactors,int nthreads=1);
 
@@ -1775,6 +1834,7 @@ namespace giac {
 #if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
 
   template<class T,class U,class R> void * do_threadmult(void * ptr){
+    trace_scope scope("thread_mult");
     threadmult_t<T,U,R> * argptr = (threadmult_t<T,U,R> *) ptr;
     argptr->status=1;
     argptr->clock=CLOCK();
@@ -2248,6 +2308,8 @@ namespace giac {
     U u12=u1+u2; // size of the array for array multiplication
     // compare u12 and v1v2*ln(v1v2)
     if ( heap_mult>=0 && possible_size>100 && u12<512e6/sizeof(T) && u12<v1v2*std::log(double(possible_size))*2){
+      if (!memory_check(double(u12+1)*sizeof(T)))
+	return false;
       if (debug_infolevel>20)
 	CERR << "array multiplication, v1 size " << v1s << " v2 size " << v2s << " u1+u2 " << u12 << '\n';
       // array multiplication
@@ -2305,7 +2367,7 @@ namespace giac {
     v1it.push_back(it);
     // degree of product wrt to the main variable
     // will launch deg1v+1 threads to compute each degree
-    pthread_t tab[deg1v+1];
+    thread_task tab[deg1v+1];
     // threadmult_t<T,U> arg[deg1v+1];
     threadmult_t<T,U,R> * arg=new threadmult_t<T,U,R>[deg1v+1];
     possible_size=0;
@@ -2405,7 +2467,7 @@ namespace giac {
 	  arg[i].vindexptr=0;
 	  arg[i].vsmallindexptr=0;
 	}
-	res=pthread_create(&tab[i],(pthread_attr_t *) NULL,do_threadmult<T,U,R>,(void *) &arg[i]);
+	res=thread_task_create(&tab[i],do_threadmult<T,U,R>,(void *) &arg[i]);
 	if (res){
 	  // should cancel previous threads and delete created arg[i].vptr
 	  delete [] arg;
@@ -2422,7 +2484,7 @@ namespace giac {
 	    int concurrent=arg[k].status;
 	    if (concurrent==2){
 	      void * ptr;
-	      pthread_join(tab[k],&ptr);
+	      thread_task_join(tab[k],&ptr);
 	      threads_time += arg[k].clock;
 	      possible_size += arg[k].vptr->size();
 	      if (i>=0){
@@ -2440,7 +2502,7 @@ namespace giac {
 		arg[i].heapptr=arg[k].heapptr;
 		arg[i].vindexptr=arg[k].vindexptr;
 		arg[i].vsmallindexptr=arg[k].vsmallindexptr;
-		res=pthread_create(&tab[i],(pthread_attr_t *) NULL,do_threadmult<T,U,R>,(void *) &arg[i]);
+		res=thread_task_create(&tab[i],do_threadmult<T,U,R>,(void *) &arg[i]);
 		if (res){
 		  // should cancel previous threads and delete created arg[i].vptr
 		  delete [] arg;
@@ -2637,12 +2699,141 @@ namespace giac {
     */
   }
 
+#ifdef CPP11
+  typedef std::atomic<bool> hashdiv_stop_t;
+#else
+  typedef volatile bool hashdiv_stop_t;
+#endif
+
+  // one term of rem -= quo*b in hashdivrem, rem is an array indexed by
+  // the monomial or a vector of maps indexed by the main degree
+  template<class T,class U,class R>
+  inline void hashdivrem_add(T * rem,U u,int deg,const T & g1,const T & g2,const R & reduce){
+    if (!is_zero(reduce))
+      type_operator_plus_times_reduce(g1,g2,rem[u],reduce); 
+    else
+      type_operator_plus_times(g1,g2,rem[u]);
+  }
+
+  // (H::iterator: not a candidate for arrays of vector coefficients)
+  template<class T,class U,class R,class H>
+  inline void hashdivrem_add(std::vector<H> * produit,U u,int deg,const T & g1,const T & g2,const R & reduce,typename H::iterator * =0){
+    H & h=(*produit)[deg];
+    typename H::iterator prod_it=h.find(u);
+    if (prod_it==h.end()){
+      if (!is_zero(reduce))
+	type_operator_reduce(g1,g2,h[u],reduce); 
+      else
+	type_operator_times(g1,g2,h[u]); 
+    }
+    else {
+      if (!is_zero(reduce))
+	type_operator_plus_times_reduce(g1,g2,prod_it->second,reduce); 
+      else
+	type_operator_plus_times(g1,g2,prod_it->second);
+      if (is_zero(prod_it->second)) 
+	h.erase(prod_it);
+    }
+  }
+
+  // coefficient types that threads may copy at the same time without
+  // synchronization (no reference count)
+  template<class T> inline bool hashdiv_machine_coeffs(){ return false; }
+  template<> inline bool hashdiv_machine_coeffs<int>(){ return true; }
+  template<> inline bool hashdiv_machine_coeffs<longlong>(){ return true; }
+#ifdef INT128
+  template<> inline bool hashdiv_machine_coeffs<int128_t>(){ return true; }
+#endif
+
+  // true if the coefficients of v may be read by several threads, gen
+  // coefficients are published (atomic reference counts)
+  template<class T,class U>
+  inline bool hashdiv_share(const std::vector< T_unsigned<T,U> > & v){
+    return hashdiv_machine_coeffs<T>();
+  }
+  template<class U>
+  inline bool hashdiv_share(const std::vector< T_unsigned<gen,U> > & v){
+    typename std::vector< T_unsigned<gen,U> >::const_iterator it=v.begin(),itend=v.end();
+    for (;it!=itend;++it)
+      publish_gen(it->g);
+    return true;
+  }
+
+  template<class T,class U,class R,class S>
+  struct hashdivrem_sub_t {
+    S rem;
+    const T_unsigned<T,U> * bbeg,* bend;
+    const std::vector< T_unsigned<T,U> > * quoptr;
+    unsigned mainvar;
+    int rdeg;
+    R reduce;
+  };
+
+  template<class T,class U,class R,class S> void * do_hashdivrem_sub(void * ptr){
+    hashdivrem_sub_t<T,U,R,S> & arg=*(hashdivrem_sub_t<T,U,R,S> *) ptr;
+    typename std::vector< T_unsigned<T,U> >::const_iterator it2,it2end=arg.quoptr->end();
+    for (const T_unsigned<T,U> * cit=arg.bbeg;cit!=arg.bend;++cit){
+      T g1=-cit->g;
+      U u1=cit->u;
+      for (it2=arg.quoptr->begin();it2!=it2end;++it2){
+	U u=u1+it2->u;
+	int deg=int(u >> arg.mainvar);
+	if (deg<arg.rdeg)
+	  hashdivrem_add(arg.rem,u,deg,g1,it2->g,arg.reduce);
+      }
+    }
+    return ptr;
+  }
+
+  // rem -= quo*b in a division step of hashdivrem (quo has main degree
+  // rdeg-deg(b)). A term of b only updates the remainder row of its main
+  // degree + rdeg-deg(b), large steps split b at main degree changes
+  // between tasks of the pool that write disjoint rows. Only for machine
+  // integer coefficients: rows of gen coefficients may share objects.
+  template<class T,class U,class R,class S>
+  void hashdivrem_sub(S rem,const std::vector< T_unsigned<T,U> > & b,const std::vector< T_unsigned<T,U> > & quo,unsigned mainvar,int rdeg,const R & reduce){
+    hashdivrem_sub_t<T,U,R,S> arg={rem,&b.front(),&b.front()+b.size(),&quo,mainvar,rdeg,reduce};
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+    int nthreads=threads;
+    if (hashdiv_machine_coeffs<T>() && threads_allowed && nthreads>1 && double(quo.size())*b.size()>=2e4){
+      std::vector< hashdivrem_sub_t<T,U,R,S> > args;
+      size_t chunk=b.size()/nthreads+1;
+      const T_unsigned<T,U> * cit=arg.bbeg;
+      while (cit!=arg.bend){
+	const T_unsigned<T,U> * citend=arg.bend-cit>ptrdiff_t(chunk)?cit+chunk:arg.bend;
+	// do not split a row of b
+	while (citend!=arg.bend && (citend->u >> mainvar)==((citend-1)->u >> mainvar))
+	  ++citend;
+	args.push_back(arg);
+	args.back().bbeg=cit;
+	args.back().bend=citend;
+	cit=citend;
+      }
+      std::vector<thread_task> tasks(args.size()-1);
+      size_t created=0;
+      for (;created<tasks.size();++created){
+	if (thread_task_create(&tasks[created],do_hashdivrem_sub<T,U,R,S>,(void *) &args[created]))
+	  break;
+      }
+      // the last chunk and the chunks without task run here
+      for (size_t i=created;i<args.size();++i)
+	do_hashdivrem_sub<T,U,R,S>((void *) &args[i]);
+      for (size_t i=0;i<created;++i)
+	thread_task_join(tasks[i],0);
+      return;
+    }
+#endif
+    do_hashdivrem_sub<T,U,R,S>((void *) &arg);
+  }
+
   // #define HEAP_STATS
   // note that U may be of type vector of int or an int
   // + is used to multiply monomials and - to divide
   // / should return the quotient of the main variable exponent
   // > should return true if a monomial has main degree >
   // vars is the list of monomials x,y,z,etc. as translated in U type
+  // quo_only==-4 array div like 0 if possible, otherwise heap div
+  //              stopping at the first remainder term (divisibility test)
   // quo_only==-3 means heap div (compute quo and rem)
   // quo_only==-2 means compute quotient only using heap div
   // quo_only==-1 heap quotient then guess between heap remainder 
@@ -2653,9 +2844,11 @@ namespace giac {
   // quo_only==3 array division if enough memory
   // quo_only>3 univariate division with hashmap or map
   // for coefficients monomial storage
+  // if quo_only==-4 and heap div is used, r has only the first remainder term
+  // if stop is set, the division gives up (returns 0) once *stop is true
   // returns 1 if ok, 2 if ok but remainder not computed, 0 or -1 otherwise
   template<class T,class U,class R>
-  int hashdivrem(const std::vector< T_unsigned<T,U> > & a,const std::vector< T_unsigned<T,U> > & b,std::vector< T_unsigned<T,U> > & q,std::vector< T_unsigned<T,U> > & r,const std::vector<U> & vars,const R & reduce,double qmax,bool allowrational,int quo_only=0){
+  int hashdivrem(const std::vector< T_unsigned<T,U> > & a,const std::vector< T_unsigned<T,U> > & b,std::vector< T_unsigned<T,U> > & q,std::vector< T_unsigned<T,U> > & r,const std::vector<U> & vars,const R & reduce,double qmax,bool allowrational,int quo_only=0,hashdiv_stop_t * stop=0){
     // CERR << "hashdivrem dim " << vars.size() << " clock " << CLOCK() << '\n';
     q.clear();
     r.clear();
@@ -2710,7 +2903,7 @@ namespace giac {
     double v1v2=double(as)*bs;
     // FIXME, if bdeg==0
     if (
-	(!quo_only || quo_only==3) &&
+	(!quo_only || quo_only==3 || quo_only==-4) &&
 	//quo_only==3 && //is_zero(reduce) &&
 	bdeg && as>=a.front().u/25. // array div disabled, probably too much memory used
 	&& heap_mult>=0 && a.front().u < 512e6/sizeof(T)){
@@ -2735,6 +2928,10 @@ namespace giac {
       }
       std::vector< T_unsigned<T,U> > maincoeff,quo,tmp;
       for (rdeg=adeg;rdeg>=bdeg;--rdeg){
+	if (stop && *stop){
+	  delete [] rem;
+	  return 0;
+	}
 	U ushift=U(rdeg) << mainvar;
 	maincoeff.clear();
 	quo.clear();
@@ -2786,30 +2983,7 @@ namespace giac {
 	  }
 	}
 	// rem -= quo*b
-	for (cit=itbbeg;cit!=itbend;++cit){
-	  T g1=-cit->g;
-	  U u,u1=cit->u;
-	  // int deg1=u1/mainvar;
-	  if (!is_zero(reduce)){
-	    for (it2=quo.begin(),it2end=quo.end();it2!=it2end;++it2){
-	      u=u1+it2->u;
-	      register int deg = int(u >> mainvar); // deg=deg1+it2->u/mainvar;
-	      if (deg<rdeg){
-		type_operator_plus_times_reduce(g1,it2->g,rem[u],reduce); 
-	      }
-	    }
-	  }
-	  else {
-	    for (it2=quo.begin(),it2end=quo.end();it2!=it2end;++it2){
-	      u=u1+it2->u;
-	      register int deg=int(u >> mainvar);
-	      if (deg<rdeg){
-		type_operator_plus_times(g1,it2->g,rem[u]);	      
-	      }
-	    }
-	  }
-	}
-	// end rem -= quo*b
+	hashdivrem_sub(rem,b,quo,mainvar,rdeg,reduce);
       }
       // move rem to r
       for (;;--umax){
@@ -2873,6 +3047,10 @@ namespace giac {
 	*(heap+i)=U_unsigned<U>(0,i);
       }
       for (;;){
+	if (stop && *stop){
+	  delete [] heap;
+	  return 0;
+	}
 	g=T(0);
 	// compare current position in a with heap top
 	if (heapbeg!=heapend){
@@ -3213,8 +3391,13 @@ namespace giac {
 	  } // end adding incremented pairs from nouveau
 	} // end while heapbeg!=heapend && heapbeg->u==heapu
 	// add -g to r
-	if (!is_zero(g))
+	if (!is_zero(g)){
 	  r.push_back(T_unsigned<T,U>(-g,heapu));
+	  if (quo_only==-4){ // b does not divide a
+	    delete [] heap;
+	    return 1;
+	  }
+	}
       } // end for (heapbeg!=heapend)
       for (;ita!=itaend;++ita)
 	r.push_back(*ita);
@@ -3234,7 +3417,6 @@ namespace giac {
     std::vector< hash_prod > produit(adeg+1); 
 #endif    
     typename hash_prod::iterator prod_it,prod_itend;
-    hash_prod * hashptr;
     // find maincoeff of b
     std::vector< T_unsigned<T,U> > lcoeffb;
     for (cit=b.begin(),citend=b.end();cit!=citend;++cit){
@@ -3281,6 +3463,8 @@ namespace giac {
       produit[unsigned(u >> mainvar)][u]=cit->g; 
     }
     for (rdeg=adeg;rdeg>=bdeg;--rdeg){
+      if (stop && *stop)
+	return 0;
       if (debug_infolevel>20)
 	CERR << "hashdivrem degree " << rdeg << " " << CLOCK() << '\n';
       if (produit[rdeg].empty())
@@ -3326,48 +3510,7 @@ namespace giac {
 	}
       }
       // remainder -= quo*b
-      for (cit=itbbeg;cit!=itbend;++cit){
-	T g1=-cit->g;
-	U u,u1=cit->u;
-	// int deg1=u1/mainvar;
-	if (!is_zero(reduce)){
-	  for (it2=quo.begin(),it2end=quo.end();it2!=it2end;++it2){
-	    u=u1+it2->u;
-	    register int deg = int(u >> mainvar); // deg=deg1+it2->u/mainvar;
-	    if (deg<rdeg){
-	      hashptr = &produit[deg];
-	      prod_it=hashptr->find(u);
-	      if (prod_it==hashptr->end())
-		//(*hashptr)[u]=(g1*it2->g)%reduce; 
-		type_operator_reduce(g1,it2->g,(*hashptr)[u],reduce); 
-	      else {
-		// prod_it->second += g1*it2->g;
-		// prod_it->second %= reduce;
-		type_operator_plus_times_reduce(g1,it2->g,prod_it->second,reduce); 
-		if (is_zero(prod_it->second)) hashptr->erase(prod_it);
-	      }
-	    }
-	  }
-	}
-	else {
-	  for (it2=quo.begin(),it2end=quo.end();it2!=it2end;++it2){
-	    u=u1+it2->u;
-	    register int deg=int(u >> mainvar);
-	    if (deg<rdeg){
-	      hashptr = &produit[deg];
-	      prod_it=hashptr->find(u);
-	      if (prod_it==hashptr->end()){
-		type_operator_times(g1,it2->g,(*hashptr)[u]); 
-	      }
-	      else {
-		type_operator_plus_times(g1,it2->g,prod_it->second);	      
-		if (is_zero(prod_it->second)) hashptr->erase(prod_it);
-	      }
-	    }
-	  }
-	}
-      }
-      // end rem -= quo*b
+      hashdivrem_sub(&produit,b,quo,mainvar,rdeg,reduce);
     } // end for (redg=...)
 #if 0
     CERR << "dim " << vars.size() << ", curcoeffsize " << curcoeffsize << '\n' << "maincoeff " << maincoeff.size() << "," << maincoeff.capacity() << '\n' << "quo " << quo.size() << "," << quo.capacity() << '\n' << "q " << q.size() << "," << q.capacity() << '\n';
@@ -3391,6 +3534,52 @@ namespace giac {
     return 1;
   }
 
+  template<class T,class U,class R>
+  struct hashdivrem_t {
+    const std::vector< T_unsigned<T,U> > * aptr,* bptr;
+    std::vector< T_unsigned<T,U> > * qptr;
+    std::vector< T_unsigned<T,U> > r;
+    const std::vector<U> * varsptr;
+    R reduce;
+    double qmax;
+    bool allowrational;
+    hashdiv_stop_t * stop;
+    bool divides;
+  };
+
+  template<class T,class U,class R> void * do_hashdivrem(void * ptr){
+    hashdivrem_t<T,U,R> * argptr = (hashdivrem_t<T,U,R> *) ptr;
+    argptr->divides=hashdivrem(*argptr->aptr,*argptr->bptr,*argptr->qptr,argptr->r,*argptr->varsptr,argptr->reduce,argptr->qmax,argptr->allowrational,-4,argptr->stop)==1 && argptr->r.empty();
+    if (!argptr->divides)
+      *argptr->stop=true; // the other division is useless
+    return ptr;
+  }
+
+  // check that b divides a1 and a2, q1 and q2 are the quotients.
+  // Both divisions run at the same time if threads are available, the
+  // first one that fails stops the other. Both read b (and a1, a2 may
+  // share coefficients with b), gen coefficients are published before.
+  template<class T,class U,class R>
+  bool hashdivides2(const std::vector< T_unsigned<T,U> > & a1,const std::vector< T_unsigned<T,U> > & a2,const std::vector< T_unsigned<T,U> > & b,std::vector< T_unsigned<T,U> > & q1,std::vector< T_unsigned<T,U> > & q2,const std::vector<U> & vars,const R & reduce,double qmax,bool allowrational){
+    hashdiv_stop_t stop(false);
+    hashdivrem_t<T,U,R> arg1={&a1,&b,&q1,std::vector< T_unsigned<T,U> >(),&vars,reduce,qmax,allowrational,&stop,false};
+    hashdivrem_t<T,U,R> arg2={&a2,&b,&q2,std::vector< T_unsigned<T,U> >(),&vars,reduce,qmax,allowrational,&stop,false};
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+    if (threads_allowed && threads>1 && double(std::min(a1.size(),a2.size()))*b.size()>=1e4 && hashdiv_share(b) && hashdiv_share(a1) && hashdiv_share(a2)){
+      thread_task t;
+      thread_task_create(&t,do_hashdivrem<T,U,R>,(void *) &arg1);
+      do_hashdivrem<T,U,R>((void *) &arg2);
+      thread_task_join(t,0);
+      return arg1.divides && arg2.divides;
+    }
+#endif
+    do_hashdivrem<T,U,R>((void *) &arg1);
+    if (!arg1.divides)
+      return false;
+    do_hashdivrem<T,U,R>((void *) &arg2);
+    return arg2.divides;
+  }
+
 
 
   template<class T,class U>
@@ -8,6 +8,14 @@
 // define IMMEDIATE_VECTOR if you want to use imvector
 #define immvector_max (1 << 30)
 
+namespace giac {
+  // memory budget of the current evaluation (see memory_charge in gen.h),
+  // imvector storage is charged while memory_budget_on is set
+  extern bool memory_budget_on;
+  void memory_charge_(size_t bytes);
+  void memory_release_(size_t bytes);
+}
+
 namespace std {
 
   // inline void swapptr(void * & a,void * & b){ register void * c=a; a=b; b=c; }
@@ -51,6 +59,16 @@ namespace std {
       int _tab[IMMEDIATE_VECTOR];
     };
     // private allocation methods
+    static _Tp * _new(unsigned n){
+      if (giac::memory_budget_on)
+	giac::memory_charge_(n*sizeof(_Tp));
+      return new _Tp[n];
+    }
+    void _delete(){
+      if (giac::memory_budget_on)
+	giac::memory_release_((_endalloc_immediate_vect-_begin_immediate_vect)*sizeof(_Tp));
+      delete [] _begin_immediate_vect;
+    }
     void _zero_tab(){
       for (unsigned i=0;i<IMMEDIATE_VECTOR;i++) 
 	_tab[i]=0; 
@@ -65,7 +83,7 @@ namespace std {
       if (_taille>0){ 
 	if (_begin_immediate_vect) {
 	  // std::cerr << "delete " << _taille << '\n';
-	  delete [] _begin_immediate_vect; 
+	  _delete();
 	}
       }
       else
@@ -83,7 +101,7 @@ namespace std {
       if (_taille<=0){ // dyn alloc the vector
 	_taille=(_taille?-_taille:immvector_max);
 	n=nextpow2(n);
-	_Tp * _newbegin = new _Tp[n];
+	_Tp * _newbegin = _new(n);
 	if (_taille<immvector_max){
 	  for (int i=0;i<_taille;++i){
 	    _newbegin[i] = ((_Tp *)_tab)[i];
@@ -101,14 +119,14 @@ namespace std {
 	return;
       }
       n=nextpow2(n);
-      _Tp * _newbegin = new _Tp[n];
+      _Tp * _newbegin = _new(n);
       _Tp * _end_immediate_vect = _begin_immediate_vect+(_taille==immvector_max?0:_taille);
       for (_Tp * ptr=_begin_immediate_vect;ptr!=_end_immediate_vect;++ptr,++_newbegin){
 	*_newbegin = *ptr;
       }
       _newbegin -= (_taille==immvector_max?0:_taille);
       if (_begin_immediate_vect)
-	delete [] _begin_immediate_vect;
+	_delete();
       _begin_immediate_vect=_newbegin;
       _endalloc_immediate_vect=_begin_immediate_vect+n;
     }
@@ -120,7 +138,7 @@ namespace std {
       else {
 	_taille=(n?n:immvector_max);
 	n=nextpow2(n);
-	_begin_immediate_vect = new _Tp[n];
+	_begin_immediate_vect = _new(n);
 	_endalloc_immediate_vect=_begin_immediate_vect+n;
       }
     }
@@ -268,7 +286,7 @@ namespace std {
 	return res;
       }
       _Tp res=*_begin_immediate_vect;
-      delete [] _begin_immediate_vect;
+      _delete();
       _zero_tab();
       return res;
     }
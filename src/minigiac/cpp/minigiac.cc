@@ -1,13 +1,216 @@
 #include "giac.h"
+#include <fstream>
+#include <sstream>
 
 using namespace std;
 using namespace giac;
 
+static bool stats_json = false; // -s
+
+// Evaluate the lines of in in a fresh context and write the session to out,
+// each line with its own timeout (0: none) and memory budget in bytes (0: none).
+// The interactive session prints with the process defaults as it always did,
+// batch sessions run concurrently and print with the settings of their context
+static void run_session(istream & in, ostream & out, double maxtime, double maxmem, bool interactive){
+  context ct;
+  string line;
+  int n = 1; // in giac this starts from 0
+  while (getline(in, line)) {
+    out << n << ">> " << line << endl;
+    out << n++ << "<< ";
+    eval_token token;
+    if (maxtime > 0 || maxmem > 0) {
+      token.set_timeout(maxtime);
+      token.set_memory_limit(size_t(maxmem));
+      set_current_eval_token(&token);
+      }
+    perf_begin();
+    eval_arena arena; // temporaries of the line are released together
+    gcd_cache_scope gcds; // gcd results are reused within the line only
+    gen g(line,&ct);
+    string error;
+    bool failed=false;
+    try {
+      trace_scope scope("line", n-1);
+      install_tunables(&ct);
+      g=eval(g,1,&ct);
+      } catch (runtime_error & err) {
+      failed=true;
+      error=err.what();
+      }
+    if (token.outofmem)
+      out << "ERROR: Memory limit exceeded" << endl;
+    else if (token.cancelled)
+      out << "Timeout" << endl;
+    else if (failed)
+      out << "ERROR: " << error << endl;
+    else if (!interactive)
+      out << g.print(&ct) << endl;
+    else {
+      // caseval("init geogebra") switches ct only, let the defaults follow
+      if (g.type==_STRNG && (*g._STRNGptr=="geogebra mode on" || *g._STRNGptr=="geogebra mode off"))
+        init_geogebra(*g._STRNGptr=="geogebra mode on",0);
+      out << g << endl;
+      }
+    if (stats_json)
+      cerr << n-1 << " stats " << perf_json(false) << endl;
+    set_current_eval_token(0);
+    }
+  }
+
+// Batch mode: each line of the list file is "input output", each input file
+// is evaluated like minigiac -m < input > output. Jobs are spread over
+// nthreads workers, one status line per job is printed in list order.
+struct batch_job {
+  string in, out;
+  bool done, ok;
+  };
+
+struct batch_param {
+  vector<batch_job> jobs;
+  size_t next;
+  double maxtime, maxmem;
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_t mutex;
+  pthread_cond_t done_cond;
+#endif
+  };
+
+static void batch_run_job(batch_job & job, double maxtime, double maxmem){
+  ifstream in(job.in.c_str());
+  ofstream out(job.out.c_str());
+  job.ok = in && out;
+  if (job.ok)
+    run_session(in, out, maxtime, maxmem, false);
+  }
+
+#ifdef HAVE_LIBPTHREAD
+static void * batch_worker(void * arg){
+  batch_param * ptr = (batch_param *) arg;
+  for (;;) {
+    pthread_mutex_lock(&ptr->mutex);
+    size_t i = ptr->next++;
+    pthread_mutex_unlock(&ptr->mutex);
+    if (i >= ptr->jobs.size())
+      return 0;
+    batch_job & job = ptr->jobs[i];
+    batch_run_job(job, ptr->maxtime, ptr->maxmem);
+    pthread_mutex_lock(&ptr->mutex);
+    job.done = true;
+    pthread_cond_broadcast(&ptr->done_cond);
+    pthread_mutex_unlock(&ptr->mutex);
+    }
+  }
+#endif
+
+static int batch(const char * listname, int nthreads, double maxtime, double maxmem){
+  ifstream list(listname);
+  if (!list) {
+    cerr << "Cannot read " << listname << endl;
+    return 2;
+    }
+  batch_param p;
+  p.next = 0;
+  p.maxtime = maxtime;
+  p.maxmem = maxmem;
+  string line;
+  while (getline(list, line)) {
+    istringstream is(line);
+    batch_job job;
+    if (!(is >> job.in >> job.out))
+      continue;
+    job.done = job.ok = false;
+    p.jobs.push_back(job);
+    }
+  int res = 0;
+#ifdef HAVE_LIBPTHREAD
+  pthread_mutex_init(&p.mutex, 0);
+  pthread_cond_init(&p.done_cond, 0);
+  vector<pthread_t> workers;
+  for (int i = 0; i < nthreads; ++i) {
+    pthread_t t;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 8 * 1024 * 1024); // like the main thread
+    if (pthread_create(&t, &attr, batch_worker, &p) == 0)
+      workers.push_back(t);
+    pthread_attr_destroy(&attr);
+    }
+  if (workers.empty())
+    batch_worker(&p);
+  for (size_t i = 0; i < p.jobs.size(); ++i) {
+    pthread_mutex_lock(&p.mutex);
+    while (!p.jobs[i].done)
+      pthread_cond_wait(&p.done_cond, &p.mutex);
+    pthread_mutex_unlock(&p.mutex);
+    cout << i+1 << " " << p.jobs[i].out << (p.jobs[i].ok ? "" : " ERROR") << endl;
+    if (!p.jobs[i].ok)
+      res = 1;
+    }
+  for (size_t i = 0; i < workers.size(); ++i)
+    pthread_join(workers[i], 0);
+  pthread_cond_destroy(&p.done_cond);
+  pthread_mutex_destroy(&p.mutex);
+#else
+  // no threads available: evaluate the jobs one after the other
+  for (size_t i = 0; i < p.jobs.size(); ++i) {
+    batch_run_job(p.jobs[i], maxtime, maxmem);
+    cout << i+1 << " " << p.jobs[i].out << (p.jobs[i].ok ? "" : " ERROR") << endl;
+    if (!p.jobs[i].ok)
+      res = 1;
+    }
+#endif
+  return res;
+  }
+
 int main(int argc, char *argv[]){
   int verbosemode = 1;
+  const char * listname = 0, * tracename = 0;
+  int nthreads = 1;
+  double maxtime = 0, maxmem = 0;
   // -m will disable verbose mute (useful to work as a simple filter)
-  if ((argc==2) && (strcmp(argv[1], "-m") == 0))
-    verbosemode = 0;
+  // -b <list> runs the batch mode, see above
+  // -j <n> number of worker threads in batch mode
+  // -t <seconds> timeout for each input line
+  // -M <megabytes> memory budget for each input line
+  // -s print the performance counters of each line as JSON on stderr
+  //    (process wide: with -j they mix the lines evaluated concurrently)
+  // -a allocate the objects of each line from an arena
+  // -T <file> write a Chrome trace of the internal phases to file at exit
+  // -g <megabytes> cache the multivariate gcd results of each line
+  // -f allow file access (secure mode off), e.g. for archive/unarchive
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-m") == 0)
+      verbosemode = 0;
+    else if (strcmp(argv[i], "-b") == 0 && i+1 < argc)
+      listname = argv[++i];
+    else if (strcmp(argv[i], "-j") == 0 && i+1 < argc)
+      nthreads = max(atoi(argv[++i]), 1);
+    else if (strcmp(argv[i], "-t") == 0 && i+1 < argc)
+      maxtime = atof(argv[++i]);
+    else if (strcmp(argv[i], "-M") == 0 && i+1 < argc)
+      maxmem = atof(argv[++i]) * 1048576;
+    else if (strcmp(argv[i], "-a") == 0)
+      arena_eval(true);
+    else if (strcmp(argv[i], "-s") == 0) {
+      stats_json = true;
+      perf_stats(true);
+      }
+    else if (strcmp(argv[i], "-T") == 0 && i+1 < argc)
+      tracename = argv[++i];
+    else if (strcmp(argv[i], "-g") == 0 && i+1 < argc)
+      gcd_cache_size(size_t(atof(argv[++i]) * 1048576));
+    else if (strcmp(argv[i], "-f") == 0)
+      secure_run = false;
+    }
+  if (tracename)
+    trace_start();
+  if (listname) {
+    int res = batch(listname, nthreads, maxtime, maxmem);
+    if (tracename && !trace_save(tracename))
+      cerr << "Unable to write " << tracename << endl;
+    return res;
+    }
   if (verbosemode == 1) {
     cout << "This is a minimalist command line version of Giac" << endl;
     cout << "Enter expressions to evaluate" << endl;
@@ -16,18 +219,7 @@ int main(int argc, char *argv[]){
     cout << "f(x):=sin(x^2); f'(2); f'(y)" << endl;
     cout << "Press CTRL-D to stop" << endl;
     }
-  context ct;
-  string line;
-  gen g;
-  int n = 1; // in giac this starts from 0
-  while (getline(cin, line)) {
-    cout << n << ">> " << line << endl;
-    cout << n++ << "<< ";
-    g=gen(line,&ct);
-    try {
-      cout << eval(g,1,&ct) << endl;
-      } catch (runtime_error & err) {
-      cout << "ERROR: " << err.what() << endl;
-      }
-    }
+  run_session(cin, cout, maxtime, maxmem, true);
+  if (tracename && !trace_save(tracename))
+    cerr << "Unable to write " << tracename << endl;
   }
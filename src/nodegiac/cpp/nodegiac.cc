@@ -1,5 +1,11 @@
 #include <node.h>
 #include <v8.h>
+#include <uv.h>
+
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <vector>
 
 #include "giac.h"
 
@@ -19,6 +25,7 @@ void Evaluate(const v8::FunctionCallbackInfo<Value>& args) {
   v8::String::Utf8Value param1(isolate, args[0]->ToString(context).ToLocalChecked());
   std::string line_in = std::string(*param1);
 
+  perf_begin();
   gen g;
   g=gen(line_in,&ct);
   try {
@@ -31,11 +38,292 @@ void Evaluate(const v8::FunctionCallbackInfo<Value>& args) {
   args.GetReturnValue().Set(line_out_v8);
 }
 
+// Asynchronous evaluation.
+// Jobs run on the libuv thread pool, each one in a giac context of its own:
+// either a context of the pool (size UV_THREADPOOL_SIZE, default 4), reset
+// after each job, or the context of a named session. A context runs one job
+// at a time, the other jobs wait in a queue. All the bookkeeping below is
+// done on the main thread.
+// At most GIAC_MAX_QUEUE (default 1024) jobs may be queued or running,
+// further calls are rejected.
+
+struct giac_slot;
+
+struct async_job {
+  uv_work_t req;
+  std::string input;
+  std::string output; // result, or error message if failed
+  bool failed;
+  double timeout; // in seconds, 0 for none
+  giac_slot * slot;
+  Global<Context> context;
+  Global<Promise::Resolver> resolver;
+};
+
+struct giac_slot {
+  giac::context * ctx;
+  giac::context * snapshot; // frozen copy of ctx for templates, 0 if stale
+  bool busy;
+  bool closing; // session closed while busy, delete when done
+  std::string session; // empty for pool contexts
+  std::deque<async_job *> waiting; // session jobs only
+};
+
+static std::vector<giac_slot *> pool;
+// frozen fresh context, pool contexts are clones of it
+static giac::context * pool_snapshot = 0;
+static std::deque<async_job *> pool_waiting;
+static std::map<std::string,giac_slot *> sessions;
+static size_t pending = 0, max_pending = 0;
+
+static size_t env_size(const char * name, size_t def) {
+  const char * s = getenv(name);
+  int n = s ? atoi(s) : 0;
+  return n > 0 ? n : def;
+}
+
+// contexts of the pool and of new sessions start with the same settings as
+// the context of evaluate, so that both print the same result; a session
+// may switch to geogebra mode with caseval("init geogebra")
+static giac::context * new_context() {
+  return new giac::context;
+}
+
+static void init_pool() {
+  if (max_pending)
+    return;
+  max_pending = env_size("GIAC_MAX_QUEUE", 1024);
+  size_t n = env_size("UV_THREADPOOL_SIZE", 4);
+  giac::context * fresh = new_context();
+  pool_snapshot = snapshot_context(fresh);
+  delete fresh;
+  for (size_t i = 0; i < n; ++i) {
+    giac_slot * slot = new giac_slot;
+    slot->ctx = clone_snapshot(pool_snapshot);
+    slot->snapshot = 0;
+    slot->busy = slot->closing = false;
+    pool.push_back(slot);
+  }
+}
+
+static void work_cb(uv_work_t * req) {
+  async_job * job = (async_job *) req->data;
+  giac::context * contextptr = job->slot->ctx;
+  eval_token token;
+  token.set_timeout(job->timeout);
+  set_current_eval_token(&token);
+  install_tunables(contextptr);
+  job->failed = false;
+  // nothing may escape from a libuv worker thread
+  try {
+    gen g(job->input, contextptr);
+    job->output = giac::print(giac::eval(g, contextptr), contextptr);
+  } catch (std::exception & err) {
+    job->failed = true;
+    job->output = err.what();
+  } catch (...) {
+    job->failed = true;
+    job->output = "unknown error";
+  }
+  if (token.outofmem) {
+    job->failed = true;
+    job->output = "Memory limit exceeded";
+  }
+  else if (token.cancelled) {
+    job->failed = true;
+    job->output = "Timeout";
+  }
+  set_current_eval_token(0);
+}
+
+static void after_work_cb(uv_work_t * req, int status);
+
+static void delete_slot(giac_slot * slot) {
+  delete slot->snapshot;
+  delete slot->ctx;
+  delete slot;
+}
+
+static void start_job(giac_slot * slot, async_job * job) {
+  // the job may modify the context, clones already made keep their copy
+  delete slot->snapshot;
+  slot->snapshot = 0;
+  slot->busy = true;
+  job->slot = slot;
+  job->req.data = job;
+  uv_queue_work(uv_default_loop(), &job->req, work_cb, after_work_cb);
+}
+
+static void after_work_cb(uv_work_t * req, int status) {
+  async_job * job = (async_job *) req->data;
+  giac_slot * slot = job->slot;
+  Isolate* isolate = Isolate::GetCurrent();
+  HandleScope scope(isolate);
+  Local<Context> context = Local<Context>::New(isolate, job->context);
+  Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate, job->resolver);
+  Context::Scope context_scope(context);
+  --pending;
+  slot->busy = false;
+  if (slot->session.empty()) {
+    // variables, assumptions and settings of a job do not leak into the
+    // next job of the slot
+    delete slot->ctx;
+    slot->ctx = clone_snapshot(pool_snapshot);
+  }
+  if (!slot->waiting.empty()) {
+    async_job * next = slot->waiting.front();
+    slot->waiting.pop_front();
+    start_job(slot, next);
+  }
+  else if (slot->session.empty()) {
+    if (!pool_waiting.empty()) {
+      async_job * next = pool_waiting.front();
+      pool_waiting.pop_front();
+      start_job(slot, next);
+    }
+  }
+  else if (slot->closing)
+    delete_slot(slot);
+  Local<String> out = String::NewFromUtf8(isolate, job->output.c_str(), NewStringType::kNormal).ToLocalChecked();
+  if (job->failed)
+    resolver->Reject(context, Exception::Error(out)).FromJust();
+  else
+    resolver->Resolve(context, out).FromJust();
+  job->resolver.Reset();
+  job->context.Reset();
+  delete job;
+}
+
+// evaluateAsync(expr, {timeout: seconds, session: name, template: name})
+// returns a Promise of the printed result, it is rejected with an Error on
+// giac errors, timeouts and exceeded memory budget. A new session with a
+// template starts as a copy of the template session (settings, variables,
+// functions).
+void EvaluateAsync(const v8::FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+  HandleScope scope(isolate);
+  init_pool();
+  Local<Promise::Resolver> resolver = Promise::Resolver::New(context).ToLocalChecked();
+  args.GetReturnValue().Set(resolver->GetPromise());
+  if (pending >= max_pending) {
+    Local<Value> err = Exception::Error(String::NewFromUtf8(isolate, "giac queue full", NewStringType::kNormal).ToLocalChecked());
+    resolver->Reject(context, err).FromJust();
+    return;
+  }
+
+  v8::String::Utf8Value param1(isolate, args[0]->ToString(context).ToLocalChecked());
+  async_job * job = new async_job;
+  job->input = std::string(*param1);
+  job->timeout = 0;
+  job->slot = 0;
+  job->context.Reset(isolate, context);
+  job->resolver.Reset(isolate, resolver);
+  std::string session, from;
+  if (args.Length() > 1 && args[1]->IsObject()) {
+    Local<Object> options = args[1].As<Object>();
+    Local<Value> timeout = options->Get(context, String::NewFromUtf8(isolate, "timeout", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked();
+    if (timeout->IsNumber())
+      job->timeout = timeout->NumberValue(context).FromJust();
+    Local<Value> name = options->Get(context, String::NewFromUtf8(isolate, "session", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked();
+    if (!name->IsUndefined()) {
+      v8::String::Utf8Value s(isolate, name->ToString(context).ToLocalChecked());
+      session = std::string(*s);
+    }
+    Local<Value> tmpl = options->Get(context, String::NewFromUtf8(isolate, "template", NewStringType::kNormal).ToLocalChecked()).ToLocalChecked();
+    if (!tmpl->IsUndefined()) {
+      v8::String::Utf8Value s(isolate, tmpl->ToString(context).ToLocalChecked());
+      from = std::string(*s);
+    }
+  }
+
+  giac::context * ctx = 0;
+  if (!session.empty() && !from.empty() && !sessions.count(session)) {
+    // a new session starts as a clone of the snapshot of an idle session,
+    // the snapshot is taken here (no worker uses the idle context) and
+    // reused for the next clones until the template evaluates again
+    std::map<std::string,giac_slot *>::iterator it = sessions.find(from);
+    if (it == sessions.end() || it->second->busy) {
+      Local<Value> err = Exception::Error(String::NewFromUtf8(isolate, "giac template session missing or busy", NewStringType::kNormal).ToLocalChecked());
+      resolver->Reject(context, err).FromJust();
+      job->context.Reset();
+      job->resolver.Reset();
+      delete job;
+      return;
+    }
+    giac_slot * from_slot = it->second;
+    if (!from_slot->snapshot)
+      from_slot->snapshot = snapshot_context(from_slot->ctx);
+    ctx = clone_snapshot(from_slot->snapshot);
+  }
+  ++pending;
+
+  if (!session.empty()) {
+    giac_slot * & slot = sessions[session];
+    if (!slot) {
+      slot = new giac_slot;
+      slot->ctx = ctx ? ctx : new_context();
+      slot->snapshot = 0;
+      slot->busy = slot->closing = false;
+      slot->session = session;
+    }
+    if (slot->busy)
+      slot->waiting.push_back(job);
+    else
+      start_job(slot, job);
+    return;
+  }
+  for (size_t i = 0; i < pool.size(); ++i) {
+    if (!pool[i]->busy) {
+      start_job(pool[i], job);
+      return;
+    }
+  }
+  pool_waiting.push_back(job);
+}
+
+// closeSession(name) releases the context of a session
+void CloseSession(const v8::FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+  HandleScope scope(isolate);
+  v8::String::Utf8Value param1(isolate, args[0]->ToString(context).ToLocalChecked());
+  std::map<std::string,giac_slot *>::iterator it = sessions.find(std::string(*param1));
+  if (it == sessions.end()) {
+    args.GetReturnValue().Set(false);
+    return;
+  }
+  giac_slot * slot = it->second;
+  sessions.erase(it);
+  if (slot->busy || !slot->waiting.empty())
+    slot->closing = true;
+  else
+    delete_slot(slot);
+  args.GetReturnValue().Set(true);
+}
+
+// stats(on) enables or disables the performance counters, stats() returns
+// the counters since the last evaluate call as a JSON string
+void Stats(const v8::FunctionCallbackInfo<Value>& args) {
+  Isolate* isolate = Isolate::GetCurrent();
+  HandleScope scope(isolate);
+  if (args.Length() > 0)
+    perf_stats(args[0]->BooleanValue(isolate));
+  std::string json = perf_json(false);
+  args.GetReturnValue().Set(String::NewFromUtf8(isolate, json.c_str(), NewStringType::kNormal).ToLocalChecked());
+}
+
 void Initialize(Local<Object> exports) {
   Isolate* isolate = Isolate::GetCurrent();
   Local<Context> context = isolate->GetCurrentContext();
   exports->Set(context, String::NewFromUtf8(isolate, "evaluate", NewStringType::kNormal).ToLocalChecked(),
       FunctionTemplate::New(isolate, Evaluate)->GetFunction(context).ToLocalChecked());
+  exports->Set(context, String::NewFromUtf8(isolate, "evaluateAsync", NewStringType::kNormal).ToLocalChecked(),
+      FunctionTemplate::New(isolate, EvaluateAsync)->GetFunction(context).ToLocalChecked());
+  exports->Set(context, String::NewFromUtf8(isolate, "closeSession", NewStringType::kNormal).ToLocalChecked(),
+      FunctionTemplate::New(isolate, CloseSession)->GetFunction(context).ToLocalChecked());
+  exports->Set(context, String::NewFromUtf8(isolate, "stats", NewStringType::kNormal).ToLocalChecked(),
+      FunctionTemplate::New(isolate, Stats)->GetFunction(context).ToLocalChecked());
 }
 
-NODE_MODULE(giac, Initialize)
\ No newline at end of file
+NODE_MODULE(giac, Initialize)
@@ -0,0 +1,136 @@
+// Self tests of internals that have no user visible command, run by ctest:
+//   selfcheck [pairs [tasks...]]
+// prints one summary line per check, exits with 1 if a check failed.
+#include "giac.h"
+#include <cstdlib>
+
+using namespace std;
+using namespace giac;
+
+// Compare the monomial operations (word operations when INDEX_M_PACKED)
+// with deg_t by deg_t loops on n pseudo-random pairs of indices of 1 to 8
+// variables, exponents including negative and extreme values, the second
+// index often equal to the first up to one exponent (lex ties).
+static bool index_check(int n){
+  static const deg_t special[]={0,1,2,-1,-2,16383,16384,32767,-32767,-32768};
+  ulonglong seed=12345;
+  int mismatch=0;
+  for (int k=0;k<n;++k){
+    int s=1+k%8;
+    index_t a(s),b(s),sum(s),diff(s);
+    for (int j=0;j<s;++j){
+      seed=seed*6364136223846793005ULL+1442695040888963407ULL;
+      unsigned r=unsigned(seed>>33);
+      a[j]=(r%4)?special[(r>>2)%10]:deg_t(r>>8);
+      seed=seed*6364136223846793005ULL+1442695040888963407ULL;
+      r=unsigned(seed>>33);
+      b[j]=(r%3)?a[j]:((r%3)==1?special[(r>>2)%10]:deg_t(r>>8));
+      }
+    if (k%3==0){
+      // tie up to the last exponent
+      b=a;
+      b[s-1]=deg_t(b[s-1]+(k%2?1:-1));
+      }
+    int cmp=0;
+    for (int j=0;j<s;++j){
+      sum[j]=deg_t(a[j]+b[j]);
+      diff[j]=deg_t(a[j]-b[j]);
+      if (!cmp && a[j]!=b[j])
+        cmp=a[j]>b[j]?1:-1;
+      }
+    index_m am(a),bm(b);
+    if ((am==bm)!=(cmp==0) || (am!=bm)!=(cmp!=0))
+      ++mismatch;
+    if (!((am+bm)==index_m(sum)) || !((am-bm)==index_m(diff)))
+      ++mismatch;
+    if (i_lex_is_greater(am,bm)!=(cmp>=0) || i_lex_is_strictly_greater(am,bm)!=(cmp>0))
+      ++mismatch;
+    if (i_lex_is_greater(bm,am)!=(cmp<=0) || i_lex_is_strictly_greater(bm,am)!=(cmp<0))
+      ++mismatch;
+    }
+  cout << "Index check pairs " << n << ", mismatches " << mismatch << endl;
+  return !mismatch;
+  }
+
+#if defined HAVE_PTHREAD_H || defined HAVE_LIBPTHREAD
+// Run n tasks on the thread pool that record the evaluation state they
+// see (tunables, eval token, interruption flags) and charge memory to the
+// budget of the creating thread, task 1 throws.
+struct pool_check_param {
+  int n;
+  double heap_mult;
+  int threads;
+  eval_token * token;
+  interrupt_flags * flags;
+  };
+
+static void * do_pool_check(void * ptr){
+  pool_check_param * p=(pool_check_param *) ptr;
+  p->heap_mult=heap_mult;
+  p->threads=threads;
+  p->token=current_eval_token;
+  p->flags=current_interrupt_flags;
+  memory_charge(1024);
+  if (p->n==1)
+    throw std::runtime_error("pool check");
+  return ptr;
+  }
+
+static bool pool_check(int n){
+  double heap_mult0=heap_mult;
+  int threads0=threads;
+  eval_token * token0=current_eval_token;
+  eval_token token;
+  token.set_timeout(0);
+  token.set_memory_limit(size_t(1)<<40);
+  set_current_eval_token(&token);
+  heap_mult=12345;
+  threads=n+1;
+  vector<pool_check_param> param(n);
+  vector<thread_task> tab(n);
+  for (int i=0;i<n;++i){
+    param[i].n=i;
+    thread_task_create(&tab[i],do_pool_check,(void *) &param[i]);
+    }
+  string error;
+  for (int i=0;i<n;++i){
+    try {
+      thread_task_join(tab[i],0);
+      } catch (std::runtime_error & e) {
+      error=e.what();
+      }
+    }
+  int same=0;
+  for (int i=0;i<n;++i){
+    if (param[i].heap_mult==12345 && param[i].threads==n+1 && param[i].token==&token && param[i].flags==&token.flags)
+      ++same;
+    }
+  size_t mem=token.mem;
+  heap_mult=heap_mult0;
+  threads=threads0;
+  set_current_eval_token(token0);
+  bool ok=same==n && error=="pool check";
+  cout << "Pool check tasks " << n << ", same state " << same << ", exception " << (error.empty()?string("none"):error);
+#ifdef GIAC_MEMORY_BUDGET
+  cout << (mem>=size_t(n)*1024?", memory charged":", memory not charged");
+  ok = ok && mem>=size_t(n)*1024;
+#endif
+  cout << endl;
+  return ok;
+  }
+#endif
+
+int main(int argc, char *argv[]){
+  bool ok=index_check(argc>1?atoi(argv[1]):4000);
+#if defined HAVE_PTHREAD_H || defined HAVE_LIBPTHREAD
+  if (argc>2){
+    for (int i=2;i<argc;++i)
+      ok = pool_check(max(2,min(atoi(argv[i]),64))) && ok;
+    }
+  else {
+    ok = pool_check(4) && ok;
+    ok = pool_check(16) && ok;
+    }
+#endif
+  return ok?0:1;
+  }